@@ -0,0 +1,61 @@
+// firmware/bench/MotorPlant.h
+#pragma once
+#include <Arduino.h>
+#include "../main/Config.h"
+#include "../main/Devices/DeviceBase.h"
+
+// Smart-motor plant for the wheels bench: the module latches a speed code from
+// the bus frame after a processing delay, quantised to the 14 MAX speed steps,
+// and the wheel approaches that setpoint with a first-order lag.
+struct PlantParams {
+  float tauMs = 120.0f;                 // mechanical time constant
+  float vmaxMmS = ODOM_WHEEL_MM_S_MAX;  // rim speed at CMD_SPEED_MAX
+  uint32_t frameUs = 27000;             // MeccaChannel frame on the wire (blocks the loop)
+  uint32_t moduleDelayUs = 5000;        // frame end -> module applies the new code
+};
+
+class SmartMotor {
+public:
+  void begin(const PlantParams& p, const MaxPortInfo& port) {
+    p_ = p;
+    port_ = port;
+  }
+
+  // Frame bytes for this motor, delivered at `atUs` (end of the wire frame)
+  void command(uint8_t dirByte, uint8_t speedCode, uint64_t atUs) {
+    pendingSetpoint_ = setpointFor(dirByte, speedCode);
+    pendingAtUs_ = atUs + p_.moduleDelayUs;
+    hasPending_ = true;
+  }
+
+  // Integrate in 1ms steps up to `us`
+  void advanceTo(uint64_t us) {
+    while (nowUs_ + 1000 <= us) {
+      nowUs_ += 1000;
+      if (hasPending_ && nowUs_ >= pendingAtUs_) {
+        setpoint_ = pendingSetpoint_;
+        hasPending_ = false;
+      }
+      speed_ += (setpoint_ - speed_) * (1.0f / p_.tauMs);
+    }
+  }
+
+  float speed() const { return speed_; }  // mm/s, forward positive
+
+private:
+  PlantParams p_;
+  MaxPortInfo port_{0, 0, false};
+  uint64_t nowUs_ = 0;
+  float speed_ = 0;
+  float setpoint_ = 0;
+  float pendingSetpoint_ = 0;
+  uint64_t pendingAtUs_ = 0;
+  bool hasPending_ = false;
+
+  float setpointFor(uint8_t dirByte, uint8_t code) const {
+    if (code < MAXProtocol::CMD_SPEED_MIN || code > MAXProtocol::CMD_SPEED_MAX) return 0;
+    const float steps = MAXProtocol::CMD_SPEED_MAX - MAXProtocol::CMD_SPEED_MIN + 1;
+    const float v = p_.vmaxMmS * (code - MAXProtocol::CMD_SPEED_MIN + 1) / steps;
+    return dirByte == port_.dirByte(true) ? v : -v;
+  }
+};
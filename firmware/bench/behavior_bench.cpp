@@ -0,0 +1,321 @@
+// firmware/bench/behavior_bench.cpp
+// Host bench for the onboard behaviour VM: runs the real BehaviorVm (verifier +
+// interpreter) on the device tick against a kinematic robot (Odometry fed with the
+// wheel speeds), reports instructions/tick and tick cost, and how far a decision
+// taken on the device lands from one taken a round-trip away. See README.md.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../main/BehaviorVm.h"
+#include "../main/Odometry.h"
+
+// ---- Host runtime ----
+uint64_t g_simUs = 0;
+BenchSerial Serial;
+
+using Vm = BehaviorVm;
+
+// ---- Tiny assembler (same mnemonics as server/src/behaviors.ts) ----
+struct Asm {
+  std::vector<uint8_t> code;
+  std::map<std::string, uint16_t> labels;
+  std::vector<std::pair<size_t, std::string>> fixups;
+
+  Asm& op(uint8_t o) {
+    code.push_back(o);
+    return *this;
+  }
+  Asm& push(int32_t v) {
+    if (v >= -128 && v <= 127) {
+      op(Vm::PUSH8).code.push_back((uint8_t)v);
+    } else if (v >= -32768 && v <= 32767) {
+      op(Vm::PUSH16);
+      for (int i = 0; i < 2; ++i) code.push_back((uint8_t)((uint32_t)v >> (8 * i)));
+    } else {
+      op(Vm::PUSH32);
+      for (int i = 0; i < 4; ++i) code.push_back((uint8_t)((uint32_t)v >> (8 * i)));
+    }
+    return *this;
+  }
+  Asm& arg(uint8_t o, uint8_t a) { return op(o).op(a); }
+  Asm& in(uint8_t sensor) { return arg(Vm::IN, sensor); }
+  Asm& load(uint8_t i) { return arg(Vm::LOAD, i); }
+  Asm& store(uint8_t i) { return arg(Vm::STORE, i); }
+  Asm& jump(uint8_t o, const char* label) {
+    op(o);
+    fixups.push_back({code.size(), label});
+    code.push_back(0);
+    code.push_back(0);
+    return *this;
+  }
+  Asm& label(const char* name) {
+    labels[name] = (uint16_t)code.size();
+    return *this;
+  }
+  std::vector<uint8_t> build() {
+    for (const auto& f : fixups) {
+      const uint16_t at = labels.count(f.second) ? labels[f.second] : 0xFFFF;
+      code[f.first] = (uint8_t)at;
+      code[f.first + 1] = (uint8_t)(at >> 8);
+    }
+    return code;
+  }
+};
+
+// 500 mm straight, then 90 deg left (BUILTIN_BEHAVIORS "leg")
+static std::vector<uint8_t> legProgram() {
+  Asm a;
+  a.in(Vm::X_MM).store(0).in(Vm::Y_MM).store(1).in(Vm::HEADING_CDEG).store(2);
+  a.push(50).push(50).op(Vm::DRIVE);
+  a.label("fwd").in(Vm::X_MM).load(0).op(Vm::SUB).op(Vm::DUP).op(Vm::MUL);
+  a.in(Vm::Y_MM).load(1).op(Vm::SUB).op(Vm::DUP).op(Vm::MUL).op(Vm::ADD);
+  a.push(250000).op(Vm::LT).jump(Vm::JZ, "turn").op(Vm::YIELD).jump(Vm::JMP, "fwd");
+  a.label("turn").push(-40).push(40).op(Vm::DRIVE);
+  a.label("spin").in(Vm::HEADING_CDEG).load(2).op(Vm::ANGDIFF).push(9000).op(Vm::LT);
+  a.jump(Vm::JZ, "done").op(Vm::YIELD).jump(Vm::JMP, "spin");
+  a.label("done").op(Vm::STOP).op(Vm::HALT);
+  return a.build();
+}
+
+// Neck sweep, waiting on NECK_BUSY between moves (BUILTIN_BEHAVIORS "scan")
+static std::vector<uint8_t> scanProgram() {
+  Asm a;
+  a.push(30).op(Vm::NECK).push(150).store(0);
+  a.label("wait").in(Vm::NECK_BUSY).jump(Vm::JZ, "next").op(Vm::YIELD).jump(Vm::JMP, "wait");
+  a.label("next").load(0).jump(Vm::JZ, "home").load(0).op(Vm::NECK).push(0).store(0).jump(Vm::JMP, "wait");
+  a.label("home").push(90).op(Vm::NECK).op(Vm::HALT);
+  return a.build();
+}
+
+// Worst case: a MUL/DIV/ANGDIFF loop with sensor reads that never yields, so every
+// tick runs the full instruction budget; ends after 2 s (T_MS)
+static std::vector<uint8_t> burnProgram() {
+  Asm a;
+  a.label("loop").in(Vm::HEADING_CDEG).in(Vm::T_MS).op(Vm::MUL).push(7).op(Vm::DIV);
+  a.load(0).op(Vm::ANGDIFF).store(0).load(1).push(1).op(Vm::ADD).store(1);
+  a.in(Vm::T_MS).push(2000).op(Vm::LT).jump(Vm::JNZ, "loop").op(Vm::HALT);
+  return a.build();
+}
+
+// ---- Plant + Io ----
+struct Robot {
+  Odometry odom;
+  int8_t left = 0;
+  int8_t right = 0;
+  uint32_t neckBusyUntil = 0;
+  uint32_t rttMs = 0;  // > 0: setpoints reach the wheels a round-trip later (remote decision)
+  struct Pending {
+    uint32_t atMs;
+    int8_t left;
+    int8_t right;
+  };
+  std::deque<Pending> inFlight;
+
+  void step(uint32_t now, uint32_t dtMs) {
+    while (!inFlight.empty() && (int32_t)(now - inFlight.front().atMs) >= 0) {
+      left = inFlight.front().left;
+      right = inFlight.front().right;
+      inFlight.pop_front();
+    }
+    odom.integrate((int16_t)(left * (int)ODOM_WHEEL_MM_S_MAX / 100), (int16_t)(right * (int)ODOM_WHEEL_MM_S_MAX / 100),
+                   dtMs);
+  }
+
+  static int32_t sense(void* ctx, uint8_t s) {
+    Robot& r = *static_cast<Robot*>(ctx);
+    switch (s) {
+      case Vm::X_MM: return r.odom.xMm();
+      case Vm::Y_MM: return r.odom.yMm();
+      case Vm::HEADING_CDEG: return r.odom.headingCdeg();
+      case Vm::V_MMS: return r.odom.vMmS();
+      case Vm::W_MRADS: return r.odom.wMradS();
+      case Vm::WHEEL_L: return r.left;
+      case Vm::WHEEL_R: return r.right;
+      case Vm::NECK_BUSY: return (int32_t)(millis() - r.neckBusyUntil) < 0;
+      default: return 0;
+    }
+  }
+  static void drive(void* ctx, int8_t l, int8_t rr) {
+    Robot& r = *static_cast<Robot*>(ctx);
+    r.inFlight.push_back({millis() + r.rttMs, l, rr});
+  }
+  static void servo(void* ctx, uint8_t op, uint8_t /*angle*/) {
+    Robot& r = *static_cast<Robot*>(ctx);
+    if (op == Vm::NECK) r.neckBusyUntil = millis() + 800;  // NeckDevice default move time
+  }
+};
+
+struct Result {
+  Vm::State state;
+  Vm::Error error;
+  Vm::Stats stats;
+  double avgTickNs;
+  double maxTickNs;
+  double nsPerInsn;
+  Robot robot;
+};
+
+static Result run(const std::vector<uint8_t>& code, uint32_t rttMs, uint32_t limitMs) {
+  static Vm vm;  // ~0.3 KB of fixed state, as in TaskRunner
+  Result res{};
+  res.robot.rttMs = rttMs;
+  uint16_t errPc = 0;
+  if (vm.load(code.data(), code.size(), errPc) != Vm::OK) {
+    res.state = vm.state();
+    res.error = vm.error();
+    return res;
+  }
+  g_simUs = 0;
+  vm.start(millis());
+  const Vm::Io io{&res.robot, &Robot::sense, &Robot::drive, &Robot::servo};
+  double totalNs = 0;
+  uint32_t timed = 0;
+  while (vm.active() && millis() < limitMs) {
+    g_simUs += WHEELS_TICK_MS * 1000;
+    const uint32_t now = millis();
+    res.robot.step(now, WHEELS_TICK_MS);
+    const auto t0 = std::chrono::steady_clock::now();
+    const uint16_t n = vm.tick(now, io);
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+    if (n) {
+      totalNs += ns;
+      timed++;
+      if (ns > res.maxTickNs) res.maxTickNs = ns;
+    }
+  }
+  // Setpoints still in flight (remote case) land before the pose is read
+  for (int i = 0; i < 20; ++i) {
+    g_simUs += WHEELS_TICK_MS * 1000;
+    res.robot.step(millis(), WHEELS_TICK_MS);
+  }
+  res.state = vm.state();
+  res.error = vm.error();
+  res.stats = vm.stats();
+  res.avgTickNs = timed ? totalNs / timed : 0;
+  res.nsPerInsn = res.stats.insns ? totalNs / res.stats.insns : 0;
+  return res;
+}
+
+static void printRun(const char* name, const std::vector<uint8_t>& code, const Result& r) {
+  const double ipt = r.stats.ticks ? (double)r.stats.insns / r.stats.ticks : 0;
+  printf("%-8s %4zuB %-8s %6u %7u %7.1f %4u/%-3u %8.0f %8.0f %6.1f\n", name, code.size(), Vm::stateName(r.state),
+         r.stats.ticks, r.stats.insns, ipt, r.stats.maxInsns, BEH_INSN_PER_TICK, r.avgTickNs, r.maxTickNs,
+         r.nsPerInsn);
+}
+
+// Verifier cases that must be rejected before anything runs
+static void verifierCases() {
+  struct Case {
+    const char* name;
+    std::vector<uint8_t> code;
+    Vm::Error expect;
+  };
+  Asm overflow;
+  for (int i = 0; i <= BEH_STACK; ++i) overflow.push(i);
+  overflow.op(Vm::HALT);
+  Asm mismatch;
+  mismatch.in(Vm::T_MS).jump(Vm::JZ, "j").push(1).label("j").op(Vm::HALT);
+  Asm intoOperand;
+  intoOperand.push(1000).op(Vm::DROP).op(Vm::HALT);
+  intoOperand.jump(Vm::JMP, "x");
+  std::vector<uint8_t> intoOperandCode = intoOperand.build();
+  intoOperandCode[intoOperandCode.size() - 2] = 1;  // inside the PUSH16 operand
+  const std::vector<Case> cases = {
+      {"underflow", {Vm::ADD, Vm::HALT}, Vm::STACK_UNDERFLOW},
+      {"overflow", overflow.build(), Vm::STACK_OVERFLOW},
+      {"mismatch", mismatch.build(), Vm::STACK_MISMATCH},
+      {"mid-insn", intoOperandCode, Vm::BAD_JUMP},
+      {"falls-off", {Vm::PUSH8, 1, Vm::DROP}, Vm::FALLS_OFF},
+      {"bad-op", {0xEE, Vm::HALT}, Vm::BAD_OP},
+      {"sensor", {Vm::IN, Vm::SENSOR_COUNT, Vm::HALT}, Vm::BAD_OPERAND},
+      {"truncated", {Vm::PUSH32, 1, 2}, Vm::BAD_OPERAND},
+      {"too-big", std::vector<uint8_t>(BEH_CODE_MAX + 1, Vm::YIELD), Vm::BAD_SIZE},
+  };
+  printf("\nverifier:\n");
+  int failed = 0;
+  for (const Case& c : cases) {
+    uint16_t pc = 0;
+    const auto t0 = std::chrono::steady_clock::now();
+    const Vm::Error e = Vm::verify(c.code.data(), c.code.size(), pc);
+    const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+    failed += e != c.expect;
+    printf("  %-10s %-16s pc=%-3u %5.2fus %s\n", c.name, Vm::errorName(e), pc, us, e == c.expect ? "ok" : "UNEXPECTED");
+  }
+
+  // Run-time fault: the only check left after verification
+  const std::vector<uint8_t> divZero = {Vm::PUSH8, 1, Vm::PUSH8, 0, Vm::DIV, Vm::DROP, Vm::HALT};
+  const Result r = run(divZero, 0, 1000);
+  failed += r.state != Vm::FAULT || r.error != Vm::DIV_ZERO;
+  printf("  %-10s %-16s (run time) %s\n", "div-zero", Vm::errorName(r.error),
+         r.state == Vm::FAULT && r.error == Vm::DIV_ZERO ? "ok" : "UNEXPECTED");
+  if (failed) {
+    printf("%d verifier case(s) failed\n", failed);
+    exit(1);
+  }
+}
+
+static std::vector<uint8_t> fromHex(const char* hex) {
+  std::vector<uint8_t> out;
+  for (size_t i = 0; hex[i] && hex[i + 1]; i += 2) out.push_back((uint8_t)strtoul(std::string(hex + i, 2).c_str(), nullptr, 16));
+  return out;
+}
+
+int main(int argc, char** argv) {
+  std::vector<uint32_t> rtts = {0, 60, 150};
+  const char* hex = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--verbose")) Serial.enabled = true;
+    else if (!strcmp(argv[i], "--hex") && i + 1 < argc) hex = argv[++i];
+    else if (!strcmp(argv[i], "--rtt") && i + 1 < argc) rtts = {0, (uint32_t)atoi(argv[++i])};
+    else {
+      fprintf(stderr, "usage: %s [--hex <bytecode>] [--rtt <ms>] [--verbose]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  printf("tick %ums, budget %u insns/tick, code %uB, stack %u, locals %u, VM state %zuB\n", (unsigned)WHEELS_TICK_MS,
+         BEH_INSN_PER_TICK, BEH_CODE_MAX, BEH_STACK, BEH_LOCALS, sizeof(Vm));
+  printf("\n%-8s %5s %-8s %6s %7s %7s %8s %8s %8s %6s\n", "program", "size", "end", "ticks", "insns", "ins/tk",
+         "max/tk", "avg ns", "max ns", "ns/in");
+
+  std::vector<std::pair<const char*, std::vector<uint8_t>>> programs;
+  if (hex) {
+    programs.push_back({"hex", fromHex(hex)});
+  } else {
+    programs.push_back({"leg", legProgram()});
+    programs.push_back({"scan", scanProgram()});
+    programs.push_back({"burn", burnProgram()});
+  }
+  for (const auto& p : programs) {
+    const Result r = run(p.second, 0, 60000);
+    if (r.state == Vm::EMPTY) {
+      uint16_t pc = 0;
+      Vm::verify(p.second.data(), p.second.size(), pc);
+      printf("%-8s rejected: %s at pc %u\n", p.first, Vm::errorName(r.error), pc);
+      continue;
+    }
+    printRun(p.first, p.second, r);
+  }
+
+  if (!hex) {
+    // Same leg decided a round-trip away: every setpoint lands rtt later
+    printf("\nleg (500 mm, 90 deg) decided on-device vs. remote:\n");
+    printf("  %-8s %8s %8s %10s\n", "rtt ms", "dist mm", "turn deg", "overshoot");
+    for (uint32_t rtt : rtts) {
+      const Result r = run(legProgram(), rtt, 60000);
+      // Pose after the run: straight leg along +x, then the turn
+      const double dist = r.robot.odom.xMm();
+      int32_t turn = r.robot.odom.headingCdeg();
+      if (turn > 18000) turn -= 36000;
+      printf("  %-8u %8.0f %8.1f %6.0fmm %+5.1fdeg\n", rtt, dist, turn / 100.0, dist - 500, turn / 100.0 - 90);
+    }
+    verifierCases();
+  }
+  return 0;
+}
@@ -0,0 +1,258 @@
+// firmware/bench/coroutine_bench.cpp
+// Host bench for the stackless coroutines: CoScheduler<TASK_COROUTINE_SLOTS> running
+// full slots of a few coroutine shapes against the same logic written as the
+// hand-rolled index/deadline state machines it replaces, called directly. Reports
+// host time per pass and per resume, the scheduler's share, and the fixed state
+// size. Also checks the wheels awaits (CO_AWAIT_TARGET, CO_AWAIT_BUS_IDLE)
+// against the real WheelsDevice. See README.md.
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include "../main/Coroutine.h"
+#include "../main/Config.h"
+#include "../main/DeviceTopology.h"
+
+// ---- Host runtime ----
+uint64_t g_simUs = 0;
+BenchSerial Serial;
+uint32_t GPO, GPOS, GPOC, GPES, GPEC, GPI;
+MeccaChannel::FrameSink MeccaChannel::sink = nullptr;
+uint32_t MeccaChannel::frameUs = 27000;
+
+static constexpr uint8_t SLOTS = TASK_COROUTINE_SLOTS;
+static constexpr uint32_t PASSES = 2000000;  // one pass per simulated ms
+static constexpr uint32_t TIMER_MS = 33;
+static constexpr uint8_t MACRO_STEPS = 8;
+static const uint16_t STEP_MS[MACRO_STEPS] = {300, 120, 450, 80, 200, 600, 150, 250};
+
+// Per-coroutine context; also holds the hand-rolled machine's state
+struct Ctx {
+  uint32_t events = 0;
+  uint8_t index = 0;
+  uint32_t deadline = 0;
+  uint32_t startMs = 0;
+  bool started = false;
+};
+
+// ---- Coroutine shapes ----
+static bool yieldCo(CoState& co, void* ctx, uint32_t /*now*/) {
+  Ctx* c = static_cast<Ctx*>(ctx);
+  CO_BEGIN(co);
+  while (true) {
+    c->events++;
+    CO_YIELD(co);
+  }
+  CO_END(co);
+}
+
+static bool timerCo(CoState& co, void* ctx, uint32_t now) {
+  Ctx* c = static_cast<Ctx*>(ctx);
+  CO_BEGIN(co);
+  while (true) {
+    CO_AWAIT_MS(co, now, TIMER_MS);
+    c->events++;
+  }
+  CO_END(co);
+}
+
+// Macro playback shape (TaskRunner::macroSequence): steps on absolute deadlines
+static bool macroCo(CoState& co, void* ctx, uint32_t now) {
+  Ctx* c = static_cast<Ctx*>(ctx);
+  CO_BEGIN(co);
+  c->deadline = now;
+  while (true) {
+    for (c->index = 0; c->index < MACRO_STEPS; ++c->index) {
+      c->events++;  // start step
+      c->deadline += STEP_MS[c->index];
+      CO_AWAIT_UNTIL(co, now, c->deadline);
+    }
+  }
+  CO_END(co);
+}
+
+// ---- Hand-rolled equivalents ----
+using Machine = void (*)(Ctx& c, uint32_t now);
+
+static void yieldSm(Ctx& c, uint32_t /*now*/) { c.events++; }
+
+static void timerSm(Ctx& c, uint32_t now) {
+  if (!c.started) {
+    c.started = true;
+    c.startMs = now;
+    return;
+  }
+  if (now - c.startMs < TIMER_MS) return;
+  c.events++;
+  c.startMs = now;
+}
+
+static void macroSm(Ctx& c, uint32_t now) {
+  if (!c.started) {
+    c.started = true;
+    c.index = 0;
+    c.deadline = now + STEP_MS[0];
+    c.events++;
+    return;
+  }
+  if ((int32_t)(now - c.deadline) < 0) return;
+  c.index = (c.index + 1) % MACRO_STEPS;
+  c.deadline += STEP_MS[c.index];
+  c.events++;
+}
+
+struct Shape {
+  const char* name;
+  CoScheduler<SLOTS>::CoFn co;
+  Machine sm;
+};
+
+static double nsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+// live = coroutines spawned (the rest of the slots stay empty)
+static bool runShape(const Shape& shape, uint8_t live) {
+  Ctx coCtx[SLOTS];
+  Ctx smCtx[SLOTS];
+
+  CoScheduler<SLOTS> sched;
+  for (uint8_t i = 0; i < live; ++i) sched.spawn(shape.co, &coCtx[i]);
+  g_simUs = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t t = 0; t < PASSES; ++t) {
+    g_simUs = (uint64_t)t * 1000;
+    sched.run(t);
+  }
+  const double coNs = nsSince(start);
+
+  // Same call pattern without the scheduler: one indirect call per machine per pass
+  volatile Machine sm = shape.sm;
+  start = std::chrono::steady_clock::now();
+  for (uint32_t t = 0; t < PASSES; ++t) {
+    for (uint8_t i = 0; i < live; ++i) sm(smCtx[i], t);
+  }
+  const double smNs = nsSince(start);
+
+  bool same = true;
+  for (uint8_t i = 0; i < live; ++i) {
+    // The coroutines count their first event on the first pass; the machines on arming
+    same &= coCtx[i].events == smCtx[i].events || coCtx[i].events == smCtx[i].events + 1;
+  }
+
+  const double resumes = (double)PASSES * live;
+  printf("%-7s %4u %9.1f %9.1f %9.2f %9.2f %8.2f %10u %-4s\n", shape.name, live, coNs / PASSES, smNs / PASSES,
+         live ? coNs / resumes : 0.0, live ? smNs / resumes : 0.0, live ? (coNs - smNs) / resumes : 0.0,
+         (unsigned)sched.resumes(), same ? "ok" : "DIFF");
+  return same && sched.resumes() == (uint32_t)resumes;
+}
+
+// ---- Wheels awaits ----
+// A ramp sequence on a real WheelsDevice: set a target, wait for the slew ramp
+// (CO_AWAIT_TARGET), then for the command to be on the bus (CO_AWAIT_BUS_IDLE).
+// The same sequence as a hand-rolled machine polling the predicates must wake on
+// the same ms; on every wake both predicates must hold.
+static constexpr uint8_t RAMPS = 5;
+static const int8_t RAMP_TARGET[RAMPS][2] = {{60, 60}, {-40, 40}, {0, 0}, {100, -100}, {0, 0}};
+static constexpr uint32_t RAMP_LIMIT_MS = 60000;
+
+struct RampCtx {
+  WheelsDevice* wheels;
+  uint8_t index = 0;
+  bool waiting = false;
+  std::vector<uint32_t> wakeMs;
+  bool ok = true;
+};
+
+static void rampWake(RampCtx& c, uint32_t now) {
+  c.ok &= c.wheels->targetReached() && c.wheels->busIdle();
+  c.wakeMs.push_back(now);
+}
+
+static bool rampCo(CoState& co, void* ctx, uint32_t now) {
+  RampCtx* c = static_cast<RampCtx*>(ctx);
+  CO_BEGIN(co);
+  for (c->index = 0; c->index < RAMPS; ++c->index) {
+    c->wheels->setTarget(RAMP_TARGET[c->index][0], RAMP_TARGET[c->index][1]);
+    CO_AWAIT_TARGET(co, *c->wheels);
+    CO_AWAIT_BUS_IDLE(co, *c->wheels);
+    rampWake(*c, now);
+  }
+  CO_END(co);
+}
+
+static bool rampSm(RampCtx& c, uint32_t now) {
+  if (c.index >= RAMPS) return true;
+  if (!c.waiting) {
+    c.wheels->setTarget(RAMP_TARGET[c.index][0], RAMP_TARGET[c.index][1]);
+    c.waiting = true;
+  }
+  if (!c.wheels->targetReached() || !c.wheels->busIdle()) return false;
+  rampWake(c, now);
+  c.waiting = false;
+  return ++c.index >= RAMPS;
+}
+
+// One wheels loop per simulated ms (tick every WHEELS_TICK_MS, keepalive like a macro)
+template <typename Step>
+static std::vector<uint32_t> runRamps(RampCtx& c, Step step) {
+  static const MaxPortInfo ports[2] = {WheelsLeftPort::info, WheelsRightPort::info};
+  g_simUs = 0;
+  WheelsDevice wheels;
+  wheels.begin(ports, 2);
+  c.wheels = &wheels;
+  uint32_t lastTick = 0;
+  while (millis() < RAMP_LIMIT_MS) {
+    const uint32_t now = millis();
+    if (now - lastTick >= WHEELS_TICK_MS) {
+      lastTick = now;
+      wheels.tick(now);
+    }
+    wheels.keepAlive(now);
+    if (step(now)) break;
+    g_simUs = (g_simUs / 1000 + 1) * 1000;
+  }
+  return c.wakeMs;
+}
+
+static bool runWheelsAwaits() {
+  RampCtx coCtx;
+  CoScheduler<1> sched;
+  const int8_t id = sched.spawn(&rampCo, &coCtx);
+  const std::vector<uint32_t> coWake = runRamps(coCtx, [&](uint32_t now) {
+    sched.run(now);
+    return !sched.alive(id);
+  });
+  RampCtx smCtx;
+  const std::vector<uint32_t> smWake = runRamps(smCtx, [&](uint32_t now) { return rampSm(smCtx, now); });
+
+  printf("\nwheels awaits: %-6s %9s %9s\n", "target", "co ms", "sm ms");
+  for (uint8_t i = 0; i < RAMPS; ++i) {
+    printf("              %4d/%-4d %9ld %9ld\n", RAMP_TARGET[i][0], RAMP_TARGET[i][1],
+           i < coWake.size() ? (long)coWake[i] : -1L, i < smWake.size() ? (long)smWake[i] : -1L);
+  }
+  const bool ok = coCtx.ok && smCtx.ok && coWake.size() == RAMPS && coWake == smWake;
+  printf("%s\n", ok ? "ok" : "DIFF (woke early, never or at different ms)");
+  return ok;
+}
+
+int main() {
+  const Shape shapes[] = {
+      {"yield", &yieldCo, &yieldSm},
+      {"timer", &timerCo, &timerSm},
+      {"macro", &macroCo, &macroSm},
+  };
+
+  printf("CoState %zu B, CoScheduler<%u> %zu B, %u passes\n\n", sizeof(CoState), SLOTS,
+         sizeof(CoScheduler<SLOTS>), (unsigned)PASSES);
+  printf("%-7s %4s %9s %9s %9s %9s %8s %10s %-4s\n", "shape", "live", "co ns/ps", "sm ns/ps", "co ns/rs",
+         "sm ns/rs", "ovh ns", "resumes", "");
+  bool ok = true;
+  ok &= runShape(shapes[0], 0);
+  for (const Shape& s : shapes) {
+    ok &= runShape(s, 1);
+    ok &= runShape(s, SLOTS);
+  }
+  ok &= runWheelsAwaits();
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,633 @@
+// firmware/bench/fleet_load.cpp
+// Fleet load generator: emulates many ESP clients against a running server.
+// Each client speaks the firmware protocol (hello, cumulative flow ack, pong,
+// link probes, odom heartbeat) built with the firmware's own Protocol.h,
+// JsonWriter and FrameScanner. One emulated UI drives through DriveRelay;
+// every accepted ESP timestamps the commands it receives. See README.md.
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+#include "../main/Config.h"
+#include "../main/FrameScanner.h"
+#include "../main/JsonWriter.h"
+#include "../main/Protocol.h"
+
+// ---- Host runtime ----
+uint64_t g_simUs = 0;  // unused: the shared shim's clock (JsonWriter/FrameScanner never read it)
+BenchSerial Serial;
+
+static uint64_t nowUs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000u + ts.tv_nsec / 1000;
+}
+
+struct Options {
+  std::string host = "127.0.0.1";
+  uint16_t port = 8080;
+  unsigned clients = 100;
+  double rampPerSec = 50;   // connection attempts/s (0 = all at once)
+  double driveHz = 20;      // UI drive intents/s
+  unsigned stopEvery = 10;  // every Nth intent returns the stick to zero
+  double durationS = 10;    // drive phase, after the ramp
+  int serverPid = 0;        // /proc/<pid>/stat CPU sampling
+};
+
+static Options g_opt;
+
+// ---- Minimal RFC 6455 client (non-blocking, masked client frames) ----
+class WsConn {
+public:
+  enum State { CONNECTING, HANDSHAKE, OPEN, CLOSED };
+  State state = CLOSED;
+  int fd = -1;
+  std::string closeReason;
+
+  bool open(const sockaddr_in& addr, const char* userAgent) {
+    fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (fd < 0) return false;
+    const int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(fd, (const sockaddr*)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS) {
+      fail("connect failed");
+      return false;
+    }
+    ua_ = userAgent;
+    state = CONNECTING;
+    return true;
+  }
+
+  short events() const {
+    if (state == CLOSED) return 0;
+    return POLLIN | ((state == CONNECTING || !tx_.empty()) ? POLLOUT : 0);
+  }
+
+  void sendText(const char* data, size_t len) { frame(0x1, data, len); }
+  void sendBinary(const void* data, size_t len) { frame(0x2, data, len); }
+
+  // Drives the connection; onFrame(opcode, payload, len) per text/binary frame.
+  // Returns true once when the upgrade completes.
+  template <typename F>
+  bool service(short revents, F&& onFrame) {
+    bool upgraded = false;
+    if (state == CONNECTING && (revents & (POLLOUT | POLLERR | POLLHUP))) {
+      int err = 0;
+      socklen_t len = sizeof(err);
+      getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len);
+      if (err) {
+        fail(strerror(err));
+        return false;
+      }
+      state = HANDSHAKE;
+      requestUpgrade();
+    }
+    if (revents & POLLIN) {
+      char buf[16384];
+      bool eof = false;
+      for (;;) {
+        const ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n > 0) {
+          rx_.append(buf, (size_t)n);
+          continue;
+        }
+        if (n == 0) eof = true;
+        else if (errno != EAGAIN && errno != EWOULDBLOCK) eof = true;
+        break;
+      }
+      if (state == HANDSHAKE) {
+        const size_t end = rx_.find("\r\n\r\n");
+        if (end != std::string::npos) {
+          if (rx_.compare(0, 12, "HTTP/1.1 101") != 0) {
+            fail("upgrade refused");
+            return false;
+          }
+          rx_.erase(0, end + 4);
+          state = OPEN;
+          upgraded = true;
+        }
+      }
+      if (state == OPEN) parseFrames(onFrame);
+      if (eof) fail("closed by server");  // after the frames that came with it (close reason)
+    }
+    if (state != CLOSED && state != CONNECTING) flush();
+    return upgraded;
+  }
+
+  void close() {
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+    state = CLOSED;
+  }
+
+private:
+  std::string ua_;
+  std::string rx_;
+  std::string tx_;
+
+  void fail(const char* why) {
+    if (closeReason.empty()) closeReason = why;
+    close();
+  }
+
+  void requestUpgrade() {
+    uint8_t key[16];
+    for (uint8_t& b : key) b = (uint8_t)rand();
+    char req[512];
+    snprintf(req, sizeof(req),
+             "GET /robot HTTP/1.1\r\nHost: %s:%u\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+             "Sec-WebSocket-Key: %s\r\nSec-WebSocket-Version: 13\r\nUser-Agent: %s\r\n\r\n",
+             g_opt.host.c_str(), g_opt.port, base64(key, sizeof(key)).c_str(), ua_.c_str());
+    tx_.append(req);
+    flush();
+  }
+
+  void frame(uint8_t opcode, const void* data, size_t len) {
+    if (state != OPEN) return;
+    uint8_t hdr[14];
+    size_t h = 0;
+    hdr[h++] = 0x80 | opcode;
+    if (len < 126) {
+      hdr[h++] = 0x80 | (uint8_t)len;
+    } else {
+      hdr[h++] = 0x80 | 126;
+      hdr[h++] = (uint8_t)(len >> 8);
+      hdr[h++] = (uint8_t)len;
+    }
+    const uint8_t mask[4] = {(uint8_t)rand(), (uint8_t)rand(), (uint8_t)rand(), (uint8_t)rand()};
+    memcpy(hdr + h, mask, 4);
+    h += 4;
+    tx_.append((const char*)hdr, h);
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t i = 0; i < len; ++i) tx_.push_back((char)(p[i] ^ mask[i & 3]));
+    flush();
+  }
+
+  void flush() {
+    while (!tx_.empty() && fd >= 0) {
+      const ssize_t n = send(fd, tx_.data(), tx_.size(), MSG_NOSIGNAL);
+      if (n > 0) {
+        tx_.erase(0, (size_t)n);
+      } else {
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) fail(strerror(errno));
+        return;
+      }
+    }
+  }
+
+  // Server frames are unmasked and unfragmented (ws sends whole messages)
+  template <typename F>
+  void parseFrames(F&& onFrame) {
+    for (;;) {
+      if (rx_.size() < 2) return;
+      const uint8_t* p = (const uint8_t*)rx_.data();
+      const uint8_t opcode = p[0] & 0x0F;
+      uint64_t len = p[1] & 0x7F;
+      size_t h = 2;
+      if (len == 126) {
+        if (rx_.size() < 4) return;
+        len = ((uint64_t)p[2] << 8) | p[3];
+        h = 4;
+      } else if (len == 127) {
+        if (rx_.size() < 10) return;
+        len = 0;
+        for (int i = 0; i < 8; ++i) len = (len << 8) | p[2 + i];
+        h = 10;
+      }
+      if (rx_.size() < h + len) return;
+      const uint8_t* payload = p + h;
+      if (opcode == 0x8) {  // close: 2-byte code + reason
+        closeReason = len > 2 ? std::string((const char*)payload + 2, len - 2) : "close";
+        close();
+        return;
+      }
+      if (opcode == 0x9) frame(0xA, payload, len);  // ping -> pong (server heartbeat)
+      else if (opcode == 0x1 || opcode == 0x2) onFrame(opcode, payload, (size_t)len);
+      rx_.erase(0, h + len);
+      if (state != OPEN) return;
+    }
+  }
+
+  static std::string base64(const uint8_t* d, size_t n) {
+    static const char* tbl = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < n; i += 3) {
+      const uint32_t v = (d[i] << 16) | (i + 1 < n ? d[i + 1] << 8 : 0) | (i + 2 < n ? d[i + 2] : 0);
+      out += tbl[(v >> 18) & 63];
+      out += tbl[(v >> 12) & 63];
+      out += i + 1 < n ? tbl[(v >> 6) & 63] : '=';
+      out += i + 2 < n ? tbl[v & 63] : '=';
+    }
+    return out;
+  }
+};
+
+// ---- Tiny field readers for server envelopes (flat JSON, no escapes needed) ----
+static bool readString(const uint8_t* p, size_t len, const char* key, char* out, size_t cap) {
+  char pat[32];
+  snprintf(pat, sizeof(pat), "\"%s\":\"", key);
+  const void* at = memmem(p, len, pat, strlen(pat));
+  if (!at) return false;
+  const char* s = (const char*)at + strlen(pat);
+  size_t i = 0;
+  while (s < (const char*)p + len && *s != '"' && i + 1 < cap) out[i++] = *s++;
+  out[i] = '\0';
+  return true;
+}
+
+static bool readUint(const uint8_t* p, size_t len, const char* key, uint32_t& out) {
+  char pat[32];
+  snprintf(pat, sizeof(pat), "\"%s\":", key);
+  const void* at = memmem(p, len, pat, strlen(pat));
+  if (!at) return false;
+  out = (uint32_t)strtoul((const char*)at + strlen(pat), nullptr, 10);
+  return true;
+}
+
+// ---- Latency samples ----
+struct Samples {
+  std::vector<double> ms;
+  void add(uint64_t us) { ms.push_back(us / 1000.0); }
+  double pct(double p) {
+    if (ms.empty()) return 0;
+    std::sort(ms.begin(), ms.end());
+    return ms[std::min(ms.size() - 1, (size_t)(p / 100.0 * ms.size()))];
+  }
+  void print(const char* name) {
+    if (ms.empty()) {
+      printf("[FLEET] %-18s n=0\n", name);
+      return;
+    }
+    printf("[FLEET] %-18s n=%-6zu p50 %7.1f ms  p99 %7.1f ms  max %7.1f ms\n", name, ms.size(), pct(50), pct(99),
+           pct(100));
+  }
+};
+
+// UI intents: send time per seq (seq 1..n), stop intents marked
+struct IntentLog {
+  std::vector<uint64_t> sentUs{0};
+  std::vector<bool> stop{false};
+};
+static IntentLog g_intents;
+
+static Samples g_handshake;   // TCP connect start -> 101
+static Samples g_helloRtt;    // 101 -> server hello
+static Samples g_drive;       // UI intent -> first task.replace carrying seq >= it
+static Samples g_stop;        // UI zero intent -> binary stop frame
+static Samples g_probe;       // ESP probe -> server echo
+static std::map<std::string, unsigned> g_closeReasons;
+
+// ---- Emulated ESP ----
+struct EspClient {
+  WsConn ws;
+  unsigned id = 0;
+  uint64_t startUs = 0;
+  uint64_t openUs = 0;
+  bool accepted = false;
+  uint32_t msgSeq = 0;
+  uint32_t lastDriveSeq = 0;  // newest UI seq seen in a drive task
+  size_t nextStop = 1;        // first stop intent not yet matched
+  uint16_t probeId = 0;
+  uint64_t probeSentUs = 0;
+  uint64_t nextProbeUs = 0;
+  uint64_t nextOdomUs = 0;
+  char tx[512];
+
+  JsonWriter begin(const char* kind) {
+    JsonWriter json(tx, sizeof(tx));
+    json.beginObject();
+    json.add("kind", kind);
+    return json;
+  }
+  void send(JsonWriter& json) {
+    json.add("seq", ++msgSeq);
+    json.endObject();
+    if (json.ok()) ws.sendText(json.data(), json.length());
+  }
+
+  // Same fields as NetClient::sendHello (JSON telemetry, no UDP channel)
+  void sendHello() {
+    char espId[12];
+    snprintf(espId, sizeof(espId), "f%07x", id);
+    JsonWriter json = begin(Protocol::CMD_HELLO);
+    json.add("espId", espId);
+    json.add("fw", "fleet-load/1.0");
+    json.add("rssi", -55);
+    json.add("ip", "127.0.0.1");
+    json.add("win", TASK_QUEUE_CAPACITY);
+    json.add("lease", LEASE_MAX_TTL_MS);
+    json.add("tlm", 0);
+    json.beginArray("macros");
+    for (uint8_t i = 0; i < MACRO_SLOTS; ++i) json.item(0);
+    json.endArray();
+    send(json);
+  }
+
+  void onText(const uint8_t* p, size_t len, uint64_t now) {
+    char kind[24] = "";
+    readString(p, len, "kind", kind, sizeof(kind));
+    if (!strcmp(kind, Protocol::CMD_HELLO)) {
+      if (!accepted) g_helloRtt.add(now - openUs);
+      accepted = true;
+      sendHello();
+      nextProbeUs = now + LINK_PROBE_MS * 1000;
+      nextOdomUs = now + ODOM_IDLE_STREAM_MS * 1000;
+      return;
+    }
+    if (!strcmp(kind, Protocol::CMD_PROBE)) {
+      uint32_t echo = 0;
+      if (readUint(p, len, "id", echo) && echo == probeId && probeSentUs) g_probe.add(now - probeSentUs);
+      probeSentUs = 0;
+      return;
+    }
+    if (!strcmp(kind, Protocol::CMD_PING)) {
+      uint32_t t = 0;
+      readUint(p, len, "t", t);
+      JsonWriter json = begin(Protocol::RESP_PONG);
+      json.add("t", t);
+      send(json);
+      return;
+    }
+    if (!strncmp(kind, "task.", 5)) {
+      // Drive tasks from DeviceAdapter are named drive-seq<N> (UI intent seq)
+      char taskId[48];
+      if (FrameScanner::isLastWinsDrive(p, len) && readString(p, len, "taskId", taskId, sizeof(taskId)) &&
+          !strncmp(taskId, "drive-seq", 9)) {
+        const uint32_t seq = (uint32_t)strtoul(taskId + 9, nullptr, 10);
+        for (uint32_t s = lastDriveSeq + 1; s <= seq && s < g_intents.sentUs.size(); ++s) {
+          if (!g_intents.stop[s]) g_drive.add(now - g_intents.sentUs[s]);
+        }
+        if (seq > lastDriveSeq) lastDriveSeq = seq;
+      }
+      // Cumulative flow ack, queue always drained (the emulated wheels are instant)
+      uint32_t seq = 0;
+      if (readUint(p, len, "seq", seq)) {
+        JsonWriter json = begin(Protocol::RESP_ACK);
+        json.add("ack", seq);
+        json.add("win", TASK_QUEUE_CAPACITY);
+        send(json);
+      }
+    }
+  }
+
+  void onBinary(const uint8_t* p, size_t len, uint64_t now) {
+    if (FrameScanner::scanStopBinary(p, len) != FrameScanner::Stop::BINARY) return;
+    // Match the oldest unmatched stop intent already sent
+    while (nextStop < g_intents.stop.size() && !g_intents.stop[nextStop]) ++nextStop;
+    if (nextStop < g_intents.stop.size()) g_stop.add(now - g_intents.sentUs[nextStop++]);
+  }
+
+  // Periodic traffic a parked ESP sends: link probe + odom heartbeat
+  void poll(uint64_t now) {
+    if (!accepted || ws.state != WsConn::OPEN) return;
+    if (now >= nextProbeUs) {
+      JsonWriter json = begin(Protocol::RESP_PROBE);
+      json.add("id", ++probeId);
+      json.add("t", (uint32_t)(now / 1000));
+      json.endObject();
+      if (json.ok()) ws.sendText(json.data(), json.length());
+      probeSentUs = now;
+      nextProbeUs = now + LINK_PROBE_MS * 1000;
+    }
+    if (now >= nextOdomUs) {
+      JsonWriter json = begin(Protocol::RESP_ODOM);
+      json.add("x", 0);
+      json.add("y", 0);
+      json.add("th", 0);
+      json.add("v", 0);
+      json.add("w", 0);
+      json.add("ep", 0);
+      json.add("t", (uint32_t)(now / 1000));
+      send(json);
+      nextOdomUs = now + ODOM_IDLE_STREAM_MS * 1000;
+    }
+  }
+};
+
+// ---- Emulated UI (DriveRelay client) ----
+struct UiDriver {
+  WsConn ws;
+  bool ready = false;
+  uint32_t seq = 0;
+  uint64_t nextUs = 0;
+
+  void onOpen() {
+    static const char hello[] = "{\"type\":\"hello\",\"role\":\"ui\",\"version\":\"fleet-load\"}";
+    ws.sendText(hello, sizeof(hello) - 1);
+    ready = true;
+  }
+
+  // Stick sweeps (never the same value twice in a row), back to zero every stopEvery
+  void poll(uint64_t now, uint64_t t0) {
+    if (!ready || ws.state != WsConn::OPEN || now < nextUs) return;
+    nextUs = (nextUs ? nextUs : now) + (uint64_t)(1e6 / g_opt.driveHz);
+    ++seq;
+    const bool stop = g_opt.stopEvery && seq % g_opt.stopEvery == 0;
+    const double v = stop ? 0.0 : 0.3 + 0.05 * (seq % 10);
+    char msg[128];
+    const int n = snprintf(msg, sizeof(msg), "{\"type\":\"drive\",\"left\":%.2f,\"right\":%.2f,\"seq\":%u,\"ts\":%u}",
+                           v, -v, seq, (unsigned)((now - t0) / 1000));
+    g_intents.sentUs.push_back(now);
+    g_intents.stop.push_back(stop);
+    ws.sendText(msg, (size_t)n);
+  }
+};
+
+// ---- Server CPU (/proc/<pid>/stat utime + stime) ----
+static bool readCpuTicks(int pid, uint64_t& ticks) {
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+  FILE* f = fopen(path, "r");
+  if (!f) return false;
+  char buf[1024];
+  const size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+  fclose(f);
+  buf[n] = '\0';
+  const char* p = strrchr(buf, ')');  // comm may contain spaces
+  if (!p) return false;
+  unsigned long utime = 0, stime = 0;
+  // fields after ")": state(3) ... utime(14) stime(15)
+  if (sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2) return false;
+  ticks = utime + stime;
+  return true;
+}
+
+static void usage() {
+  fprintf(stderr,
+          "usage: fleet_load [--host 127.0.0.1] [--port 8080] [--clients 100] [--ramp 50]\n"
+          "                  [--rate 20] [--stop-every 10] [--duration 10] [--server-pid PID] [--verbose]\n");
+}
+
+int main(int argc, char** argv) {
+  for (int i = 1; i < argc; ++i) {
+    const char* a = argv[i];
+    const bool hasVal = i + 1 < argc;
+    if (!strcmp(a, "--host") && hasVal) g_opt.host = argv[++i];
+    else if (!strcmp(a, "--port") && hasVal) g_opt.port = (uint16_t)atoi(argv[++i]);
+    else if (!strcmp(a, "--clients") && hasVal) g_opt.clients = (unsigned)atoi(argv[++i]);
+    else if (!strcmp(a, "--ramp") && hasVal) g_opt.rampPerSec = atof(argv[++i]);
+    else if (!strcmp(a, "--rate") && hasVal) g_opt.driveHz = atof(argv[++i]);
+    else if (!strcmp(a, "--stop-every") && hasVal) g_opt.stopEvery = (unsigned)atoi(argv[++i]);
+    else if (!strcmp(a, "--duration") && hasVal) g_opt.durationS = atof(argv[++i]);
+    else if (!strcmp(a, "--server-pid") && hasVal) g_opt.serverPid = atoi(argv[++i]);
+    else if (!strcmp(a, "--verbose")) Serial.enabled = true;
+    else {
+      usage();
+      return 2;
+    }
+  }
+  if (g_opt.driveHz <= 0) g_opt.driveHz = 1;
+
+  addrinfo hints{};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* res = nullptr;
+  if (getaddrinfo(g_opt.host.c_str(), nullptr, &hints, &res) != 0 || !res) {
+    fprintf(stderr, "cannot resolve %s\n", g_opt.host.c_str());
+    return 1;
+  }
+  sockaddr_in addr = *(sockaddr_in*)res->ai_addr;
+  addr.sin_port = htons(g_opt.port);
+  freeaddrinfo(res);
+
+  printf("[FLEET] %u ESP clients -> ws://%s:%u/robot, ramp %.0f/s, UI drive %.0f Hz for %.0f s\n", g_opt.clients,
+         g_opt.host.c_str(), g_opt.port, g_opt.rampPerSec, g_opt.driveHz, g_opt.durationS);
+
+  std::vector<EspClient> esps(g_opt.clients);
+  for (unsigned i = 0; i < esps.size(); ++i) esps[i].id = i + 1;
+  UiDriver ui;
+
+  const uint64_t t0 = nowUs();
+  const uint64_t rampUs = g_opt.rampPerSec > 0 ? (uint64_t)(1e6 / g_opt.rampPerSec) : 0;
+  unsigned started = 0;
+  uint64_t lastOpenUs = t0;
+  uint64_t driveStartUs = 0;
+  uint64_t driveEndUs = 0;
+  uint64_t cpuTicks0 = 0, cpuTicksLast = 0, cpuSampleUs = 0;
+  double cpuMaxPct = 0;
+  const bool cpu = g_opt.serverPid > 0 && readCpuTicks(g_opt.serverPid, cpuTicks0);
+  cpuTicksLast = cpuTicks0;
+  cpuSampleUs = t0;
+  const long hz = sysconf(_SC_CLK_TCK);
+
+  std::vector<pollfd> fds;
+  std::vector<int> owner;  // index into esps, -1 = UI
+  for (;;) {
+    const uint64_t now = nowUs();
+
+    // Connection ramp, then the UI once every attempt has resolved
+    while (started < esps.size() && (!rampUs || now >= t0 + started * rampUs)) {
+      EspClient& c = esps[started++];
+      c.startUs = now;
+      c.ws.open(addr, "arduino-WebSocket-Client");
+    }
+    bool pending = started < esps.size();
+    for (const EspClient& c : esps) pending |= c.ws.state == WsConn::CONNECTING || c.ws.state == WsConn::HANDSHAKE ||
+                                               (c.ws.state == WsConn::OPEN && !c.accepted && now - c.openUs < 2000000);
+    if (!pending && !driveStartUs) {
+      driveStartUs = now;
+      driveEndUs = now + (uint64_t)(g_opt.durationS * 1e6);
+      ui.ws.open(addr, "Mozilla/5.0 (fleet-load UI)");
+    }
+    if (driveEndUs && now >= driveEndUs + 1000000) break;  // 1 s drain
+
+    if (driveEndUs && now < driveEndUs) ui.poll(now, t0);
+    for (EspClient& c : esps) c.poll(now);
+
+    if (cpu && now - cpuSampleUs >= 1000000) {
+      uint64_t ticks = 0;
+      if (readCpuTicks(g_opt.serverPid, ticks)) {
+        const double pct = 100.0 * (ticks - cpuTicksLast) / hz / ((now - cpuSampleUs) / 1e6);
+        if (pct > cpuMaxPct) cpuMaxPct = pct;
+        cpuTicksLast = ticks;
+      }
+      cpuSampleUs = now;
+    }
+
+    fds.clear();
+    owner.clear();
+    for (unsigned i = 0; i < esps.size(); ++i) {
+      if (esps[i].ws.events()) {
+        fds.push_back({esps[i].ws.fd, esps[i].ws.events(), 0});
+        owner.push_back((int)i);
+      }
+    }
+    if (ui.ws.events()) {
+      fds.push_back({ui.ws.fd, ui.ws.events(), 0});
+      owner.push_back(-1);
+    }
+    poll(fds.data(), fds.size(), 2);
+
+    const uint64_t t = nowUs();
+    for (size_t k = 0; k < fds.size(); ++k) {
+      if (!fds[k].revents) continue;
+      if (owner[k] < 0) {
+        if (ui.ws.service(fds[k].revents, [](uint8_t, const uint8_t*, size_t) {})) ui.onOpen();
+        continue;
+      }
+      EspClient& c = esps[owner[k]];
+      const bool upgraded = c.ws.service(fds[k].revents, [&](uint8_t op, const uint8_t* p, size_t len) {
+        if (op == 0x1) c.onText(p, len, t);
+        else c.onBinary(p, len, t);
+      });
+      if (upgraded) {
+        c.openUs = t;
+        lastOpenUs = t;
+        g_handshake.add(t - c.startUs);
+      }
+      if (c.ws.state == WsConn::CLOSED) {
+        g_closeReasons[c.ws.closeReason]++;
+        if (Serial.enabled) printf("[FLEET] esp %u closed: %s\n", c.id, c.ws.closeReason.c_str());
+      }
+    }
+  }
+
+  unsigned accepted = 0, open = 0;
+  for (const EspClient& c : esps) {
+    accepted += c.accepted;
+    open += c.accepted && c.ws.state == WsConn::OPEN;
+  }
+  const double rampS = (lastOpenUs - t0) / 1e6;
+  printf("[FLEET] connect: %u attempted, %u upgraded, %u accepted (hello), %u still open at end\n", g_opt.clients,
+         (unsigned)g_handshake.ms.size(), accepted, open);
+  printf("[FLEET] connect rate %.1f upgrades/s over %.2f s\n", rampS > 0 ? g_handshake.ms.size() / rampS : 0.0,
+         rampS);
+  for (const auto& r : g_closeReasons) printf("[FLEET]   closed x%-5u %s\n", r.second, r.first.c_str());
+  g_handshake.print("ws upgrade");
+  g_helloRtt.print("server hello");
+
+  unsigned sent = 0, stops = 0;
+  for (size_t s = 1; s < g_intents.stop.size(); ++s) {
+    sent++;
+    stops += g_intents.stop[s];
+  }
+  printf("[FLEET] UI sent %u intents (%u stops); fan-out to %u ESP(s)\n", sent, stops, open);
+  g_drive.print("drive fan-out");
+  g_stop.print("stop fan-out");
+  g_probe.print("probe echo");
+  if (cpu) {
+    uint64_t ticks = cpuTicksLast;
+    readCpuTicks(g_opt.serverPid, ticks);
+    printf("[FLEET] server cpu avg %.1f%%  max 1s %.1f%%\n",
+           100.0 * (ticks - cpuTicks0) / hz / ((nowUs() - t0) / 1e6), cpuMaxPct);
+  }
+
+  for (EspClient& c : esps) c.ws.close();
+  ui.ws.close();
+  return 0;
+}
@@ -0,0 +1,64 @@
+// firmware/bench/host/Arduino.h
+#pragma once
+// Minimal Arduino/ESP8266 surface for building device code on the host bench.
+// Time is simulated: the bench advances g_simUs, millis()/micros() read it.
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using String = std::string;
+
+extern uint64_t g_simUs;
+inline uint32_t millis() { return (uint32_t)(g_simUs / 1000); }
+inline uint32_t micros() { return (uint32_t)g_simUs; }
+inline void yield() {}
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+using std::abs;
+using std::max;
+using std::min;
+using std::round;
+
+struct BenchSerial {
+  bool enabled = false;  // --verbose
+  int printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+    if (!enabled) return 0;
+    va_list ap;
+    va_start(ap, fmt);
+    const int n = vprintf(fmt, ap);
+    va_end(ap);
+    return n;
+  }
+  void println(const char* s) {
+    if (enabled) puts(s);
+  }
+};
+extern BenchSerial Serial;
+
+// GPIO / timer1 / GPO register surface used by MaxBus.cpp. Register writes are plain
+// stores; timer1 keeps the attached ISR and the last one-shot reload so a bench can
+// step the ISR itself (maxbus_bench).
+#define IRAM_ATTR
+#define OUTPUT 1
+#define HIGH 1
+#define LOW 0
+#define D4 2
+#define TIM_DIV16 1
+#define TIM_EDGE 0
+#define TIM_SINGLE 0
+extern uint32_t GPO, GPOS, GPOC, GPES, GPEC, GPI;
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline void noInterrupts() {}
+inline void interrupts() {}
+inline void timer1_isr_init() {}
+inline void (*g_timer1Isr)() = nullptr;
+inline uint32_t g_timer1Ticks = 0;  // pending one-shot reload, 0 = not armed
+inline void timer1_attachInterrupt(void (*isr)()) { g_timer1Isr = isr; }
+inline void timer1_enable(uint8_t, uint8_t, uint8_t) {}
+inline void timer1_write(uint32_t ticks) { g_timer1Ticks = ticks; }
@@ -0,0 +1,20 @@
+// firmware/bench/host/MeccaChannel.h
+#pragma once
+#include <Arduino.h>
+
+// Bench stand-in for the MeccaChannel library: a frame blocks for the wire time
+// (the sim clock advances) and is then handed to the motor plant.
+class MeccaChannel {
+public:
+  using FrameSink = void (*)(uint8_t b0, uint8_t b1, uint8_t b2, uint8_t b3);
+  static FrameSink sink;
+  static uint32_t frameUs;
+
+  explicit MeccaChannel(int) {}
+  void communicate() {}
+  uint8_t communicateAllByte(uint8_t b0, uint8_t b1, uint8_t b2, uint8_t b3) {
+    g_simUs += frameUs;
+    if (sink) sink(b0, b1, b2, b3);
+    return 0;
+  }
+};
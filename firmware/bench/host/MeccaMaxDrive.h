@@ -0,0 +1,3 @@
+// firmware/bench/host/MeccaMaxDrive.h
+#pragma once
+#include "MeccaChannel.h"
@@ -0,0 +1,223 @@
+// firmware/bench/json_bench.cpp
+// Byte-identity check of JsonWriter against ArduinoJson: every case is one envelope
+// function run through both (JsonWriter, and a JsonDocument + serializeJson() the
+// way NetClient built envelopes before), so the insertion order is the same by
+// construction. Reports size and host encode time of both. See README.md.
+#include <ArduinoJson.h>
+
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+
+#include "../main/JsonWriter.h"
+
+// ---- Host runtime ----
+uint64_t g_simUs = 0;
+BenchSerial Serial;
+
+static constexpr size_t TX_BUFFER_SIZE = 512;  // NetClient::TX_BUFFER_SIZE
+static constexpr int TIMING_RUNS = 100000;
+
+// JsonWriter's member interface over a JsonDocument
+class DocOut {
+public:
+  explicit DocOut(JsonDocument& doc) : doc_(doc) {}
+
+  DocOut& beginObject() { return *this; }
+  DocOut& endObject() { return *this; }
+  template <typename T>
+  DocOut& add(const char* key, T value) {
+    doc_[key] = value;
+    return *this;
+  }
+  DocOut& beginArray(const char* key) {
+    array_ = doc_.createNestedArray(key);
+    return *this;
+  }
+  template <typename T>
+  DocOut& item(T value) {
+    array_.add(value);
+    return *this;
+  }
+  DocOut& endArray() { return *this; }
+
+private:
+  JsonDocument& doc_;
+  JsonArray array_;
+};
+
+// ---- Envelopes (field order as in NetClient) ----
+template <typename Out>
+static void hello(Out& out) {
+  out.add("kind", "hello");
+  out.add("espId", "e6c2a1");
+  out.add("fw", "robot-max-fw/1.0");
+  out.add("rssi", (int32_t)-67);
+  out.add("ip", "192.168.100.142");
+  out.add("win", (uint8_t)8);
+  out.add("lease", (uint32_t)1500);
+  out.add("tlm", 1);
+  out.add("udp", (uint16_t)4210);
+  out.add("twist", (uint16_t)300);
+  out.beginArray("resume").item((uint32_t)48213).item((uint32_t)977).item((uint32_t)0).endArray();
+  out.add("ep", (uint8_t)1);
+  out.add("eph", (uint32_t)0xDEADBEEF);
+  out.beginArray("rst").item((uint8_t)2).item(1).item((uint32_t)17).item((uint16_t)0).item((uint16_t)3)
+      .item((uint16_t)1).endArray();
+  out.add("boot", (uint32_t)2481);
+  out.beginArray("macros");
+  for (uint32_t h : {0u, 0x9E3779B9u, 0u, 0u, 0x01000193u, 0u, 0u, 0xFFFFFFFFu}) out.item(h);
+  out.endArray();
+  out.add("seq", (uint32_t)48214);
+}
+
+template <typename Out>
+static void stats(Out& out) {
+  out.add("kind", "stats");
+  out.add("heap", (uint32_t)31240);
+  out.add("heapMin", (uint32_t)27112);
+  out.add("blk", (uint32_t)15832);
+  out.add("blkMin", (uint32_t)11024);
+  out.add("frag", (uint8_t)12);
+  out.add("fragMax", (uint8_t)31);
+  out.add("alert", (uint8_t)0);
+  out.beginArray("fb").item((uint32_t)0).item((uint32_t)4000000000u).endArray();
+  out.beginArray("co").item((uint32_t)918273).item((uint32_t)4).item((uint32_t)61).endArray();
+  out.beginArray("rate").item((uint16_t)299).item((uint16_t)30).item((uint16_t)812).endArray();
+  out.beginArray("stop").item((uint16_t)12).item((uint32_t)84).item((uint32_t)212).item((uint32_t)40117).endArray();
+  out.beginArray("rx").item((uint32_t)120331).item((uint32_t)4410).item((uint32_t)9001).item((uint32_t)17).endArray();
+  out.beginArray("pwr").item((uint16_t)734).item((uint32_t)41).item((uint32_t)100212).item((uint32_t)311).endArray();
+  out.add("up", (uint32_t)86400);
+  out.add("seq", (uint32_t)48215);
+}
+
+// Error strings from the firmware plus everything ArduinoJson escapes (and what it
+// leaves alone: '/', other control characters, UTF-8)
+static const char* const ERROR_MESSAGES[] = {
+    "Invalid JSON",
+    "Queue full (8 tasks)",
+    "Unknown kind \"drive2\"",
+    "path C:\\robot\\macros\\3.bin",
+    "tab\there, newline\nthere, cr\r, bs\b, ff\f",
+    "bell\x07 esc\x1b del\x7f",
+    "a/b </script>",
+    "L\xe1\xbb\x97i: k\xe1\xba\xbft n\xe1\xbb\x91i th\xe1\xba\xa5t b\xe1\xba\xa1i",  // UTF-8 (Vietnamese)
+    "",
+};
+
+template <typename Out>
+static void error(Out& out, const char* message) {
+  out.add("kind", "error");
+  out.add("seq", (uint32_t)7);
+  out.add("taskId", "mv-\"42\"\\");
+  out.add("message", message);
+}
+
+template <typename Out>
+static void extremes(Out& out) {
+  out.add("kind", "ints");
+  out.add("i8min", (int8_t)INT8_MIN);
+  out.add("i8max", (int8_t)INT8_MAX);
+  out.add("u8max", (uint8_t)UINT8_MAX);
+  out.add("i16min", (int16_t)INT16_MIN);
+  out.add("i16max", (int16_t)INT16_MAX);
+  out.add("u16max", (uint16_t)UINT16_MAX);
+  out.add("i32min", (int32_t)INT32_MIN);
+  out.add("i32max", (int32_t)INT32_MAX);
+  out.add("u32max", (uint32_t)UINT32_MAX);
+  out.add("zero", 0);
+  out.add("neg1", -1);
+  out.beginArray("a").item((int32_t)INT32_MIN).item((uint32_t)UINT32_MAX).item((int16_t)-1).item(0).endArray();
+  out.beginArray("empty").endArray();
+  out.add("null", (const char*)nullptr);
+}
+
+// ---- Runner ----
+struct Result {
+  size_t writerBytes;
+  size_t docBytes;
+  bool equal;
+  double writerNs;
+  double docNs;
+};
+
+template <typename Build>
+static size_t viaWriter(Build build, char* buf) {
+  JsonWriter json(buf, TX_BUFFER_SIZE);
+  json.beginObject();
+  build(json);
+  json.endObject();
+  return json.ok() ? json.length() : 0;
+}
+
+template <typename Build>
+static size_t viaDocument(Build build, char* buf) {
+  StaticJsonDocument<4096> doc;  // host slots are wider than on the ESP
+  DocOut out(doc);
+  build(out);
+  return serializeJson(doc, buf, TX_BUFFER_SIZE);
+}
+
+template <typename F>
+static double nsPerRun(F f) {
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < TIMING_RUNS; ++i) f();
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / TIMING_RUNS;
+}
+
+static void printEscaped(const char* label, const char* s, size_t n) {
+  printf("  %s ", label);
+  for (size_t i = 0; i < n; ++i) {
+    const unsigned char c = (unsigned char)s[i];
+    if (c < 0x20 || c >= 0x7f) printf("\\x%02x", c);
+    else putchar(c);
+  }
+  printf("\n");
+}
+
+template <typename Build>
+static bool run(const char* name, Build build) {
+  static char a[TX_BUFFER_SIZE];
+  static char b[TX_BUFFER_SIZE];
+  Result r;
+  r.writerBytes = viaWriter(build, a);
+  r.docBytes = viaDocument(build, b);
+  r.equal = r.writerBytes == r.docBytes && r.writerBytes != 0 && memcmp(a, b, r.writerBytes) == 0;
+  r.writerNs = nsPerRun([&] { viaWriter(build, a); });
+  r.docNs = nsPerRun([&] { viaDocument(build, b); });
+  printf("%-10s %6zu %6zu %-5s %9.0f %9.0f\n", name, r.writerBytes, r.docBytes, r.equal ? "same" : "DIFF",
+         r.writerNs, r.docNs);
+  if (!r.equal) {
+    printEscaped("writer:", a, r.writerBytes);
+    printEscaped("doc:   ", b, r.docBytes);
+  }
+  return r.equal;
+}
+
+int main() {
+  printf("%-10s %6s %6s %-5s %9s %9s\n", "envelope", "writer", "doc", "bytes", "writer ns", "doc ns");
+  unsigned diffs = 0;
+  diffs += !run("hello", [](auto& out) { hello(out); });
+  diffs += !run("stats", [](auto& out) { stats(out); });
+  char name[16];
+  for (size_t i = 0; i < sizeof(ERROR_MESSAGES) / sizeof(ERROR_MESSAGES[0]); ++i) {
+    snprintf(name, sizeof(name), "error-%zu", i);
+    const char* message = ERROR_MESSAGES[i];
+    diffs += !run(name, [message](auto& out) { error(out, message); });
+  }
+  diffs += !run("ints", [](auto& out) { extremes(out); });
+
+  // Overflow: the writer refuses rather than sending a truncated envelope
+  char small[32];
+  JsonWriter json(small, sizeof(small));
+  json.beginObject();
+  hello(json);
+  json.endObject();
+  const bool overflowOk = !json.ok() && json.length() == 0;
+  printf("\noverflow into %zu bytes: %s\n", sizeof(small), overflowOk ? "refused" : "NOT REFUSED");
+
+  printf("%u envelope(s) differ\n", diffs);
+  return diffs || !overflowOk ? 1 : 0;
+}
@@ -0,0 +1,300 @@
+// firmware/bench/maxbus_bench.cpp
+// Host check of the bit-parallel MAX bus: steps the real MaxBus timer1 ISR with all
+// four channels wired and compares every line against a per-channel reference
+// written the way the MeccaChannel library bit-bangs a frame (slot timing, bit
+// levels, checksum and module rotation), then the decoded module replies.
+// See README.md for build/usage.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "../main/MaxBus.h"
+
+// ---- Host runtime ----
+uint64_t g_simUs = 0;
+BenchSerial Serial;
+uint32_t GPO, GPOS, GPOC, GPES, GPEC, GPI;
+
+static constexpr uint8_t CH = MaxBus::CHANNELS;
+static constexpr uint32_t TICKS_PER_US = 5;  // timer1 at 80 MHz / 16
+static constexpr uint32_t BIT_TICKS = MaxBus::BIT_US * TICKS_PER_US;
+static constexpr uint32_t SAMPLE_TICKS = BIT_TICKS / MaxBus::RX_OVERSAMPLE;
+static const uint8_t PINS[CH] = {5, 4, 14, 12};
+
+static unsigned g_checks = 0;
+static unsigned g_failures = 0;
+
+static void check(bool ok, const char* what, uint8_t ch, unsigned frame, int slot = -1) {
+  g_checks++;
+  if (ok) return;
+  if (g_failures++ < 20) {
+    printf("  FAIL %s ch%u frame %u", what, ch, frame);
+    if (slot >= 0) printf(" slot %d", slot);
+    printf("\n");
+  }
+}
+
+// ---- Reference: MeccaChannel::communicate() ----
+// 0xFF, four data bytes, checksum|module; sendByte(): start bit low, 8 data bits LSB
+// first, two stop bits high, one 417 us delay each. Module rotates 0..3 per frame.
+struct RefChannel {
+  uint8_t module = 0;
+
+  static uint8_t checksum(uint8_t b0, uint8_t b1, uint8_t b2, uint8_t b3, uint8_t moduleNum) {
+    int cs = b0 + b1 + b2 + b3;
+    cs = cs + (cs >> 8);
+    cs = cs + (cs << 4);
+    cs = cs & 0xF0;
+    cs = cs | moduleNum;
+    return (uint8_t)cs;
+  }
+
+  static void sendByte(std::vector<bool>& bits, uint8_t data) {
+    bits.push_back(false);
+    for (uint8_t mask = 1; mask > 0; mask <<= 1) bits.push_back(data & mask);
+    bits.push_back(true);
+    bits.push_back(true);
+  }
+
+  // Line level per bit period of the next frame
+  std::vector<bool> communicate(const uint8_t (&d)[4]) {
+    std::vector<bool> bits;
+    sendByte(bits, 0xFF);
+    for (uint8_t b : d) sendByte(bits, b);
+    sendByte(bits, checksum(d[0], d[1], d[2], d[3], module));
+    module = (module + 1) & 3;
+    return bits;
+  }
+};
+
+// ---- Simulated lines ----
+// A line is driven by GPO while its output is enabled, else by the module (pulled
+// up when the module is silent).
+struct Edge {
+  uint64_t tick;
+  bool level;
+  bool driven;
+};
+
+static uint64_t g_tick = 0;
+static uint32_t g_oe = 0;  // output enable (GPES/GPEC)
+static std::vector<Edge> g_edges[CH];
+
+// Module reply model: after ~2 ms turnaround a low, then per bit a high pulse
+// (long = 1, short = 0) and a low gap; MaxBus counts high pulses >= ~1 bit time as 1
+static constexpr uint32_t REPLY_DELAY_US = 2000;
+static constexpr uint32_t REPLY_GAP_US = 250;
+static constexpr uint32_t REPLY_ONE_US = 600;
+static constexpr uint32_t REPLY_ZERO_US = 200;
+static uint64_t g_releaseTick = 0;
+static uint8_t g_replyByte[CH];
+
+static bool moduleLevel(uint8_t ch, uint64_t tick) {
+  int64_t us = (int64_t)(tick - g_releaseTick) / TICKS_PER_US - REPLY_DELAY_US;
+  if (us < 0) return true;
+  if (us < REPLY_GAP_US) return false;
+  us -= REPLY_GAP_US;
+  for (uint8_t i = 0; i < 8; ++i) {
+    const uint32_t high = (g_replyByte[ch] >> i) & 1 ? REPLY_ONE_US : REPLY_ZERO_US;
+    if (us < high) return true;
+    us -= high;
+    if (us < REPLY_GAP_US) return false;
+    us -= REPLY_GAP_US;
+  }
+  return true;
+}
+
+static bool lineLevel(uint8_t ch, uint64_t tick) {
+  const uint32_t bit = 1u << PINS[ch];
+  return (g_oe & bit) ? (GPO & bit) != 0 : moduleLevel(ch, tick);
+}
+
+// Set/clear registers act on GPO / output enable, as on the ESP
+static void latch() {
+  GPO = (GPO | GPOS) & ~GPOC;
+  g_oe = (g_oe | GPES) & ~GPEC;
+  if (GPEC) g_releaseTick = g_tick;
+  GPOS = GPOC = GPES = GPEC = 0;
+}
+
+static void record() {
+  for (uint8_t ch = 0; ch < CH; ++ch) {
+    const bool level = lineLevel(ch, g_tick);
+    const bool driven = (g_oe >> PINS[ch]) & 1;
+    std::vector<Edge>& e = g_edges[ch];
+    if (e.empty() || e.back().level != level || e.back().driven != driven) e.push_back({g_tick, level, driven});
+  }
+}
+
+static const Edge* edgeAt(uint8_t ch, uint64_t tick) {
+  const Edge* last = nullptr;
+  for (const Edge& e : g_edges[ch]) {
+    if (e.tick > tick) break;
+    last = &e;
+  }
+  return last;
+}
+
+// Kick the bus and run the ISR on its own one-shot reloads until it goes idle
+static unsigned runBus(unsigned& isrCalls) {
+  for (auto& e : g_edges) e.clear();
+  g_timer1Ticks = 0;
+  MaxBus::instance().kick();
+  latch();
+  record();
+  isrCalls = 0;
+  while (g_timer1Ticks) {
+    g_tick += g_timer1Ticks;
+    g_simUs = g_tick / TICKS_PER_US;
+    g_timer1Ticks = 0;
+    GPI = 0;
+    for (uint8_t ch = 0; ch < CH; ++ch) {
+      if (lineLevel(ch, g_tick)) GPI |= 1u << PINS[ch];
+    }
+    g_timer1Isr();
+    latch();
+    record();
+    isrCalls++;
+  }
+  return isrCalls;
+}
+
+struct Frame {
+  uint8_t d[4];
+};
+
+// One scenario: frames[ch] queued per channel (fewer than the others = that
+// channel sits out the later frames), then every frame checked against the reference
+static void scenario(const char* name, const std::vector<Frame> (&frames)[CH], RefChannel (&ref)[CH],
+                     const uint8_t (&reply)[CH]) {
+  MaxBus& bus = MaxBus::instance();
+  size_t rounds = 0;
+  for (uint8_t ch = 0; ch < CH; ++ch) {
+    if (frames[ch].size() > rounds) rounds = frames[ch].size();
+  }
+  for (uint8_t ch = 0; ch < CH; ++ch) {
+    for (const Frame& f : frames[ch]) bus.submit(ch, f.d[0], f.d[1], f.d[2], f.d[3]);
+  }
+  memcpy(g_replyByte, reply, sizeof(g_replyByte));
+  uint32_t sentBefore[CH];
+  for (uint8_t ch = 0; ch < CH; ++ch) sentBefore[ch] = bus.framesSent(ch);
+  const uint64_t start = g_tick;
+  unsigned isrCalls = 0;
+  runBus(isrCalls);
+
+  // Frame f starts when the first channel with an f-th frame is driven
+  const uint64_t txTicks = (uint64_t)(MaxBus::FRAME_SLOTS + 1) * BIT_TICKS;
+  const uint64_t rxTicks = (uint64_t)MaxBus::RX_SAMPLES * SAMPLE_TICKS;
+  unsigned slots = 0;
+  for (size_t f = 0; f < rounds; ++f) {
+    const uint64_t t0 = start + f * (txTicks + rxTicks);
+    for (uint8_t ch = 0; ch < CH; ++ch) {
+      const bool active = f < frames[ch].size();
+      const Edge* pre = edgeAt(ch, t0);
+      if (!active) {
+        // Sitting out: never driven during this frame
+        const Edge* end = edgeAt(ch, t0 + txTicks + rxTicks - 1);
+        check(pre && !pre->driven && end && !end->driven, "idle channel driven", ch, f);
+        continue;
+      }
+      check(pre && pre->tick == t0 && pre->driven && pre->level, "pre-roll (driven high at frame start)", ch, f);
+
+      const std::vector<bool> bits = ref[ch].communicate(frames[ch][f].d);
+      check(bits.size() == MaxBus::FRAME_SLOTS, "frame length", ch, f);
+      for (uint16_t k = 0; k < bits.size(); ++k) {
+        const uint64_t slotStart = t0 + (uint64_t)(k + 1) * BIT_TICKS;
+        const Edge* e = edgeAt(ch, slotStart + BIT_TICKS - 1);
+        // Level held for the whole slot, changed only at the slot boundary
+        check(e && e->driven && e->level == bits[k], "level", ch, f, k);
+        check(e && e->tick <= slotStart, "edge inside a slot", ch, f, k);
+        slots++;
+      }
+      const Edge* rel = edgeAt(ch, t0 + txTicks);
+      check(rel && rel->tick == t0 + txTicks && !rel->driven, "released after the last stop bit", ch, f);
+    }
+  }
+  check(isrCalls == rounds * (MaxBus::FRAME_SLOTS + 1 + MaxBus::RX_SAMPLES), "ISR count", 0, 0);
+
+  // Replies land at the module that was addressed; one frame counted per channel frame
+  for (uint8_t ch = 0; ch < CH; ++ch) {
+    check(bus.framesSent(ch) - sentBefore[ch] == frames[ch].size(), "frames sent", ch, 0);
+    if (!frames[ch].empty()) check(bus.reply(ch, (ref[ch].module + 3) & 3) == reply[ch], "reply", ch, 0);
+    check(bus.idle(ch), "idle after the run", ch, 0);
+  }
+
+  const double frameUs = (double)(txTicks + rxTicks) / TICKS_PER_US;
+  printf("%-10s %6zu %8u %7u %10.1f %10lu %9.2f\n", name, rounds, slots, isrCalls, frameUs,
+         (unsigned long)MaxBus::FRAME_US, frameUs * rounds / 1000.0);
+}
+
+int main() {
+  // Checksum: every data sum and module against the reference
+  unsigned csChecked = 0;
+  for (uint32_t i = 0; i < 200000; ++i) {
+    const uint32_t r = i * 2654435761u;
+    const uint8_t d[4] = {(uint8_t)r, (uint8_t)(r >> 8), (uint8_t)(r >> 16), (uint8_t)(r >> 24)};
+    const uint8_t m = i & 3;
+    check(MaxBus::checksum(d[0], d[1], d[2], d[3], m) == RefChannel::checksum(d[0], d[1], d[2], d[3], m),
+          "checksum", 0, i);
+    csChecked++;
+  }
+
+  // slotMasks: one set/clear pair carries every channel's slot level
+  uint8_t wire[CH][MaxBus::FRAME_BYTES];
+  uint32_t gpio[CH];
+  for (uint8_t ch = 0; ch < CH; ++ch) {
+    gpio[ch] = 1u << PINS[ch];
+    for (uint8_t b = 0; b < MaxBus::FRAME_BYTES; ++b) wire[ch][b] = (uint8_t)(0x5A * (ch + 1) + 37 * b);
+  }
+  for (uint8_t active = 0; active < (1u << CH); ++active) {
+    for (uint16_t slot = 0; slot < MaxBus::FRAME_SLOTS; ++slot) {
+      uint32_t set, clr;
+      MaxBus::slotMasks(wire, gpio, active, slot, set, clr);
+      uint32_t wantSet = 0, wantClr = 0;
+      for (uint8_t ch = 0; ch < CH; ++ch) {
+        if (!(active & (1u << ch))) continue;
+        std::vector<bool> bits;
+        RefChannel::sendByte(bits, wire[ch][slot / MaxBus::SLOTS_PER_BYTE]);
+        (bits[slot % MaxBus::SLOTS_PER_BYTE] ? wantSet : wantClr) |= gpio[ch];
+      }
+      check(set == wantSet && clr == wantClr && !(set & clr), "slotMasks", active, 0, slot);
+    }
+  }
+
+  if (!MaxBus::instance().begin(PINS) || !g_timer1Isr) {
+    printf("MaxBus::begin failed\n");
+    return 1;
+  }
+  for (uint8_t ch = 0; ch < CH; ++ch) GPO |= 1u << PINS[ch];  // digitalWrite(HIGH) before the bus starts
+
+  RefChannel ref[CH];
+  printf("%-10s %6s %8s %7s %10s %10s %9s\n", "scenario", "frames", "slots", "isr", "frame us", "FRAME_US",
+         "wire ms");
+
+  // All four channels, two frames each (module 0 then 1), distinct payloads
+  std::vector<Frame> full[CH];
+  for (uint8_t ch = 0; ch < CH; ++ch) {
+    full[ch].push_back({{(uint8_t)(0x10 * ch), 0x00, 0xFF, (uint8_t)(0xA5 ^ ch)}});
+    full[ch].push_back({{0xFE, (uint8_t)(0x24 + ch), 0x42, 0x81}});
+  }
+  scenario("all-4", full, ref, {0x00, 0xFF, 0x5A, 0xC3});
+
+  // Uneven queues: channel 1 idle, channel 2 one frame, 0 and 3 two frames
+  std::vector<Frame> uneven[CH];
+  uneven[0] = {{{0xFA, 0xFA, 0xFA, 0xFA}}, {{0x01, 0x02, 0x03, 0x04}}};
+  uneven[2] = {{{0x80, 0x40, 0x20, 0x10}}};
+  uneven[3] = {{{0xFF, 0xFF, 0xFF, 0xFF}}, {{0x00, 0x00, 0x00, 0x00}}};
+  scenario("uneven", uneven, ref, {0x3C, 0x00, 0x96, 0x7F});
+
+  // Rotation: four more rounds on every channel -> modules 2, 3, 0, 1
+  std::vector<Frame> rot[CH];
+  for (uint8_t ch = 0; ch < CH; ++ch) {
+    for (uint8_t f = 0; f < 2; ++f) rot[ch].push_back({{(uint8_t)(f * 77 + ch), (uint8_t)(f + 3), 0x7E, 0xE7}});
+  }
+  scenario("rotate", rot, ref, {0x11, 0x22, 0x44, 0x88});
+  scenario("rotate-2", rot, ref, {0xEE, 0xDD, 0xBB, 0x77});
+
+  printf("\nchecksums %u, checks %u, failures %u\n", csChecked, g_checks, g_failures);
+  return g_failures ? 1 : 0;
+}
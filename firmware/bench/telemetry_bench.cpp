@@ -0,0 +1,320 @@
+// firmware/bench/telemetry_bench.cpp
+// Host bench for binary telemetry: encodes a simulated session with the real
+// TelemetryEncoder (progress, wheels + pose, stats, a reconnect, wrapping values)
+// and the same records as the JSON envelopes NetClient sends without it, and
+// reports frame size and host encode time of both paths. --dump writes the
+// frames and the expected envelopes for telemetry_roundtrip.ts, which decodes
+// them with the server's TelemetryDecoder. See README.md.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../main/JsonWriter.h"
+#include "../main/Protocol.h"
+#include "../main/TelemetryEncoder.h"
+
+// ---- Host runtime ----
+uint64_t g_simUs = 0;
+BenchSerial Serial;
+
+static constexpr size_t TX_BUFFER_SIZE = 512;  // NetClient::TX_BUFFER_SIZE
+static constexpr uint32_t ODOM_FRAMES = 3000;
+static constexpr uint32_t STATS_EVERY = 50;     // odom frames per stats report
+static constexpr uint32_t PROGRESS_EVERY = 7;   // odom frames per task lifecycle step
+static constexpr uint32_t RECONNECT_AT = 1700;  // odom frame index of a reconnect (encoder/decoder reset)
+
+using Clock = std::chrono::steady_clock;
+
+// One telemetry frame and the JSON envelopes it stands for
+struct Frame {
+  const char* kind;                  // size/timing row
+  std::vector<uint8_t> bin;
+  std::vector<std::string> expected; // envelopes the decoder must produce (JSON path + wheels)
+  size_t jsonBytes = 0;              // what the JSON path sends for the same information
+  double binNs = 0;
+  double jsonNs = 0;
+  bool reset = false;                // reconnect before this frame
+};
+
+static uint32_t g_seq = 0;
+static char g_tx[TX_BUFFER_SIZE];
+
+static double nsSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+// ---- JSON path (as in NetClient) ----
+static JsonWriter beginEnvelope(const char* kind) {
+  JsonWriter json(g_tx, sizeof(g_tx));
+  json.beginObject();
+  json.add("kind", kind);
+  return json;
+}
+
+static void progressJson(JsonWriter& json, const int32_t* f, const char* taskId) {
+  if (f[0] == 0) {
+    json = beginEnvelope(Protocol::RESP_ACK);
+    json.add("taskId", taskId);
+  } else if (f[0] == 2) {
+    json = beginEnvelope(Protocol::RESP_DONE);
+    json.add("taskId", taskId);
+  } else {
+    json = beginEnvelope(Protocol::RESP_PROGRESS);
+    json.add("taskId", taskId);
+    json.add("pct", (uint8_t)f[1]);
+  }
+  json.add("seq", ++g_seq);
+  json.endObject();
+}
+
+static void odomJson(JsonWriter& json, const int32_t* p) {
+  json = beginEnvelope(Protocol::RESP_ODOM);
+  json.add("x", p[0]);
+  json.add("y", p[1]);
+  json.add("th", (uint16_t)p[2]);
+  json.add("v", (int16_t)p[3]);
+  json.add("w", (int16_t)p[4]);
+  json.add("ep", (uint16_t)p[5]);
+  json.add("t", (uint32_t)p[6]);
+  json.add("seq", ++g_seq);
+  json.endObject();
+}
+
+static void statsJson(JsonWriter& json, const int32_t* s) {
+  const uint32_t* u = reinterpret_cast<const uint32_t*>(s);
+  json = beginEnvelope(Protocol::RESP_STATS);
+  static const char* const scalar[] = {"heap", "heapMin", "blk", "blkMin", "frag", "fragMax", "alert"};
+  for (uint8_t i = 0; i < 7; ++i) json.add(scalar[i], u[i]);
+  json.beginArray("fb").item(u[7]).item(u[8]).endArray();
+  json.beginArray("co").item(u[9]).item(u[10]).item(u[11]).endArray();
+  json.beginArray("rate").item(u[12]).item(u[13]).item(u[14]).endArray();
+  json.beginArray("stop").item(u[15]).item(u[16]).item(u[17]).item(u[18]).endArray();
+  json.beginArray("rx").item(u[19]).item(u[20]).item(u[21]).item(u[22]).endArray();
+  json.beginArray("pwr").item(u[23]).item(u[24]).item(u[25]).item(u[26]).endArray();
+  json.add("up", u[27]);
+  json.add("seq", ++g_seq);
+  json.endObject();
+}
+
+// Binary-only record; written as the envelope the decoder produces
+static std::string wheelsExpected(const int32_t* w) {
+  char buf[96];
+  JsonWriter json(buf, sizeof(buf));
+  json.beginObject();
+  json.add("kind", "wheels");
+  json.beginArray("target").item(w[0]).item(w[1]).endArray();
+  json.beginArray("applied").item(w[2]).item(w[3]).endArray();
+  json.endObject();
+  return std::string(json.data(), json.length());
+}
+
+// ---- Session ----
+static TelemetryEncoder g_tlm;
+static uint8_t g_bin[TX_BUFFER_SIZE];
+
+static void finishBinary(Frame& fr, Clock::time_point start) {
+  fr.binNs = nsSince(start);
+  const size_t len = g_tlm.length();
+  fr.bin.assign(g_bin, g_bin + len);
+}
+
+static Frame progressFrame(const int32_t (&f)[TelemetryEncoder::PROGRESS_FIELDS], const char* taskId) {
+  Frame fr;
+  fr.kind = "progress";
+  auto start = Clock::now();
+  g_tlm.beginFrame(g_bin, sizeof(g_bin));
+  g_tlm.add(TelemetryEncoder::PROGRESS, f, taskId);
+  finishBinary(fr, start);
+
+  JsonWriter json(g_tx, sizeof(g_tx));
+  start = Clock::now();
+  progressJson(json, f, taskId);
+  fr.jsonNs = nsSince(start);
+  fr.jsonBytes = json.length();
+  fr.expected.emplace_back(json.data(), json.length());
+  return fr;
+}
+
+static Frame odomFrame(const int32_t (&w)[TelemetryEncoder::WHEELS_FIELDS],
+                       const int32_t (&p)[TelemetryEncoder::POSE_FIELDS]) {
+  Frame fr;
+  fr.kind = "odom";
+  auto start = Clock::now();
+  g_tlm.beginFrame(g_bin, sizeof(g_bin));
+  g_tlm.add(TelemetryEncoder::WHEELS, w);
+  g_tlm.add(TelemetryEncoder::POSE, p);
+  finishBinary(fr, start);
+
+  // The JSON path has no wheels state: odom only
+  JsonWriter json(g_tx, sizeof(g_tx));
+  start = Clock::now();
+  odomJson(json, p);
+  fr.jsonNs = nsSince(start);
+  fr.jsonBytes = json.length();
+  fr.expected.push_back(wheelsExpected(w));
+  fr.expected.emplace_back(json.data(), json.length());
+  return fr;
+}
+
+static Frame statsFrame(const int32_t (&s)[TelemetryEncoder::STATS_FIELDS]) {
+  Frame fr;
+  fr.kind = "stats";
+  auto start = Clock::now();
+  g_tlm.beginFrame(g_bin, sizeof(g_bin));
+  g_tlm.add(TelemetryEncoder::STATS, s);
+  finishBinary(fr, start);
+
+  JsonWriter json(g_tx, sizeof(g_tx));
+  start = Clock::now();
+  statsJson(json, s);
+  fr.jsonNs = nsSince(start);
+  fr.jsonBytes = json.length();
+  fr.expected.emplace_back(json.data(), json.length());
+  return fr;
+}
+
+static std::vector<Frame> simulate() {
+  std::vector<Frame> frames;
+  g_tlm.reset();
+
+  // Pose in the firmware's units; t starts just below the millis() wrap
+  int32_t x = 0, y = 0;
+  int32_t th = 35000;
+  uint16_t ep = 0;
+  uint32_t t = 0xFFFFFFFFu - 90000;
+  int32_t task = 0;
+  int32_t pct = -1;
+
+  int32_t stats[TelemetryEncoder::STATS_FIELDS];
+  for (uint8_t i = 0; i < TelemetryEncoder::STATS_FIELDS; ++i) stats[i] = (int32_t)(1000u * (i + 1));
+  stats[19] = (int32_t)(0xFFFFFFFFu - 700000u);  // rx frames: wraps mid-session
+  stats[25] = (int32_t)0xFFFFFFF0u;               // max sleep us near the top of uint32
+
+  for (uint32_t i = 0; i < ODOM_FRAMES; ++i) {
+    const bool reconnect = i == RECONNECT_AT;
+    if (reconnect) {
+      g_tlm.reset();  // NetClient: new connection
+      ep++;
+    }
+
+    // Wheels: a slalom with reversals; pose follows roughly
+    const int32_t l = (int32_t)((i * 7) % 201) - 100;
+    const int32_t r = (int32_t)((i * 11) % 201) - 100;
+    const int32_t v = (l + r) * 3 / 2;
+    const int32_t w = (r - l) * 12;
+    x += v / 5;
+    y -= w / 40;
+    th = (th + w / 8 + 36000) % 36000;
+    t += 200;
+    if (i == 1200) {  // pose.reset-like jump: the delta wraps int32
+      x = INT32_MIN + 5;
+      y = INT32_MAX - 5;
+      ep++;
+    }
+    const int32_t wheels[TelemetryEncoder::WHEELS_FIELDS] = {l, r, l * 9 / 10, r * 9 / 10};
+    const int32_t pose[TelemetryEncoder::POSE_FIELDS] = {x, y, th, v, w, ep, (int32_t)t};
+    frames.push_back(odomFrame(wheels, pose));
+    frames.back().reset = reconnect;
+
+    if (i % PROGRESS_EVERY == 0) {
+      char taskId[24];
+      snprintf(taskId, sizeof(taskId), "drive-seq%d", (int)task);
+      int32_t f[TelemetryEncoder::PROGRESS_FIELDS];
+      if (pct < 0) {
+        f[0] = 0, f[1] = 0;  // ack
+        pct = 0;
+      } else if (pct >= 100) {
+        f[0] = 2, f[1] = 100;  // done, next task
+        pct = -1;
+        task++;
+      } else {
+        pct = pct + 17 > 100 ? 100 : pct + 17;
+        f[0] = 1, f[1] = pct;
+      }
+      frames.push_back(progressFrame(f, taskId));
+    }
+
+    if (i % STATS_EVERY == 0) {
+      stats[0] = (int32_t)(30000 - (i % 400) * 3);  // heap
+      stats[1] = stats[0] < stats[1] ? stats[0] : stats[1];
+      stats[8] += 1500;                            // rx String copies: past the old uint16 limit
+      stats[9] += 4000;                            // coroutine resumes
+      stats[19] = (int32_t)((uint32_t)stats[19] + 25000u);
+      stats[27] = (int32_t)((t - 0xFFFFFFFFu + 90000) / 1000);
+      frames.push_back(statsFrame(stats));
+    }
+  }
+  return frames;
+}
+
+static bool dump(const std::vector<Frame>& frames, const std::string& dir) {
+  FILE* bin = fopen((dir + "/frames.hex").c_str(), "w");
+  FILE* exp = fopen((dir + "/expected.jsonl").c_str(), "w");
+  if (!bin || !exp) {
+    fprintf(stderr, "cannot write to %s\n", dir.c_str());
+    return false;
+  }
+  // frames.hex: one frame per line ("reset" before a reconnect); expected.jsonl:
+  // the envelopes of that frame as a JSON array
+  for (const Frame& fr : frames) {
+    if (fr.reset) {
+      fputs("reset\n", bin);
+      fputs("reset\n", exp);
+    }
+    for (uint8_t b : fr.bin) fprintf(bin, "%02x", b);
+    fputc('\n', bin);
+    fputc('[', exp);
+    for (size_t i = 0; i < fr.expected.size(); ++i) fprintf(exp, "%s%s", i ? "," : "", fr.expected[i].c_str());
+    fputs("]\n", exp);
+  }
+  fclose(bin);
+  fclose(exp);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  std::string dumpDir;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--dump") && i + 1 < argc) {
+      dumpDir = argv[++i];
+    } else {
+      fprintf(stderr, "usage: %s [--dump <dir>]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  const std::vector<Frame> frames = simulate();
+
+  printf("%-9s %6s %7s %7s %6s %8s %8s\n", "frame", "count", "bin B", "json B", "ratio", "bin ns", "json ns");
+  size_t totalBin = 0, totalJson = 0;
+  unsigned empty = 0;
+  for (const char* kind : {"progress", "odom", "stats"}) {
+    size_t n = 0, bin = 0, json = 0;
+    double binNs = 0, jsonNs = 0;
+    for (const Frame& fr : frames) {
+      if (strcmp(fr.kind, kind)) continue;
+      n++;
+      bin += fr.bin.size();
+      json += fr.jsonBytes;
+      binNs += fr.binNs;
+      jsonNs += fr.jsonNs;
+      if (fr.bin.empty()) empty++;
+    }
+    totalBin += bin;
+    totalJson += json;
+    printf("%-9s %6zu %7.1f %7.1f %5.1fx %8.0f %8.0f\n", kind, n, (double)bin / n, (double)json / n,
+           (double)json / bin, binNs / n, jsonNs / n);
+  }
+  printf("%-9s %6zu %7zu %7zu %5.1fx   (total bytes)\n", "all", frames.size(), totalBin, totalJson,
+         (double)totalJson / totalBin);
+  if (empty) printf("%u frame(s) did not fit\n", empty);
+
+  if (!dumpDir.empty()) {
+    if (!dump(frames, dumpDir)) return 1;
+    printf("\nwrote %s/frames.hex and %s/expected.jsonl\n", dumpDir.c_str(), dumpDir.c_str());
+  }
+  return empty ? 1 : 0;
+}
@@ -0,0 +1,73 @@
+/**
+ * Round trip for binary telemetry: decodes the frames written by
+ * `telemetry_bench --dump <dir>` with the server's TelemetryDecoder and compares
+ * every record with the envelope the JSON path sends (seq aside, which frames do
+ * not carry). Also times decode() against JSON.parse of the same envelopes.
+ *
+ *   node --experimental-transform-types firmware/bench/telemetry_roundtrip.ts <dir>
+ *
+ * See README.md.
+ */
+import assert from 'node:assert/strict';
+import { readFileSync } from 'node:fs';
+import { join } from 'node:path';
+import { TelemetryDecoder } from '../../server/src/telemetry.ts';
+
+const TIMING_RUNS = 20;
+
+const dir = process.argv[2];
+if (!dir) {
+  console.error('usage: telemetry_roundtrip.ts <dump dir>');
+  process.exit(2);
+}
+
+const lines = (name: string) => readFileSync(join(dir, name), 'utf8').split('\n').filter((l) => l.length > 0);
+const frames = lines('frames.hex');
+const expected = lines('expected.jsonl');
+if (frames.length !== expected.length) {
+  console.error(`frames.hex has ${frames.length} lines, expected.jsonl ${expected.length}`);
+  process.exit(1);
+}
+
+const buffers = frames.map((l) => (l === 'reset' ? null : Buffer.from(l, 'hex')));
+const decoder = new TelemetryDecoder();
+let records = 0;
+let mismatches = 0;
+for (let i = 0; i < buffers.length; i++) {
+  const buf = buffers[i];
+  if (!buf) {
+    decoder.reset(); // reconnect
+    continue;
+  }
+  const want = (JSON.parse(expected[i]) as Record<string, unknown>[]).map(({ seq: _seq, ...rest }) => rest);
+  try {
+    const got = decoder.decode(buf);
+    assert.deepStrictEqual(got, want);
+    records += got.length;
+  } catch (err) {
+    if (++mismatches <= 5) {
+      console.error(`frame ${i + 1} (${frames[i]}): ${err instanceof Error ? err.message : String(err)}`);
+    }
+  }
+}
+
+const count = buffers.filter((b) => b).length;
+console.log(`${count} frames, ${records} records, ${mismatches} mismatch(es)`);
+if (mismatches) process.exit(1);
+
+const time = (run: () => void): number => {
+  const start = process.hrtime.bigint();
+  for (let r = 0; r < TIMING_RUNS; r++) run();
+  return Number(process.hrtime.bigint() - start) / TIMING_RUNS;
+};
+const binNs = time(() => {
+  const d = new TelemetryDecoder();
+  for (const buf of buffers) {
+    if (buf) d.decode(buf);
+    else d.reset();
+  }
+});
+const jsonNs = time(() => {
+  for (const l of expected) if (l !== 'reset') JSON.parse(l);
+});
+console.log(`decode ${(binNs / count).toFixed(0)} ns/frame, JSON.parse ${(jsonNs / count).toFixed(0)} ns/frame`);
@@ -0,0 +1,320 @@
+// firmware/bench/wheels_bench.cpp
+// Host evaluation bench: runs the real WheelsDevice control loop (slew limit,
+// deadzone, soft/hard stop, keepalive) against a smart-motor plant and replays
+// joystick traces. See README.md for build/usage.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../main/DeviceTopology.h"
+#include "MotorPlant.h"
+
+// ---- Host runtime ----
+uint64_t g_simUs = 0;
+BenchSerial Serial;
+uint32_t GPO, GPOS, GPOC, GPES, GPEC, GPI;
+MeccaChannel::FrameSink MeccaChannel::sink = nullptr;
+uint32_t MeccaChannel::frameUs = 27000;
+
+// Server-side behaviour being emulated (server/src/config.ts)
+static constexpr uint32_t LEASE_TTL_MS = 600;
+static constexpr uint32_t LEASE_RENEW_MS = 200;
+
+// Step response metrics only for steps of at least this size / within this band
+static constexpr float STEP_MIN_FRAC = 0.10f;
+static constexpr float SETTLE_BAND_FRAC = 0.05f;
+
+struct Sample {
+  uint32_t tMs;
+  int8_t left;
+  int8_t right;
+};
+
+struct Trace {
+  std::string name;
+  std::vector<Sample> samples;
+  uint32_t endMs;
+};
+
+// ---- Plant wiring ----
+static SmartMotor g_left;
+static SmartMotor g_right;
+
+// WheelsDevice frame layout: dirR, dirL, spR, spL
+static void onFrame(uint8_t dirR, uint8_t dirL, uint8_t spR, uint8_t spL) {
+  g_right.command(dirR, spR, g_simUs);
+  g_left.command(dirL, spL, g_simUs);
+}
+
+// ---- Metrics ----
+class WheelMetrics {
+public:
+  explicit WheelMetrics(float vmax) : vmax_(vmax) {}
+
+  void retarget(float ref, float speed, uint32_t tMs) {
+    // Ramps/joystick noise are not steps: they move the goal of the running step
+    if (fabsf(ref - ref_) < STEP_MIN_FRAC * vmax_) {
+      ref_ = ref;
+      return;
+    }
+    closeSegment();
+    segActive_ = true;
+    ref_ = ref;
+    segStart_ = speed;
+    segT0_ = tMs;
+    segReached_ = false;
+    segPeak_ = 0;
+  }
+
+  void sample(float speed, uint32_t tMs) {
+    const float err = speed - ref_;
+    sqErr_ += err * err;
+    samples_++;
+    if (!segActive_) return;
+    const float dir = ref_ >= segStart_ ? 1.0f : -1.0f;
+    const float beyond = (speed - ref_) * dir;
+    if (beyond > segPeak_) segPeak_ = beyond;
+    if (!segReached_ && fabsf(err) <= SETTLE_BAND_FRAC * vmax_) {
+      segReached_ = true;
+      reachSumMs_ += tMs - segT0_;
+      reached_++;
+    }
+  }
+
+  void finish() { closeSegment(); }
+
+  float rmsErr() const { return samples_ ? sqrtf(sqErr_ / samples_) : 0; }
+  float overshootPct() const { return worstOvershoot_ * 100; }
+  float meanReachMs() const { return reached_ ? (float)reachSumMs_ / reached_ : 0; }
+  uint32_t reached() const { return reached_; }
+  uint32_t unreached() const { return unreached_; }
+
+private:
+  float vmax_;
+  float ref_ = 0;
+  double sqErr_ = 0;
+  uint32_t samples_ = 0;
+  bool segActive_ = false;
+  float segStart_ = 0;
+  uint32_t segT0_ = 0;
+  bool segReached_ = false;
+  float segPeak_ = 0;
+  float worstOvershoot_ = 0;
+  uint64_t reachSumMs_ = 0;
+  uint32_t reached_ = 0;
+  uint32_t unreached_ = 0;
+
+  void closeSegment() {
+    if (!segActive_) return;
+    const float step = fabsf(ref_ - segStart_);
+    if (step > 1.0f && segPeak_ / step > worstOvershoot_) worstOvershoot_ = segPeak_ / step;
+    if (!segReached_) unreached_++;
+    segActive_ = false;
+  }
+};
+
+// ---- Traces ----
+static bool loadTrace(const char* path, Trace& out) {
+  FILE* f = fopen(path, "r");
+  if (!f) return false;
+  out.name = path;
+  const char* slash = strrchr(path, '/');
+  if (slash) out.name = slash + 1;
+  char line[128];
+  uint32_t lastT = 0;
+  uint32_t base = 0;  // sessions appended to one file restart at t=0: play them back to back
+  while (fgets(line, sizeof(line), f)) {
+    if (line[0] == '#' || line[0] == '\n') continue;
+    unsigned t;
+    int l, r;
+    if (sscanf(line, "%u,%d,%d", &t, &l, &r) != 3) continue;
+    if (base + t < lastT) {
+      base = lastT + 2000;
+      out.samples.push_back({lastT + 1, 0, 0});
+    }
+    lastT = base + t;
+    out.samples.push_back({lastT, (int8_t)constrain(l, -100, 100), (int8_t)constrain(r, -100, 100)});
+  }
+  fclose(f);
+  out.endMs = lastT + 2000;  // let the last command play out
+  return !out.samples.empty();
+}
+
+// UI-like traces: joystick sampled every 50ms
+static std::vector<Trace> builtinTraces() {
+  std::vector<Trace> traces;
+
+  Trace step{"step", {{0, 0, 0}, {500, 60, 60}, {3500, 0, 0}}, 5500};
+  traces.push_back(step);
+
+  Trace reverse{"reverse", {{200, 80, 80}, {2700, -80, -80}, {5200, 0, 0}}, 7000};
+  traces.push_back(reverse);
+
+  Trace ramp{"ramp", {}, 0};
+  for (uint32_t t = 0; t <= 3000; t += 50) ramp.samples.push_back({t, (int8_t)(t / 30), (int8_t)(t / 30)});
+  for (uint32_t t = 0; t <= 2000; t += 50) {
+    const int8_t v = (int8_t)(100 - t / 20);
+    ramp.samples.push_back({4000 + t, v, v});
+  }
+  ramp.endMs = 7000;
+  traces.push_back(ramp);
+
+  Trace slalom{"slalom", {}, 0};
+  for (uint32_t t = 0; t <= 8000; t += 50) {
+    const int d = (int)lroundf(30.0f * sinf(2.0f * (float)M_PI * 0.5f * t / 1000.0f));
+    slalom.samples.push_back({t, (int8_t)(50 - d), (int8_t)(50 + d)});
+  }
+  slalom.samples.push_back({8050, 0, 0});
+  slalom.endMs = 10000;
+  traces.push_back(slalom);
+
+  Trace jitter{"jitter", {}, 0};
+  uint32_t seed = 12345;
+  for (uint32_t t = 0; t <= 4000; t += 50) {
+    seed = seed * 1103515245u + 12345u;
+    const int n = (int)((seed >> 16) % 7) - 3;  // joystick noise +-3%
+    jitter.samples.push_back({t, (int8_t)(50 + n), (int8_t)(50 + n)});
+  }
+  jitter.samples.push_back({4050, 0, 0});
+  jitter.endMs = 6000;
+  traces.push_back(jitter);
+
+  return traces;
+}
+
+// ---- Run ----
+struct Result {
+  float rmsErr, overshootPct, reachMs;
+  uint32_t reached, unreached, frames;
+  float framesPerSec, busyPct;
+};
+
+static Result runTrace(const Trace& trace, const PlantParams& plant) {
+  g_simUs = 0;
+  g_left = SmartMotor();
+  g_right = SmartMotor();
+  g_left.begin(plant, WheelsLeftPort::info);
+  g_right.begin(plant, WheelsRightPort::info);
+  MeccaChannel::frameUs = plant.frameUs;
+  MeccaChannel::sink = &onFrame;
+
+  static const MaxPortInfo ports[2] = {WheelsLeftPort::info, WheelsRightPort::info};
+  WheelsDevice wheels;
+  wheels.begin(ports, 2);
+  const uint32_t frames0 = wheels.busFrames();
+  const uint32_t busy0 = wheels.busBusyUs();
+
+  WheelMetrics mL(plant.vmaxMmS), mR(plant.vmaxMmS);
+  int8_t refL = 0, refR = 0;
+  size_t next = 0;
+  uint32_t lastTick = 0, lastLease = 0;
+  uint64_t sampledUs = 0;
+
+  // Plant + metrics in 1ms steps up to the sim clock (frames block it for frameUs)
+  auto catchUp = [&]() {
+    while (sampledUs + 1000 <= g_simUs) {
+      sampledUs += 1000;
+      g_left.advanceTo(sampledUs);
+      g_right.advanceTo(sampledUs);
+      mL.sample(g_left.speed(), (uint32_t)(sampledUs / 1000));
+      mR.sample(g_right.speed(), (uint32_t)(sampledUs / 1000));
+    }
+  };
+
+  while (millis() < trace.endMs) {
+    const uint32_t now = millis();
+
+    // Server side: drive on change (stop = binary fast stop + drive 0), lease renewals
+    while (next < trace.samples.size() && trace.samples[next].tMs <= now) {
+      const Sample& s = trace.samples[next++];
+      if (s.left == refL && s.right == refR) continue;
+      if (s.left == 0 && s.right == 0) wheels.emergencyStop();
+      wheels.setTarget(s.left, s.right);
+      refL = s.left;
+      refR = s.right;
+      catchUp();
+      mL.retarget(plant.vmaxMmS * refL / 100.0f, g_left.speed(), now);
+      mR.retarget(plant.vmaxMmS * refR / 100.0f, g_right.speed(), now);
+      lastLease = now;
+    }
+    if ((refL || refR) && now - lastLease >= LEASE_RENEW_MS) {
+      wheels.grantLease(now, LEASE_TTL_MS);
+      lastLease = now;
+    }
+
+    // TaskRunner::loop() order
+    wheels.enforceLease(now);
+    const uint32_t period = wheels.parked(now) ? WHEELS_TICK_IDLE_MS : WHEELS_TICK_MS;
+    if (now - lastTick >= period) {
+      wheels.tick(now);
+      lastTick = now;
+    }
+
+    catchUp();
+    g_simUs = (g_simUs / 1000 + 1) * 1000;  // next loop pass, 1ms later
+    catchUp();
+  }
+  mL.finish();
+  mR.finish();
+
+  Result r;
+  r.rmsErr = (mL.rmsErr() + mR.rmsErr()) / 2;
+  r.overshootPct = std::max(mL.overshootPct(), mR.overshootPct());
+  const uint32_t reached = mL.reached() + mR.reached();
+  r.reachMs = reached ? (mL.meanReachMs() * mL.reached() + mR.meanReachMs() * mR.reached()) / reached : 0;
+  r.reached = reached;
+  r.unreached = mL.unreached() + mR.unreached();
+  r.frames = wheels.busFrames() - frames0;
+  r.framesPerSec = r.frames * 1000.0f / trace.endMs;
+  r.busyPct = (wheels.busBusyUs() - busy0) / (trace.endMs * 10.0f);
+  return r;
+}
+
+static void usage() {
+  printf("usage: wheels_bench [--tau MS] [--frame MS] [--delay MS] [--vmax MMS] [--verbose] [trace.csv ...]\n"
+         "  trace.csv: lines \"t_ms,left_pct,right_pct\" (server DRIVE_TRACE_FILE output)\n"
+         "  no trace given: built-in step/reverse/ramp/slalom/jitter\n");
+}
+
+int main(int argc, char** argv) {
+  PlantParams plant;
+  std::vector<Trace> traces;
+
+  for (int i = 1; i < argc; ++i) {
+    const char* a = argv[i];
+    const bool hasVal = i + 1 < argc;
+    if (!strcmp(a, "--tau") && hasVal) plant.tauMs = (float)atof(argv[++i]);
+    else if (!strcmp(a, "--frame") && hasVal) plant.frameUs = (uint32_t)(atof(argv[++i]) * 1000);
+    else if (!strcmp(a, "--delay") && hasVal) plant.moduleDelayUs = (uint32_t)(atof(argv[++i]) * 1000);
+    else if (!strcmp(a, "--vmax") && hasVal) plant.vmaxMmS = (float)atof(argv[++i]);
+    else if (!strcmp(a, "--verbose")) Serial.enabled = true;
+    else if (a[0] == '-') {
+      usage();
+      return 2;
+    } else {
+      Trace t;
+      if (!loadTrace(a, t)) {
+        fprintf(stderr, "cannot read trace %s\n", a);
+        return 1;
+      }
+      traces.push_back(t);
+    }
+  }
+  if (traces.empty()) traces = builtinTraces();
+
+  printf("controller: slew %d/100 pct/tick, deadzone %d pct, tick %u ms, soft stop %u ms\n",
+         (int)WHEELS_SLEW_X100_PER_TICK, (int)WHEELS_PCT_DEADZONE, (unsigned)WHEELS_TICK_MS,
+         (unsigned)SOFT_STOP_TIMEOUT_MS);
+  printf("plant:      tau %.0f ms, frame %.1f ms, module delay %.1f ms, vmax %.0f mm/s\n\n", plant.tauMs,
+         plant.frameUs / 1000.0f, plant.moduleDelayUs / 1000.0f, plant.vmaxMmS);
+  printf("%-12s %9s %10s %10s %9s %7s %9s %6s\n", "trace", "rms mm/s", "overshoot", "t-target", "unreached",
+         "frames", "frames/s", "busy");
+  for (const Trace& t : traces) {
+    const Result r = runTrace(t, plant);
+    printf("%-12s %9.1f %9.1f%% %8.0fms %5u/%-3u %7u %9.1f %5.1f%%\n", t.name.c_str(), r.rmsErr, r.overshootPct,
+           r.reachMs, r.unreached, r.reached + r.unreached, r.frames, r.framesPerSec, r.busyPct);
+  }
+  return 0;
+}
@@ -0,0 +1,286 @@
+// firmware/src/BehaviorVm.cpp
+#include "BehaviorVm.h"
+
+static uint16_t readU16(const uint8_t* p) { return (uint16_t)(p[0] | p[1] << 8); }
+
+static int32_t readI32(const uint8_t* p) {
+  return (int32_t)((uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24);
+}
+
+bool BehaviorVm::info(uint8_t op, OpInfo& out) {
+  switch (op) {
+    case HALT: case YIELD: case STOP: out = {1, 0, 0}; return true;
+    case SLEEP: case DROP: case ARM: case NECK: out = {1, 1, 0}; return true;
+    case PUSH8: out = {2, 0, 1}; return true;
+    case PUSH16: out = {3, 0, 1}; return true;
+    case PUSH32: out = {5, 0, 1}; return true;
+    case LOAD: case IN: out = {2, 0, 1}; return true;
+    case STORE: out = {2, 1, 0}; return true;
+    case DUP: out = {1, 1, 2}; return true;
+    case SWAP: out = {1, 2, 2}; return true;
+    case OVER: out = {1, 2, 3}; return true;
+    case ADD: case SUB: case MUL: case DIV: case MOD: case MIN: case MAX:
+    case EQ: case LT: case GT: case AND: case OR: case ANGDIFF:
+      out = {1, 2, 1};
+      return true;
+    case NEG: case ABS: case NOT: out = {1, 1, 1}; return true;
+    case JMP: out = {3, 0, 0}; return true;
+    case JZ: case JNZ: out = {3, 1, 0}; return true;
+    case DRIVE: out = {1, 2, 0}; return true;
+    default: return false;
+  }
+}
+
+// Three passes over at most BEH_CODE_MAX bytes, no allocation: decode (instruction
+// starts, operands), jump targets, then stack depths propagated until stable (each
+// instruction gets its depth once, so at most one pass per instruction).
+BehaviorVm::Error BehaviorVm::verify(const uint8_t* code, size_t len, uint16_t& errPc) {
+  errPc = 0;
+  if (len == 0 || len > BEH_CODE_MAX) return BAD_SIZE;
+
+  uint8_t starts[(BEH_CODE_MAX + 7) / 8] = {};
+  OpInfo op;
+  for (size_t pc = 0; pc < len; pc += op.size) {
+    errPc = (uint16_t)pc;
+    if (!info(code[pc], op)) return BAD_OP;
+    if (pc + op.size > len) return BAD_OPERAND;
+    if ((code[pc] == LOAD || code[pc] == STORE) && code[pc + 1] >= BEH_LOCALS) return BAD_OPERAND;
+    if (code[pc] == IN && code[pc + 1] >= SENSOR_COUNT) return BAD_OPERAND;
+    starts[pc >> 3] |= 1 << (pc & 7);
+  }
+  auto isStart = [&](size_t pc) { return pc < len && (starts[pc >> 3] & (1 << (pc & 7))); };
+  for (size_t pc = 0; pc < len; pc += op.size) {
+    info(code[pc], op);
+    const uint8_t o = code[pc];
+    if ((o == JMP || o == JZ || o == JNZ) && !isStart(readU16(code + pc + 1))) {
+      errPc = (uint16_t)pc;
+      return BAD_JUMP;
+    }
+  }
+
+  int8_t depth[BEH_CODE_MAX];
+  memset(depth, -1, sizeof(depth));
+  depth[0] = 0;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (size_t pc = 0; pc < len; pc += op.size) {
+      info(code[pc], op);
+      if (depth[pc] < 0) continue;
+      errPc = (uint16_t)pc;
+      if (depth[pc] < op.pops) return STACK_UNDERFLOW;
+      const int d = depth[pc] - op.pops + op.pushes;
+      if (d > BEH_STACK) return STACK_OVERFLOW;
+
+      const uint8_t o = code[pc];
+      size_t next[2];
+      uint8_t n = 0;
+      if (o != HALT && o != JMP) {
+        if (pc + op.size >= len) return FALLS_OFF;
+        next[n++] = pc + op.size;
+      }
+      if (o == JMP || o == JZ || o == JNZ) next[n++] = readU16(code + pc + 1);
+      for (uint8_t i = 0; i < n; ++i) {
+        if (depth[next[i]] < 0) {
+          depth[next[i]] = (int8_t)d;
+          changed = true;
+        } else if (depth[next[i]] != d) {
+          errPc = (uint16_t)next[i];
+          return STACK_MISMATCH;
+        }
+      }
+    }
+  }
+  errPc = 0;
+  return OK;
+}
+
+BehaviorVm::Error BehaviorVm::load(const uint8_t* code, size_t len, uint16_t& errPc) {
+  state_ = EMPTY;
+  len_ = 0;
+  const Error e = verify(code, len, errPc);
+  error_ = e;
+  if (e != OK) return e;
+  memcpy(code_, code, len);
+  len_ = (uint16_t)len;
+  state_ = READY;
+  stats_ = Stats{};
+  return OK;
+}
+
+void BehaviorVm::start(uint32_t now) {
+  if (state_ == EMPTY) return;
+  memset(locals_, 0, sizeof(locals_));
+  sp_ = 0;
+  pc_ = 0;
+  startMs_ = now;
+  error_ = OK;
+  stats_ = Stats{};
+  state_ = RUNNING;
+}
+
+void BehaviorVm::stop() {
+  if (active()) state_ = STOPPED;
+}
+
+void BehaviorVm::fault(Error e) {
+  error_ = e;
+  state_ = FAULT;
+}
+
+uint16_t BehaviorVm::tick(uint32_t now, const Io& io) {
+  if (state_ == SLEEPING) {
+    if ((int32_t)(now - wakeMs_) < 0) return 0;
+    state_ = RUNNING;
+  }
+  if (state_ != RUNNING) return 0;
+
+  // Stack bounds, operands and targets were checked by verify(): no checks here
+  uint16_t n = 0;
+  while (n < BEH_INSN_PER_TICK && state_ == RUNNING) {
+    const uint16_t at = pc_;
+    const uint8_t op = code_[at];
+    n++;
+    pc_ = at + 1;
+    switch (op) {
+      case HALT:
+        pc_ = at;
+        state_ = HALTED;
+        break;
+      case YIELD:
+        goto done;
+      case SLEEP:
+        wakeMs_ = now + (uint32_t)constrain(pop(), 0, 60000);
+        state_ = SLEEPING;
+        break;
+      case PUSH8:
+        push((int8_t)code_[at + 1]);
+        pc_ = at + 2;
+        break;
+      case PUSH16:
+        push((int16_t)readU16(code_ + at + 1));
+        pc_ = at + 3;
+        break;
+      case PUSH32:
+        push(readI32(code_ + at + 1));
+        pc_ = at + 5;
+        break;
+      case LOAD:
+        push(locals_[code_[at + 1]]);
+        pc_ = at + 2;
+        break;
+      case STORE:
+        locals_[code_[at + 1]] = pop();
+        pc_ = at + 2;
+        break;
+      case DUP: {
+        const int32_t a = pop();
+        push(a);
+        push(a);
+        break;
+      }
+      case DROP:
+        sp_--;
+        break;
+      case SWAP: {
+        const int32_t b = pop();
+        const int32_t a = pop();
+        push(b);
+        push(a);
+        break;
+      }
+      case OVER:
+        push(stack_[sp_ - 2]);
+        break;
+      case NEG:
+        stack_[sp_ - 1] = (int32_t)(0u - (uint32_t)stack_[sp_ - 1]);
+        break;
+      case ABS:
+        if (stack_[sp_ - 1] < 0) stack_[sp_ - 1] = (int32_t)(0u - (uint32_t)stack_[sp_ - 1]);
+        break;
+      case NOT:
+        stack_[sp_ - 1] = stack_[sp_ - 1] == 0;
+        break;
+      case IN: {
+        const uint8_t s = code_[at + 1];
+        push(s == T_MS ? (int32_t)(now - startMs_) : io.sense(io.ctx, s));
+        pc_ = at + 2;
+        break;
+      }
+      case JMP:
+        pc_ = readU16(code_ + at + 1);
+        break;
+      case JZ:
+      case JNZ: {
+        const bool zero = pop() == 0;
+        pc_ = zero == (op == JZ) ? readU16(code_ + at + 1) : at + 3;
+        break;
+      }
+      case DRIVE: {
+        const int32_t r = pop();
+        const int32_t l = pop();
+        io.drive(io.ctx, (int8_t)constrain(l, -100, 100), (int8_t)constrain(r, -100, 100));
+        break;
+      }
+      case STOP:
+        io.drive(io.ctx, 0, 0);
+        break;
+      case ARM:
+      case NECK:
+        io.servo(io.ctx, op, (uint8_t)constrain(pop(), 0, 180));
+        break;
+      default: {
+        // Binary operators: a b -> r
+        const int32_t b = pop();
+        const int32_t a = pop();
+        int32_t r = 0;
+        switch (op) {
+          case ADD: r = (int32_t)((uint32_t)a + (uint32_t)b); break;
+          case SUB: r = (int32_t)((uint32_t)a - (uint32_t)b); break;
+          case MUL: r = (int32_t)((uint32_t)a * (uint32_t)b); break;
+          case DIV:
+          case MOD:
+            if (b == 0) {
+              pc_ = at;
+              fault(DIV_ZERO);
+              goto done;
+            }
+            if (b == -1) r = op == DIV ? (int32_t)(0u - (uint32_t)a) : 0;  // INT32_MIN / -1 wraps
+            else r = op == DIV ? a / b : a % b;
+            break;
+          case MIN: r = min(a, b); break;
+          case MAX: r = max(a, b); break;
+          case EQ: r = a == b; break;
+          case LT: r = a < b; break;
+          case GT: r = a > b; break;
+          case AND: r = a && b; break;
+          case OR: r = a || b; break;
+          case ANGDIFF:
+            r = (int32_t)((uint32_t)a - (uint32_t)b) % 36000;
+            if (r >= 18000) r -= 36000;
+            if (r < -18000) r += 36000;
+            break;
+        }
+        push(r);
+        break;
+      }
+    }
+  }
+done:
+  stats_.ticks++;
+  stats_.insns += n;
+  if (n > stats_.maxInsns) stats_.maxInsns = n;
+  return n;
+}
+
+const char* BehaviorVm::stateName(uint8_t s) {
+  static const char* const kNames[] = {"empty", "ready", "running", "sleeping", "halted", "fault", "stopped"};
+  return s <= STOPPED ? kNames[s] : "?";
+}
+
+const char* BehaviorVm::errorName(uint8_t e) {
+  static const char* const kNames[] = {"ok",        "bad-size",        "bad-op",         "bad-operand",
+                                       "bad-jump",  "stack-underflow", "stack-overflow", "stack-mismatch",
+                                       "falls-off", "div-zero"};
+  return e <= DIV_ZERO ? kNames[e] : "?";
+}
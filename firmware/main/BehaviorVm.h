@@ -0,0 +1,147 @@
+// firmware/src/BehaviorVm.h
+#pragma once
+#include <Arduino.h>
+#include "Config.h"
+
+// Onboard behaviour interpreter: conditional logic ("drive 500 mm, then turn 90°")
+// decided on the device tick instead of one Wi-Fi round-trip per decision.
+//
+// Stack machine over int32 with a fixed budget and no heap: BEH_CODE_MAX bytes of
+// code, BEH_STACK stack slots, BEH_LOCALS locals. load() verifies the whole program
+// before it can run: known opcodes with in-range operands, jump targets on instruction
+// boundaries, one stack depth per instruction on every path (never below 0 or above
+// BEH_STACK), no path running off the end. At run time only DIV/MOD by zero faults.
+// tick() executes at most BEH_INSN_PER_TICK instructions and continues where it
+// stopped on the next tick; YIELD and SLEEP end a tick early.
+//
+// Encoding: 1-byte opcode, operands little-endian, jump targets absolute offsets.
+// The assembler is server/src/behaviors.ts.
+class BehaviorVm {
+public:
+  enum Op : uint8_t {
+    HALT = 0x00,     // end (wheels released)
+    YIELD = 0x01,    // end this tick
+    SLEEP = 0x02,    // ms ->            (0..60000)
+    PUSH8 = 0x10,    // +i8  -> v
+    PUSH16 = 0x11,   // +i16 -> v
+    PUSH32 = 0x12,   // +i32 -> v
+    LOAD = 0x13,     // +u8 local -> v
+    STORE = 0x14,    // +u8 local, v ->
+    DUP = 0x15,      // a -> a a
+    DROP = 0x16,     // a ->
+    SWAP = 0x17,     // a b -> b a
+    OVER = 0x18,     // a b -> a b a
+    ADD = 0x20,      // a b -> a+b (wraps)
+    SUB = 0x21,
+    MUL = 0x22,
+    DIV = 0x23,      // truncating; b == 0 faults
+    MOD = 0x24,
+    NEG = 0x25,      // a -> -a
+    ABS = 0x26,
+    MIN = 0x27,      // a b -> min
+    MAX = 0x28,
+    EQ = 0x30,       // a b -> a==b (0/1)
+    LT = 0x31,
+    GT = 0x32,
+    NOT = 0x33,      // a -> !a
+    AND = 0x34,      // logical
+    OR = 0x35,
+    ANGDIFF = 0x38,  // a b -> a-b wrapped into [-18000, 18000) (centidegrees)
+    JMP = 0x40,      // +u16 target
+    JZ = 0x41,       // +u16 target, c ->   (jump if c == 0)
+    JNZ = 0x42,
+    IN = 0x50,       // +u8 sensor -> v
+    DRIVE = 0x60,    // left right ->   (pct, clamped to -100..100)
+    STOP = 0x61,     // drive 0 0
+    ARM = 0x62,      // angle ->        (0..180)
+    NECK = 0x63,
+  };
+
+  enum Sensor : uint8_t {
+    T_MS,          // ms since start
+    X_MM,          // odometry pose
+    Y_MM,
+    HEADING_CDEG,  // 0..35999, CCW positive
+    V_MMS,         // body speed
+    W_MRADS,
+    WHEEL_L,       // applied pct on the bus
+    WHEEL_R,
+    ARM_BUSY,      // servo move in progress (0/1)
+    NECK_BUSY,
+    SENSOR_COUNT
+  };
+
+  enum State : uint8_t { EMPTY, READY, RUNNING, SLEEPING, HALTED, FAULT, STOPPED };
+
+  enum Error : uint8_t {
+    OK,
+    BAD_SIZE,         // empty or over BEH_CODE_MAX
+    BAD_OP,           // unknown opcode
+    BAD_OPERAND,      // truncated, local/sensor out of range
+    BAD_JUMP,         // target outside the code or inside an instruction
+    STACK_UNDERFLOW,
+    STACK_OVERFLOW,
+    STACK_MISMATCH,   // paths join with different depths
+    FALLS_OFF,        // a path reaches the end without HALT/JMP
+    DIV_ZERO,         // run time
+  };
+
+  // Device side, provided by TaskRunner (plain function pointers, no vtable)
+  struct Io {
+    void* ctx;
+    int32_t (*sense)(void* ctx, uint8_t sensor);  // everything but T_MS
+    void (*drive)(void* ctx, int8_t left, int8_t right);
+    void (*servo)(void* ctx, uint8_t op, uint8_t angle);  // op = ARM / NECK
+  };
+
+  struct Stats {
+    uint32_t ticks;     // ticks with at least one instruction
+    uint32_t insns;
+    uint16_t maxInsns;  // most in one tick (<= BEH_INSN_PER_TICK)
+  };
+
+  // Verify and keep a program (READY). On failure the previous one is gone too and
+  // errPc points at the offending instruction.
+  Error load(const uint8_t* code, size_t len, uint16_t& errPc);
+  static Error verify(const uint8_t* code, size_t len, uint16_t& errPc);
+
+  void start(uint32_t now);  // from the top, locals and stack cleared
+  void stop();               // RUNNING/SLEEPING -> STOPPED
+
+  // One control tick; returns the instructions executed
+  uint16_t tick(uint32_t now, const Io& io);
+
+  State state() const { return state_; }
+  bool active() const { return state_ == RUNNING || state_ == SLEEPING; }
+  Error error() const { return error_; }
+  uint16_t pc() const { return pc_; }
+  uint16_t size() const { return len_; }
+  const Stats& stats() const { return stats_; }
+
+  static const char* stateName(uint8_t s);
+  static const char* errorName(uint8_t e);
+
+private:
+  struct OpInfo {
+    uint8_t size;  // incl. opcode
+    uint8_t pops;
+    uint8_t pushes;
+  };
+  static bool info(uint8_t op, OpInfo& out);
+
+  int32_t pop() { return stack_[--sp_]; }
+  void push(int32_t v) { stack_[sp_++] = v; }
+  void fault(Error e);
+
+  uint8_t code_[BEH_CODE_MAX] = {};
+  uint16_t len_ = 0;
+  int32_t stack_[BEH_STACK] = {};
+  int32_t locals_[BEH_LOCALS] = {};
+  uint8_t sp_ = 0;
+  uint16_t pc_ = 0;
+  uint32_t startMs_ = 0;
+  uint32_t wakeMs_ = 0;
+  State state_ = EMPTY;
+  Error error_ = OK;
+  Stats stats_{};
+};
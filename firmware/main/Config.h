@@ -10,6 +10,10 @@
 #ifndef WS_HOST
 #define WS_HOST "192.168.1.5"
 #endif
+// Extra servers after WS_HOST:WS_PORT, in priority order: "host:port,host:port"
+#ifndef WS_FALLBACK_ENDPOINTS
+#define WS_FALLBACK_ENDPOINTS ""
+#endif
 
 // Allow override via Config.local.h
 #if __has_include("Config.local.h")
@@ -25,25 +29,160 @@ static constexpr uint16_t WS_PORT = 8080;
 static constexpr const char* WS_PATH = "/robot";
 static constexpr uint32_t WS_RECONNECT_BASE_MS = 1000;
 static constexpr uint32_t WS_RECONNECT_MAX_MS = 5000;
+static constexpr uint32_t WIFI_CHECK_MS = 500;  // Wi-Fi status poll while connecting / link check
+
+// ==== Server endpoints / failover ====
+// Prioritised list (WS_HOST:WS_PORT, then WS_FALLBACK_ENDPOINTS; a list pushed by the
+// server replaces it and is kept in LittleFS). Every IPv4 endpoint gets a TCP connect
+// probe per EP_PROBE_MS; EP_PROBE_FAILS missed rounds in a row mark it down.
+static constexpr uint8_t EP_MAX = 4;
+static constexpr uint8_t EP_HOST_LEN = 32;             // incl. terminator
+static constexpr uint32_t EP_PROBE_MS = 250;           // probe round (also the probe timeout)
+static constexpr uint8_t EP_PROBE_FAILS = 2;
+static constexpr uint32_t EP_FAILOVER_HOLD_MS = 1000;  // live lease kept at most this long across a failover
 
 // ==== Meccano M.A.X bus wiring (REAL-only) ====
+// Device channel/position/direction wiring is declared in DeviceTopology.h
 static constexpr uint8_t MAX_DATA_PIN = D4;
-static constexpr uint8_t MAX_LEFT_POS = 0;
-static constexpr uint8_t MAX_RIGHT_POS = 1;
-static constexpr bool LEFT_FORWARD_IS_CCW = true;
-static constexpr bool RIGHT_FORWARD_IS_CCW = false;
 static constexpr uint32_t WHEELS_TICK_MS = 33;
+#ifndef SOFT_STOP_TIMEOUT_MS
 static constexpr uint32_t SOFT_STOP_TIMEOUT_MS = 150;
+#endif
 static constexpr uint32_t HARD_STOP_TIMEOUT_MS = 400;
 static constexpr uint32_t MAX_KEEPALIVE_MS = 250;
+// Control loop tuning (firmware/bench overrides these with -D to compare strategies)
+#ifndef WHEELS_SLEW_X100_PER_TICK
+static constexpr int16_t WHEELS_SLEW_X100_PER_TICK = 67;  // max |delta pct| per tick x100 (~20 %/s at 30 Hz)
+#endif
+#ifndef WHEELS_PCT_DEADZONE
+static constexpr int8_t WHEELS_PCT_DEADZONE = 2;          // re-send a wheel only after it moved this much
+#endif
+static constexpr uint32_t LEASE_MIN_TTL_MS = 100;   // server motion lease TTL is clamped to this range
+static constexpr uint32_t LEASE_MAX_TTL_MS = 2000;  // (advertised in hello as `lease`)
+
+// ==== Adaptive wheels tick ====
+static constexpr uint32_t WHEELS_TICK_IDLE_MS = 100;     // tick period once parked (target 0, settled)
+static constexpr uint32_t WHEELS_SETTLE_MS = 300;        // stopped this long before dropping to idle tick
+static constexpr uint32_t MAX_KEEPALIVE_IDLE_MS = 1000;  // STOP refresh while parked
+static constexpr uint32_t RATE_WINDOW_MS = 1000;         // achieved Hz / bus duty measurement window
+
+// ==== Power-aware idle ====
+// Parked this long: the radio light-sleeps between DTIM beacons and loop() sleeps to
+// the next device tick. Any work switches back to full power in the same pass.
+static constexpr bool POWER_IDLE = true;
+static constexpr uint32_t POWER_IDLE_ENTER_MS = 3000;    // parked time before going idle
+static constexpr uint32_t POWER_IDLE_MAX_SLEEP_MS = WHEELS_TICK_IDLE_MS;  // longest sleep slice
+static constexpr uint8_t POWER_LISTEN_INTERVAL = 0;      // DTIM beacons between wakes (0 = every one)
+
+// ==== Warm start (RTC snapshot) ====
+static constexpr uint32_t RTC_SNAPSHOT_OFFSET = 0;     // RTC user memory block (4-byte units)
+static constexpr uint32_t RTC_SNAPSHOT_MS = 1000;      // refresh of seq/pose in the snapshot
+static constexpr uint32_t WARM_WIFI_POLL_MS = 20;      // Wi-Fi status poll while rejoining warm
+static constexpr uint32_t WARM_WIFI_TIMEOUT_MS = 3000; // then fall back to scan + DHCP
+
+// ==== Task stream flow control ====
+static constexpr uint8_t TASK_QUEUE_CAPACITY = 8;     // queued wheels tasks (advertised as window)
+static constexpr uint32_t FLOW_ACK_DELAY_MS = 20;     // coalesce cumulative acks within this window
+
+// ==== Synchronised start (task.group) ====
+static constexpr uint8_t TASK_GROUP_SLOTS = 2;             // groups waiting for their start time
+static constexpr uint32_t TASK_GROUP_MAX_AHEAD_MS = 10000; // reject start times further out (bad clock offset)
+
+// ==== Command arbitration ====
+// Wheels setpoint sources, highest priority first: live drive, task.group, behaviour
+// VM, macro, task queue (DriveArbiter). A source keeps the wheels this long after its
+// last update (0 = until released or its task duration ends); lease frames renew live/group.
+static constexpr uint32_t ARB_TIMEOUT_MS[5] = {HARD_STOP_TIMEOUT_MS, HARD_STOP_TIMEOUT_MS, 0, 0, 0};
+
+// ==== Receive path ====
+static constexpr uint8_t RX_DRAIN_MAX_FRAMES = 8;  // frames read per loop() before applying the newest drive
+static constexpr size_t RX_HOLD_BYTES = 256;       // largest drive frame that can be held back for elision
+
+// ==== UDP drive channel ====
+// Drive/stop datagrams beside the WS session (offered in hello as `udp`, enabled by
+// the server's `udp` envelope). Newest seq wins; WS keeps tasks/telemetry/control.
+static constexpr uint16_t UDP_DRIVE_PORT = 4210;   // 0 = not offered
+static constexpr uint8_t UDP_DRAIN_MAX = 8;         // datagrams read per loop() before applying the newest
+
+// ==== Periodic scheduler ====
+// Fixed-rate jobs (device tick, Wi-Fi check, endpoint probe, link, odom, heap, RTC snapshot,
+// report); lateness and overrun histograms go out in a "sched" envelope every SCHED_REPORT_MS.
+static constexpr uint8_t SCHED_SLOTS = 8;
+static constexpr uint32_t SCHED_HIST_BASE_US = 250;     // first histogram bucket bound (doubles per bucket)
+static constexpr uint32_t SCHED_REPORT_MS = 10000;      // 0 = no report
+static constexpr uint32_t SCHED_TICK_BUDGET_US = 2000;  // device tick (MAX_BUS_PARALLEL: frames are queued)
+static constexpr uint32_t SCHED_NET_BUDGET_US = 1000;   // every NetClient job (Wi-Fi check, probes, telemetry, report)
+
+// ==== Coroutines ====
+static constexpr uint8_t TASK_COROUTINE_SLOTS = 4;  // concurrent device sequences in TaskRunner
+
+// ==== Motion macros (LittleFS) ====
+static constexpr uint8_t MACRO_SLOTS = 8;        // macro ids 0..7
+static constexpr uint8_t MACRO_MAX_STEPS = 24;   // 6 bytes/step; hex upload must fit the 512-byte parse doc
+
+// ==== Behaviour VM (behavior.load) ====
+static constexpr uint16_t BEH_CODE_MAX = 160;       // bytecode; hex upload must fit the 512-byte parse doc
+static constexpr uint8_t BEH_STACK = 16;            // int32 slots
+static constexpr uint8_t BEH_LOCALS = 8;
+static constexpr uint16_t BEH_INSN_PER_TICK = 64;   // instruction budget per device tick
 
 // WebSocket heartbeat settings (must match server)
 static constexpr uint32_t WS_HEARTBEAT_INTERVAL_MS = 15000;  // ping every 15s
 static constexpr uint32_t WS_HEARTBEAT_TIMEOUT_MS = 3000;    // wait for pong 3s
 static constexpr uint8_t WS_HEARTBEAT_TRIES = 2;             // fail after 2 missed pongs
 
+// ==== Heap telemetry ====
+static constexpr uint32_t HEAP_STATS_INTERVAL_MS = 10000;    // periodic "stats" envelope
+static constexpr uint32_t HEAP_ALERT_CHECK_MS = 1000;        // alert probe cadence
+static constexpr uint32_t HEAP_ALERT_FREE_BYTES = 8192;      // alert below this free heap
+static constexpr uint32_t HEAP_ALERT_MAX_BLOCK_BYTES = 2048; // alert below this largest block
+static constexpr uint8_t HEAP_ALERT_FRAG_PCT = 50;           // alert at/above this fragmentation
+
+// ==== Odometry (dead reckoning) ====
+static constexpr uint16_t ODOM_WHEEL_MM_S_MAX = 300;  // wheel rim speed at CMD_SPEED_MAX (calibrate per robot)
+static constexpr uint16_t ODOM_TRACK_MM = 160;        // distance between the wheel contact patches (calibrate)
+static constexpr uint16_t ODOM_SCALE_L_PERMILLE = 1000;  // per-wheel trim for uneven motors/tyres
+static constexpr uint16_t ODOM_SCALE_R_PERMILLE = 1000;
+static constexpr uint32_t ODOM_STREAM_MS = 200;       // "odom" envelope period while moving (0 = off)
+static constexpr uint32_t ODOM_IDLE_STREAM_MS = 2000; // heartbeat period while the pose is unchanged
+
+// ==== Twist drive ====
+// `twist` (v mm/s, w mrad/s) is mixed on the ESP with the odometry geometry above and
+// ramped with these per-axis limits instead of the per-wheel slew limit.
+static constexpr int32_t TWIST_ACCEL_MM_S2 = 150;     // forward acceleration limit
+static constexpr int32_t TWIST_ALPHA_MRAD_S2 = 1500;  // yaw acceleration limit
+
+// ==== Link quality ====
+// LinkMonitor grades the link GOOD/FAIR/POOR from RSSI, probe RTT/loss and send
+// failures; the grade picks the telemetry budget and the command rate advertised
+// to the server (`link` envelope). Downgrades are immediate, upgrades need a clean hold.
+static constexpr uint32_t LINK_SAMPLE_MS = 1000;          // RSSI sample period
+static constexpr uint32_t LINK_PROBE_MS = 2000;           // RTT probe period ("probe" echo)
+static constexpr uint32_t LINK_PROBE_TIMEOUT_MS = 1500;   // unanswered probe counts as lost
+static constexpr uint32_t LINK_REPORT_MS = 10000;         // periodic "link" envelope (also sent on grade change)
+static constexpr uint32_t LINK_UPGRADE_HOLD_MS = 5000;    // better grade must hold this long
+static constexpr int8_t LINK_RSSI_FAIR_DBM = -70;         // below: FAIR
+static constexpr int8_t LINK_RSSI_POOR_DBM = -80;         // below: POOR
+static constexpr uint16_t LINK_RTT_FAIR_MS = 60;          // smoothed RTT above: FAIR
+static constexpr uint16_t LINK_RTT_POOR_MS = 200;         // smoothed RTT above: POOR
+static constexpr uint8_t LINK_CMD_HZ[3] = {20, 10, 5};     // advised drive command rate per grade
+static constexpr uint8_t LINK_TLM_PER_SEC[3] = {10, 5, 2}; // outbound telemetry budget per grade
+static constexpr uint8_t LINK_ODOM_MUL[3] = {1, 2, 5};     // odom stream period multiplier per grade
+
+// ==== Binary telemetry ====
+static constexpr bool TLM_BINARY = true;           // use it when the server hello offers tlm >= 1
+static constexpr uint8_t TLM_KEYFRAME_EVERY = 32;  // records per type between keyframes (>= 2)
+
 // ==== Meccano M.A.X Protocol Constants ====
 namespace MAXProtocol {
+  // Bus layout: up to 4 channels (chains), 4 device positions per chain
+  static constexpr uint8_t CHANNEL_COUNT = 4;
+  static constexpr uint8_t POSITIONS_PER_CHANNEL = 4;
+  static constexpr uint8_t CH_MOTORS = 0;
+  static constexpr uint8_t CH_SERVOS = 1;
+  static constexpr uint8_t CH_FACE = 2;
+  static constexpr uint8_t CH_IR = 3;
+
   // Speed commands
   static constexpr uint8_t CMD_STOP = 0x40;
   static constexpr uint8_t CMD_SPEED_MIN = 0x42;  // Lowest non-zero speed
@@ -58,4 +197,14 @@ namespace MAXProtocol {
   static constexpr uint8_t dirByte(uint8_t pos, bool ccw) {
     return (ccw ? DIR_CCW_MASK : DIR_CW_MASK) | (pos & DIR_POS_MASK);
   }
-}
\ No newline at end of file
+}
+// ==== Multi-channel MAX bus ====
+// false: MeccaChannel library on MAX_DATA_PIN (motors only, one blocking frame per call)
+// true:  MaxBus - one timer1 ISR clocks every wired channel in the same bit slots,
+//        frames are queued per channel and never block the main loop
+static constexpr bool MAX_BUS_PARALLEL = false;
+static constexpr uint8_t MAX_PIN_UNUSED = 0xFF;
+// GPIO per channel: motors, servos, face, IR (GPIO0..15 only)
+static constexpr uint8_t MAX_CHANNEL_PINS[MAXProtocol::CHANNEL_COUNT] = {
+    MAX_DATA_PIN, MAX_PIN_UNUSED, MAX_PIN_UNUSED, MAX_PIN_UNUSED};
+static constexpr uint32_t MAX_REPLY_WINDOW_US = 10000;  // lines released for the module reply
@@ -0,0 +1,124 @@
+// firmware/src/Coroutine.h
+#pragma once
+#include <Arduino.h>
+
+// ==== Stackless coroutines (protothread style) ====
+// A coroutine is a function `bool fn(CoState& co, void* ctx, uint32_t now)` whose body
+// is wrapped in CO_BEGIN/CO_END and returns true once finished. Suspension points
+// record __LINE__ in CoState and return; the next resume jumps straight back there.
+//
+// Locals do NOT survive a suspension: keep loop counters/deadlines in ctx (or CoState).
+// Do not put a suspension point inside a nested `switch`.
+//
+//   bool blink(CoState& co, void* ctx, uint32_t now) {
+//     CO_BEGIN(co);
+//     while (true) {
+//       toggle();
+//       CO_AWAIT_MS(co, now, 500);
+//       CO_AWAIT_TARGET(co, static_cast<Robot*>(ctx)->wheels());
+//     }
+//     CO_END(co);
+//   }
+
+struct CoState {
+  uint16_t line = 0;       // resume point (0 = start)
+  uint32_t waitStart = 0;  // CO_AWAIT_MS anchor
+
+  static constexpr uint16_t DONE = 0xFFFF;
+  void reset() { line = 0; waitStart = 0; }
+  bool done() const { return line == DONE; }
+};
+static_assert(sizeof(CoState) == 8, "CoState is the fixed per-coroutine state");
+
+#define CO_BEGIN(co) switch ((co).line) { case 0:
+
+#define CO_END(co) \
+  }                \
+  (co).line = CoState::DONE; \
+  return true
+
+// Suspend once, resume on the next scheduler pass
+#define CO_YIELD(co)        \
+  do {                      \
+    (co).line = __LINE__;   \
+    return false;           \
+    case __LINE__:;         \
+  } while (0)
+
+// Suspend until `cond` holds (re-evaluated on every pass)
+#define CO_AWAIT(co, cond)  \
+  do {                      \
+    (co).line = __LINE__;   \
+    [[fallthrough]];        \
+    case __LINE__:          \
+    if (!(cond)) return false; \
+  } while (0)
+
+#define CO_AWAIT_MS(co, now, ms)                           \
+  do {                                                     \
+    (co).waitStart = (now);                                \
+    CO_AWAIT(co, (uint32_t)((now) - (co).waitStart) >= (uint32_t)(ms)); \
+  } while (0)
+
+// Absolute deadline (wrap-safe); use for drift-free schedules
+#define CO_AWAIT_UNTIL(co, now, deadline) CO_AWAIT(co, (int32_t)((now) - (deadline)) >= 0)
+
+// Wheels (WheelsDevice): last command on the wire / slew ramp finished
+#define CO_AWAIT_BUS_IDLE(co, wheels) CO_AWAIT(co, (wheels).busIdle())
+#define CO_AWAIT_TARGET(co, wheels) CO_AWAIT(co, (wheels).targetReached())
+
+// Fixed-capacity cooperative scheduler: no heap, one CoState per slot.
+// Resumes every live coroutine once per run(); tracks scheduling overhead.
+template <uint8_t N>
+class CoScheduler {
+ public:
+  using CoFn = bool (*)(CoState& co, void* ctx, uint32_t now);
+
+  // Returns slot id, or -1 if full
+  int8_t spawn(CoFn fn, void* ctx) {
+    for (uint8_t i = 0; i < N; ++i) {
+      if (!slots_[i].fn) {
+        slots_[i].fn = fn;
+        slots_[i].ctx = ctx;
+        slots_[i].state.reset();
+        return (int8_t)i;
+      }
+    }
+    return -1;
+  }
+
+  void kill(int8_t id) {
+    if (id >= 0 && id < N) slots_[id].fn = nullptr;
+  }
+
+  bool alive(int8_t id) const { return id >= 0 && id < N && slots_[id].fn != nullptr; }
+
+  void run(uint32_t now) {
+    for (uint8_t i = 0; i < N; ++i) {
+      Slot& s = slots_[i];
+      if (!s.fn) continue;
+      const uint32_t t0 = micros();
+      const bool finished = s.fn(s.state, s.ctx, now);
+      const uint32_t dt = micros() - t0;
+      resumes_++;
+      totalUs_ += dt;
+      if (dt > maxResumeUs_) maxResumeUs_ = dt;
+      if (finished) s.fn = nullptr;
+    }
+  }
+
+  uint32_t resumes() const { return resumes_; }
+  uint32_t maxResumeUs() const { return maxResumeUs_; }
+  uint32_t avgResumeUs() const { return resumes_ ? totalUs_ / resumes_ : 0; }
+
+ private:
+  struct Slot {
+    CoFn fn = nullptr;
+    void* ctx = nullptr;
+    CoState state;
+  };
+  Slot slots_[N];
+  uint32_t resumes_ = 0;
+  uint32_t totalUs_ = 0;
+  uint32_t maxResumeUs_ = 0;
+};
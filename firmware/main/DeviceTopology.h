@@ -0,0 +1,21 @@
+// firmware/src/DeviceTopology.h
+#pragma once
+
+#include "Devices/DeviceRegistry.h"
+#include "Devices/WheelsDevice.h"
+#include "Devices/ArmDevice.h"
+#include "Devices/NeckDevice.h"
+
+// ==== Robot device topology (MAX bus wiring) ====
+// MaxPort<channel, position, forwardIsCcw>. Two devices on the same channel/position
+// fail to compile. To add a device type, declare its DeviceSlot here.
+//
+// If the robot moves backward when commanded to go forward, flip the forwardIsCcw
+// flag of the wheel ports.
+using WheelsLeftPort = MaxPort<MAXProtocol::CH_MOTORS, 0, true>;
+using WheelsRightPort = MaxPort<MAXProtocol::CH_MOTORS, 1, false>;
+
+using RobotDevices = DeviceRegistry<
+    DeviceSlot<WheelsDevice, WheelsLeftPort, WheelsRightPort>,
+    DeviceSlot<ArmDevice, MaxPort<MAXProtocol::CH_SERVOS, 0>>,
+    DeviceSlot<NeckDevice, MaxPort<MAXProtocol::CH_SERVOS, 1>>>;
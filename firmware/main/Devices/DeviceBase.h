@@ -1,22 +1,34 @@
 #pragma once
 
 #include <Arduino.h>
+#include "../Config.h"
 #include "../TaskTypes.h"
 
+// Runtime view of a port, handed to Device::begin()
+struct MaxPortInfo {
+  uint8_t channel;
+  uint8_t position;
+  bool forwardIsCcw;
+
+  constexpr uint8_t dirByte(bool forward) const {
+    return MAXProtocol::dirByte(position, forward ? forwardIsCcw : !forwardIsCcw);
+  }
+};
+
+// CRTP base: optional hooks with default no-op behaviour. Devices shadow what they
+// need; calls are resolved against the concrete type at compile time.
+template <typename Derived>
 class DeviceBase {
  public:
-  virtual ~DeviceBase() = default;
-  virtual const char* deviceName() const = 0;
-  virtual void startTask(const TaskEnvelope& task, uint32_t now) = 0;
-  virtual void tick(uint32_t now) = 0;
-  virtual void cancel(uint32_t now) = 0;
-  virtual void finish() = 0;
-  virtual bool isRunning() const = 0;
-  virtual bool isCompleted(uint32_t now) const = 0;
-  virtual uint8_t progress(uint32_t now) const = 0;
-  virtual String currentTaskId() const = 0;
+  static constexpr uint8_t PORT_COUNT = 1;
+
+  void begin(const MaxPortInfo* ports, uint8_t count) { (void)ports; (void)count; }
 
   // Optional: allow devices to update an in-flight task with new parameters.
   // Default returns false (not supported).
-  virtual bool tryUpdate(const TaskEnvelope& task, uint32_t now) { (void)task; (void)now; return false; }
+  bool tryUpdate(const TaskEnvelope& task, uint32_t now) { (void)task; (void)now; return false; }
+
+ protected:
+  Derived& self() { return static_cast<Derived&>(*this); }
+  const Derived& self() const { return static_cast<const Derived&>(*this); }
 };
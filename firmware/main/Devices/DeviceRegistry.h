@@ -0,0 +1,90 @@
+// firmware/src/Devices/DeviceRegistry.h
+#pragma once
+
+#include <Arduino.h>
+#include <tuple>
+#include <utility>
+#include "DeviceBase.h"
+
+// ==== Compile-time device topology ====
+// A device declares its MAX bus wiring as one or more MaxPort<> entries inside a
+// DeviceSlot<>. DeviceRegistry<> owns one instance per slot, checks the bus layout
+// at compile time and dispatches begin/tick/cancel statically (no vtable).
+
+template <uint8_t Channel, uint8_t Position, bool ForwardIsCcw = false>
+struct MaxPort {
+  static_assert(Channel < MAXProtocol::CHANNEL_COUNT, "MAX channel out of range");
+  static_assert(Position < MAXProtocol::POSITIONS_PER_CHANNEL, "MAX position out of range");
+
+  static constexpr MaxPortInfo info{Channel, Position, ForwardIsCcw};
+  static constexpr uint16_t bit = uint16_t(1u << (Channel * MAXProtocol::POSITIONS_PER_CHANNEL + Position));
+};
+
+template <typename Device, typename... Ports>
+struct DeviceSlot {
+  using type = Device;
+  static constexpr uint8_t portCount = sizeof...(Ports);
+  static constexpr uint16_t mask = (uint16_t(0) | ... | Ports::bit);
+  static constexpr MaxPortInfo ports[portCount > 0 ? portCount : 1] = {Ports::info...};
+
+  static_assert(portCount == Device::PORT_COUNT, "DeviceSlot port count does not match Device::PORT_COUNT");
+};
+
+template <typename... Slots>
+class DeviceRegistry {
+ public:
+  static constexpr size_t SIZE = sizeof...(Slots);
+
+  void begin() {
+    (get<typename Slots::type>().begin(Slots::ports, Slots::portCount), ...);
+  }
+
+  void tick(uint32_t now) {
+    (get<typename Slots::type>().tick(now), ...);
+  }
+
+  void cancel(uint32_t now) {
+    (get<typename Slots::type>().cancel(now), ...);
+  }
+
+  template <typename Device>
+  Device& get() { return std::get<Device>(devices_); }
+
+  template <typename Device>
+  const Device& get() const { return std::get<Device>(devices_); }
+
+  // Visit every device in declaration order
+  template <typename F>
+  void forEach(F&& f) {
+    (f(get<typename Slots::type>()), ...);
+  }
+
+  // Visit the device whose deviceName() matches; returns false if none does
+  template <typename F>
+  bool withDevice(const char* name, F&& f) {
+    bool found = false;
+    ((!found && strcmp(get<typename Slots::type>().deviceName(), name) == 0
+          ? (f(get<typename Slots::type>()), found = true)
+          : false),
+     ...);
+    return found;
+  }
+
+  // Bitmask of every occupied (channel, position)
+  static constexpr uint16_t busMask() { return (uint16_t(0) | ... | Slots::mask); }
+
+ private:
+  std::tuple<typename Slots::type...> devices_;
+
+  static constexpr bool layoutIsUnique() {
+    uint16_t seen = 0;
+    bool ok = true;
+    ((ok = ok && (seen & Slots::mask) == 0 &&
+           __builtin_popcount(Slots::mask) == Slots::portCount,
+      seen |= Slots::mask),
+     ...);
+    return ok;
+  }
+
+  static_assert(layoutIsUnique(), "MAX bus layout: two devices (or ports) declared on the same channel/position");
+};
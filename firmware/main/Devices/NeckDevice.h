@@ -3,18 +3,18 @@
 #include "DeviceBase.h"
 #include "DeviceState.h"
 
-class NeckDevice : public DeviceBase {
+class NeckDevice : public DeviceBase<NeckDevice> {
  public:
   NeckDevice();
-  const char* deviceName() const override;
-  void startTask(const TaskEnvelope& task, uint32_t now) override;
-  void tick(uint32_t now) override;
-  void cancel(uint32_t now) override;
-  void finish() override;
-  bool isRunning() const override;
-  bool isCompleted(uint32_t now) const override;
-  uint8_t progress(uint32_t now) const override;
-  String currentTaskId() const override;
+  const char* deviceName() const;
+  void startTask(const TaskEnvelope& task, uint32_t now);
+  void tick(uint32_t now);
+  void cancel(uint32_t now);
+  void finish();
+  bool isRunning() const;
+  bool isCompleted(uint32_t now) const;
+  uint8_t progress(uint32_t now) const;
+  String currentTaskId() const;
 
  private:
   TaskEnvelope current;
@@ -3,29 +3,34 @@
 #include "../Config.h"
 #include <math.h>
 
-static constexpr int8_t PCT_DEADZONE = 2;
-
-void WheelsDevice::begin() {
+void WheelsDevice::begin(const MaxPortInfo* ports, uint8_t count) {
+  if (ports && count >= PORT_COUNT) {
+    portL_ = ports[0];
+    portR_ = ports[1];
+  }
   targetPctL_ = targetPctR_ = 0;
   currentPctL_ = currentPctR_ = 0;
   slewAccumL_ = slewAccumR_ = 0;
   lastSentPctL_ = lastSentPctR_ = 127; // 127 = "unset"
   lastCmdAt_ = millis();
+  motionUntil_ = lastCmdAt_;
+  leaseHeld_ = false;
   deadlineAt_ = 0;
   lastBusWriteMs_ = 0;
   lastNonZeroMs_ = 0;
   lastTickMs_ = millis();
+  lastOdomMs_ = lastTickMs_;
   lastBusErrorMs_ = 0;
   consecutiveBusErrors_ = 0;
 
-  // Init MAX bus (REAL-only)
-  if (!maxBus_) {
+  // Init MAX bus (REAL-only). MaxBus is started by TaskRunner before the devices.
+  if (!MAX_BUS_PARALLEL && !maxBus_) {
     maxBus_ = new MeccaChannel(MAX_DATA_PIN);
   }
 
   // Send initial communication to activate devices on bus
-  if (maxBus_) {
-    maxBus_->communicate();
+  if (busReady()) {
+    if (!MAX_BUS_PARALLEL) maxBus_->communicate();
     // Verify bus is working
     if (!verifyBusCommunication()) {
       Serial.println("[WHEELS] WARNING: MAX bus initialization check failed");
@@ -35,73 +40,134 @@ void WheelsDevice::begin() {
   }
 }
 
-void WheelsDevice::setTarget(int8_t leftPct, int8_t rightPct, uint32_t durationMs) {
+void WheelsDevice::setTarget(int8_t leftPct, int8_t rightPct, uint32_t durationMs, bool shaped) {
   // Constrain to -100..100
   targetPctL_ = constrain(leftPct, -100, 100);
   targetPctR_ = constrain(rightPct, -100, 100);
+  shaped_ = shaped;
   lastCmdAt_ = millis();
+  extendMotion(lastCmdAt_, HARD_STOP_TIMEOUT_MS);
   deadlineAt_ = durationMs ? (lastCmdAt_ + durationMs) : 0;
 }
 
+void WheelsDevice::grantLease(uint32_t now, uint32_t ttlMs) {
+  if (ttlMs == 0) {
+    motionUntil_ = now;
+    leaseHeld_ = false;
+    return;
+  }
+  extendMotion(now, constrain(ttlMs, LEASE_MIN_TTL_MS, LEASE_MAX_TTL_MS));
+  leaseHeld_ = true;
+}
+
+void WheelsDevice::enforceLease(uint32_t now) {
+  if ((int32_t)(now - motionUntil_) <= 0 || stopped()) return;
+  if (leaseHeld_) {
+    Serial.printf("[WHEELS] lease expired (%lums late cmd)\n", (unsigned long)(now - lastCmdAt_));
+    leaseHeld_ = false;
+  }
+  emergencyStop();
+}
+
 void WheelsDevice::emergencyStop() {
+  const uint32_t now = millis();
+  integrateOdometry(now);
+  // Stop fast path + regular handler both land here: one STOP frame per tick is enough
+  const bool stopJustSent = stopped() && (now - lastBusWriteMs_) < WHEELS_TICK_MS;
   targetPctL_ = targetPctR_ = 0;
   currentPctL_ = currentPctR_ = 0;
   slewAccumL_ = slewAccumR_ = 0;
-  if (maxBus_) {
-    bool wantCCW_L = (0 >= 0) ? (LEFT_FORWARD_IS_CCW != 0) : !(LEFT_FORWARD_IS_CCW != 0);
-    bool wantCCW_R = (0 >= 0) ? (RIGHT_FORWARD_IS_CCW != 0) : !(RIGHT_FORWARD_IS_CCW != 0);
-    uint8_t dirL = dirByte(MAX_LEFT_POS, wantCCW_L);
-    uint8_t dirR = dirByte(MAX_RIGHT_POS, wantCCW_R);
-    maxBus_->communicateAllByte(dirR, dirL, MAXProtocol::CMD_STOP, MAXProtocol::CMD_STOP); // STOP both
-    lastBusWriteMs_ = millis();
-  }
+  deadlineAt_ = 0;
+  if (!stopJustSent) sendStopFrame(now);
   lastSentPctL_ = lastSentPctR_ = 0;
 }
 
-void WheelsDevice::tick() {
-  const uint32_t now = millis();
+// STOP both motors (direction bytes as for forward; speed = CMD_STOP)
+void WheelsDevice::sendStopFrame(uint32_t now) {
+  if (!busReady()) return;
+  writeFrame(portR_.dirByte(true), portL_.dirByte(true), MAXProtocol::CMD_STOP, MAXProtocol::CMD_STOP, now);
+}
+
+// Send: rightDir, leftDir, rightSpeed, leftSpeed (blocking, ~27ms on the wire)
+// With MAX_BUS_PARALLEL the same 4 bytes go to positions 0..3 of the motors channel,
+// queued newest-wins; the call returns at once and the wire time is accounted instead.
+void WheelsDevice::writeFrame(uint8_t dirR, uint8_t dirL, uint8_t spR, uint8_t spL, uint32_t now) {
+  if (MAX_BUS_PARALLEL) {
+    MaxBus::instance().submit(portL_.channel, dirR, dirL, spR, spL);
+    busBusyUs_ += MaxBus::FRAME_US;
+  } else {
+    const uint32_t t0 = micros();
+    maxBus_->communicateAllByte(dirR, dirL, spR, spL);
+    busBusyUs_ += micros() - t0;
+  }
+  busFrames_++;
+  lastBusWriteMs_ = now;
+}
+
+void WheelsDevice::tick(uint32_t now) {
+  // Account for what was on the bus since the previous tick before anything changes it
+  integrateOdometry(now);
 
   // Task deadline check
   if (deadlineAt_ && now >= deadlineAt_) {
     targetPctL_ = 0;
     targetPctR_ = 0;
     deadlineAt_ = 0;
+    shaped_ = false;  // nothing shapes the run-out: slew down as for drive
   }
 
-  // Hard stop: connection lost too long
-  if ((now - lastCmdAt_) > HARD_STOP_TIMEOUT_MS) {
-    emergencyStop();
+  // Hard stop: lease expired (connection lost / no renewal). Once STOP is on the
+  // bus, fall through to the idle keepalive instead of re-sending STOP every tick.
+  if ((int32_t)(now - motionUntil_) > 0 && !stopped()) {
+    enforceLease(now);
     return;
   }
 
   // Main wheel control logic with soft/hard stop guards
-  tickWheels();
-}
-
-// Return 0x2n (CW) or 0x3n (CCW) where n is device position
-uint8_t WheelsDevice::dirByte(uint8_t pos, bool ccw) {
-  return MAXProtocol::dirByte(pos, ccw);
+  tickWheels(now);
 }
 
 // Map percentage (-100..100) to speed byte (CMD_STOP=0x40, 0x42..0x4F are 14 speed steps)
 uint8_t WheelsDevice::speedByteFromPct(int8_t pct) {
-  if (pct <= 0) return MAXProtocol::CMD_STOP;
+  if (pct == 0) return MAXProtocol::CMD_STOP;  // direction is carried by the dir byte
   uint8_t s = constrain(abs(pct), 0, 100);
   // Map to 14 speed steps: 0x42 (min) to 0x4F (max)
   uint8_t code = MAXProtocol::CMD_SPEED_MIN + round(s * (MAXProtocol::CMD_SPEED_MAX - MAXProtocol::CMD_SPEED_MIN) / 100);
   return min(code, MAXProtocol::CMD_SPEED_MAX);
 }
 
+// Rim speed for a percentage as it is quantised on the bus (same 14 steps as speedByteFromPct)
+int16_t WheelsDevice::wheelSpeedMmS(int8_t sentPct, uint16_t scalePermille) {
+  if (sentPct == 0 || sentPct == 127) return 0;  // 127 = nothing sent yet
+  const uint8_t code = speedByteFromPct(sentPct);
+  const uint8_t steps = MAXProtocol::CMD_SPEED_MAX - MAXProtocol::CMD_SPEED_MIN + 1;
+  const int32_t v = (int32_t)ODOM_WHEEL_MM_S_MAX * (code - MAXProtocol::CMD_SPEED_MIN + 1) / steps;
+  const int32_t scaled = v * scalePermille / 1000;
+  return (int16_t)(sentPct < 0 ? -scaled : scaled);
+}
+
+void WheelsDevice::integrateOdometry(uint32_t now) {
+  if ((int32_t)(now - lastOdomMs_) <= 0) return;  // emergencyStop() may run ahead of the loop's `now`
+  odom_.integrate(wheelSpeedMmS(lastSentPctL_, ODOM_SCALE_L_PERMILLE),
+                  wheelSpeedMmS(lastSentPctR_, ODOM_SCALE_R_PERMILLE), now - lastOdomMs_);
+  lastOdomMs_ = now;
+}
+
 // sendMotor() removed - functionality handled directly in tickWheels() for efficiency
 
-void WheelsDevice::tickWheels() {
-  unsigned long now = millis();
-  
-  // Slew-rate limiting: ±0.67 per frame (≈20 per second at 30Hz)
+void WheelsDevice::tickWheels(uint32_t now) {
+
+  // Slew-rate limiting: WHEELS_SLEW_X100_PER_TICK/100 per frame (0.67 ≈ 20 per second at 30Hz)
   // Using fixed-point math (scaled by 100) for fractional accumulator
-  const int16_t MAX_DELTA_PER_FRAME_SCALED = 67; // 0.67 * 100
+  const int16_t MAX_DELTA_PER_FRAME_SCALED = WHEELS_SLEW_X100_PER_TICK;
   uint32_t deltaMs = now - lastTickMs_;
-  if (deltaMs >= WHEELS_TICK_MS) {
+  if (shaped_) {
+    // Pre-shaped setpoint (twist): slewing each wheel on its own would bend the arc
+    currentPctL_ = targetPctL_;
+    currentPctR_ = targetPctR_;
+    slewAccumL_ = slewAccumR_ = 0;
+    lastTickMs_ = now;
+  } else if (deltaMs >= WHEELS_TICK_MS) {
     // Calculate desired change (scaled by 100)
     int16_t targetDeltaL = (targetPctL_ - currentPctL_) * 100;
     int16_t targetDeltaR = (targetPctR_ - currentPctR_) * 100;
@@ -128,50 +194,30 @@ void WheelsDevice::tickWheels() {
   // Soft/hard stop guards
   if (targetPctL_ == 0 && targetPctR_ == 0) {
     if (now - lastNonZeroMs_ > SOFT_STOP_TIMEOUT_MS) {
-      if (lastSentPctL_ != 0) {
-        if (maxBus_) {
-          bool wantCCW_L = (0 >= 0) ? (LEFT_FORWARD_IS_CCW != 0) : !(LEFT_FORWARD_IS_CCW != 0);
-          bool wantCCW_R = (0 >= 0) ? (RIGHT_FORWARD_IS_CCW != 0) : !(RIGHT_FORWARD_IS_CCW != 0);
-          uint8_t dirL = dirByte(MAX_LEFT_POS, wantCCW_L);
-          uint8_t dirR = dirByte(MAX_RIGHT_POS, wantCCW_R);
-          maxBus_->communicateAllByte(dirR, dirL, MAXProtocol::CMD_STOP, MAXProtocol::CMD_STOP); // STOP
-          lastBusWriteMs_ = now;
-        }
-        lastSentPctL_ = 0;
-      }
-      if (lastSentPctR_ != 0) {
-        if (maxBus_) {
-          bool wantCCW_L = (0 >= 0) ? (LEFT_FORWARD_IS_CCW != 0) : !(LEFT_FORWARD_IS_CCW != 0);
-          bool wantCCW_R = (0 >= 0) ? (RIGHT_FORWARD_IS_CCW != 0) : !(RIGHT_FORWARD_IS_CCW != 0);
-          uint8_t dirL = dirByte(MAX_LEFT_POS, wantCCW_L);
-          uint8_t dirR = dirByte(MAX_RIGHT_POS, wantCCW_R);
-          maxBus_->communicateAllByte(dirR, dirL, MAXProtocol::CMD_STOP, MAXProtocol::CMD_STOP); // STOP
-          lastBusWriteMs_ = now;
-        }
-        lastSentPctR_ = 0;
+      if (lastSentPctL_ != 0 || lastSentPctR_ != 0) {
+        sendStopFrame(now);
+        lastSentPctL_ = lastSentPctR_ = 0;
       }
     }
   } else {
     lastNonZeroMs_ = now;
   }
 
-  bool needKeepalive = (now - lastBusWriteMs_) >= MAX_KEEPALIVE_MS;
-  bool changedL = (abs(currentPctL_ - lastSentPctL_) >= PCT_DEADZONE);
-  bool changedR = (abs(currentPctR_ - lastSentPctR_) >= PCT_DEADZONE);
+  const uint32_t keepaliveMs = stopped() ? MAX_KEEPALIVE_IDLE_MS : MAX_KEEPALIVE_MS;
+  bool needKeepalive = (now - lastBusWriteMs_) >= keepaliveMs;
+  bool changedL = (abs(currentPctL_ - lastSentPctL_) >= WHEELS_PCT_DEADZONE);
+  bool changedR = (abs(currentPctR_ - lastSentPctR_) >= WHEELS_PCT_DEADZONE);
 
   if (changedL || changedR || needKeepalive) {
     // Prepare direction and speed bytes for both motors using current (slew-rate limited) values
-    bool wantCCW_L = (currentPctL_ >= 0) ? (LEFT_FORWARD_IS_CCW != 0) : !(LEFT_FORWARD_IS_CCW != 0);
-    uint8_t dirL = dirByte(MAX_LEFT_POS, wantCCW_L);
+    uint8_t dirL = portL_.dirByte(currentPctL_ >= 0);
     uint8_t spL = speedByteFromPct(currentPctL_);
-    
-    bool wantCCW_R = (currentPctR_ >= 0) ? (RIGHT_FORWARD_IS_CCW != 0) : !(RIGHT_FORWARD_IS_CCW != 0);
-    uint8_t dirR = dirByte(MAX_RIGHT_POS, wantCCW_R);
+
+    uint8_t dirR = portR_.dirByte(currentPctR_ >= 0);
     uint8_t spR = speedByteFromPct(currentPctR_);
 
-    if (maxBus_) {
-      // Send: rightDir, leftDir, rightSpeed, leftSpeed
-      maxBus_->communicateAllByte(dirR, dirL, spR, spL);
+    if (busReady()) {
+      writeFrame(dirR, dirL, spR, spL, now);
       
       // Verify communication success (meager check - communicateAllByte doesn't return status)
       // At minimum, update error tracking
@@ -184,8 +230,6 @@ void WheelsDevice::tickWheels() {
           Serial.printf("[WHEELS] ERROR: %u consecutive bus communication failures\n", consecutiveBusErrors_);
         }
       }
-      
-      lastBusWriteMs_ = now;
 #if DEBUG_LOGS
       Serial.printf("[WHEELS] L=%d%% R=%d%% (current L=%d%% R=%d%%) -> dirL=0x%02X dirR=0x%02X spL=0x%02X spR=0x%02X\n",
                     targetPctL_, targetPctR_, currentPctL_, currentPctR_, dirL, dirR, spL, spR);
@@ -195,15 +239,10 @@ void WheelsDevice::tickWheels() {
     lastSentPctR_ = currentPctR_;
   }
 
-  // Hard stop if we somehow haven't written for too long
-  if (now - lastBusWriteMs_ > HARD_STOP_TIMEOUT_MS) {
-    bool wantCCW_L = (0 >= 0) ? (LEFT_FORWARD_IS_CCW != 0) : !(LEFT_FORWARD_IS_CCW != 0);
-    bool wantCCW_R = (0 >= 0) ? (RIGHT_FORWARD_IS_CCW != 0) : !(RIGHT_FORWARD_IS_CCW != 0);
-    uint8_t dirL = dirByte(MAX_LEFT_POS, wantCCW_L);
-    uint8_t dirR = dirByte(MAX_RIGHT_POS, wantCCW_R);
-    if (maxBus_) {
-      maxBus_->communicateAllByte(dirR, dirL, MAXProtocol::CMD_STOP, MAXProtocol::CMD_STOP); // STOP both
-      lastBusWriteMs_ = now;
+  // Hard stop if we somehow haven't written for too long (parked: idle keepalive is slower by design)
+  if (now - lastBusWriteMs_ > HARD_STOP_TIMEOUT_MS && !stopped()) {
+    if (busReady()) {
+      sendStopFrame(now);
 #if DEBUG_LOGS
       Serial.println("[WHEELS] HARD STOP timeout");
 #endif
@@ -218,7 +257,7 @@ void WheelsDevice::tickWheels() {
 bool WheelsDevice::verifyBusCommunication() {
   // Basic verification: check if bus object exists and is initialized
   // Note: MeccaChannel doesn't provide explicit status, so we do minimal verification
-  if (!maxBus_) {
+  if (!busReady()) {
     return false;
   }
   
@@ -3,21 +3,87 @@
 #include <Arduino.h>
 #include "../TaskTypes.h"
 #include "../Config.h"
+#include "DeviceBase.h"
+#include "../MaxBus.h"
+#include "../Odometry.h"
 
 #include <MeccaChannel.h>
 #include <MeccaMaxDrive.h>
 
-class WheelsDevice {
+class WheelsDevice : public DeviceBase<WheelsDevice> {
 public:
-  void begin();
-  void tick(); // Called every WHEELS_TICK_MS
+  static constexpr uint8_t PORT_COUNT = 2;  // ports[0] = left motor, ports[1] = right motor
 
-  // Receive drive command from TaskRunner (units: -100..100)
-  void setTarget(int8_t leftPct, int8_t rightPct, uint32_t durationMs = 0);
+  const char* deviceName() const { return "wheels"; }
+  void begin(const MaxPortInfo* ports, uint8_t count);
+  void tick(uint32_t now); // Called every WHEELS_TICK_MS (WHEELS_TICK_IDLE_MS once parked)
+  void cancel(uint32_t now) { (void)now; emergencyStop(); }
+
+  // Receive drive command from TaskRunner (units: -100..100). shaped = the caller
+  // already limits acceleration (twist mixer): applied as is, without the wheel slew
+  void setTarget(int8_t leftPct, int8_t rightPct, uint32_t durationMs = 0, bool shaped = false);
 
   // When socket/WS drops ⇒ cancel immediately
   void emergencyStop();
 
+  // Motion lease: the wheels may keep moving until motionUntil_, then hard-stop.
+  // Drive commands and keepAlive() extend it by HARD_STOP_TIMEOUT_MS; a server
+  // lease frame extends it by its TTL (ttlMs == 0 releases it: stop now).
+  void grantLease(uint32_t now, uint32_t ttlMs);
+
+  // ms left on a server lease while moving (0 = none held)
+  uint32_t leaseRemaining(uint32_t now) const {
+    if (!leaseHeld_ || stopped()) return 0;
+    const int32_t left = (int32_t)(motionUntil_ - now);
+    return left > 0 ? (uint32_t)left : 0;
+  }
+
+  // Server failover: a held lease runs on, but for at most ms from now
+  void capLease(uint32_t now, uint32_t ms) {
+    if ((int32_t)(motionUntil_ - (now + ms)) > 0) motionUntil_ = now + ms;
+  }
+
+  // A local, timed source (queued task, macro) owns the wheels: extend the
+  // lease so the connection-loss hard stop does not fire mid-step
+  void keepAlive(uint32_t now) { extendMotion(now, HARD_STOP_TIMEOUT_MS); }
+
+  // Checked on every loop pass, not just per tick, so expiry is enforced to the ms
+  void enforceLease(uint32_t now);
+
+  // Coroutine await conditions (CO_AWAIT_BUS_IDLE / CO_AWAIT_TARGET)
+  // Nothing left to put on the bus: the slewed speeds are sent (within the resend
+  // deadzone) and, with MAX_BUS_PARALLEL, no frame of this channel is queued or clocking
+  bool busIdle() const {
+    return abs(currentPctL_ - appliedPctL()) < WHEELS_PCT_DEADZONE &&
+           abs(currentPctR_ - appliedPctR()) < WHEELS_PCT_DEADZONE &&
+           (!MAX_BUS_PARALLEL || MaxBus::instance().idle(portL_.channel));
+  }
+  // Slew ramp finished: the speeds on the way to the bus are the requested ones
+  bool targetReached() const { return currentPctL_ == targetPctL_ && currentPctR_ == targetPctR_; }
+
+  // Motors stopped, STOP on the bus, no timed task pending and nothing non-zero
+  // requested for WHEELS_SETTLE_MS: safe to tick slowly
+  bool parked(uint32_t now) const {
+    return stopped() && deadlineAt_ == 0 && (now - lastNonZeroMs_) >= WHEELS_SETTLE_MS;
+  }
+
+  // Requested vs. on-the-bus speeds (pct), for telemetry
+  int8_t targetPctL() const { return targetPctL_; }
+  int8_t targetPctR() const { return targetPctR_; }
+  int8_t appliedPctL() const { return lastSentPctL_ == 127 ? 0 : lastSentPctL_; }
+  int8_t appliedPctR() const { return lastSentPctR_ == 127 ? 0 : lastSentPctR_; }
+
+  // Pose integrated from the speeds on the bus (not the targets)
+  const Odometry& odometry() const { return odom_; }
+  void resetPose() { odom_.reset(); }
+  void restorePose(int32_t xMm, int32_t yMm, uint16_t headingBam, uint16_t epoch) {
+    odom_.restore(xMm, yMm, headingBam, epoch);
+  }
+
+  // Running totals for bus duty-cycle accounting
+  uint32_t busFrames() const { return busFrames_; }
+  uint32_t busBusyUs() const { return busBusyUs_; }
+
 private:
   // Direct percentage-based state
   int8_t targetPctL_{0};
@@ -28,21 +94,44 @@ private:
   int8_t currentPctR_{0};     // Current speed after slew-rate limiting
   int16_t slewAccumL_{0};     // Fractional accumulator for slew-rate (scaled by 100)
   int16_t slewAccumR_{0};     // Fractional accumulator for slew-rate (scaled by 100)
+  bool shaped_{false};        // target is pre-shaped: skip slew limiting
   uint32_t lastCmdAt_{0};
+  uint32_t motionUntil_{0};   // lease expiry (wrap-safe compare)
+  bool leaseHeld_{false};     // a server lease (not just the command timeout) is active
   uint32_t deadlineAt_{0};
   uint32_t lastBusWriteMs_{0};
   uint32_t lastNonZeroMs_{0};
   uint32_t lastTickMs_{0};    // For slew-rate limiting
+  uint32_t busFrames_{0};
+  uint32_t busBusyUs_{0};
+  Odometry odom_;
+  uint32_t lastOdomMs_{0};
 
-  // MAX bus (REAL-only)
+  // MAX bus (REAL-only): MeccaChannel, or the shared MaxBus when MAX_BUS_PARALLEL
   MeccaChannel* maxBus_ = nullptr;
+  bool busReady() const {
+    return MAX_BUS_PARALLEL ? MaxBus::instance().enabled(portL_.channel) : maxBus_ != nullptr;
+  }
+  MaxPortInfo portL_{0, 0, false};
+  MaxPortInfo portR_{0, 1, false};
   
   // Bus communication error tracking
 
   // Helper functions for MAX mapping
-  static inline uint8_t dirByte(uint8_t pos, bool ccw);
   static inline uint8_t speedByteFromPct(int8_t pct);
-  void tickWheels();
+  static int16_t wheelSpeedMmS(int8_t sentPct, uint16_t scalePermille);
+  void integrateOdometry(uint32_t now);
+  void tickWheels(uint32_t now);
+  void sendStopFrame(uint32_t now);
+  void extendMotion(uint32_t now, uint32_t ttlMs) {
+    const uint32_t until = now + ttlMs;
+    if ((int32_t)(until - motionUntil_) > 0) motionUntil_ = until;
+  }
+  void writeFrame(uint8_t dirR, uint8_t dirL, uint8_t spR, uint8_t spL, uint32_t now);
+  bool stopped() const {
+    return targetPctL_ == 0 && targetPctR_ == 0 && currentPctL_ == 0 && currentPctR_ == 0 &&
+           lastSentPctL_ == 0 && lastSentPctR_ == 0;
+  }
   
   // MAX bus error handling
   bool verifyBusCommunication();
@@ -0,0 +1,116 @@
+// firmware/src/DriveArbiter.h
+#pragma once
+#include <Arduino.h>
+#include "Config.h"
+
+// Priority arbiter for the wheels setpoint. Each motion source writes its own slot;
+// once per loop() only the highest-priority active slot reaches WheelsDevice::setTarget
+// (and so the slew limiter), so a lower source updating in the background cannot
+// disturb the one in control. A slot expires on its own after ARB_TIMEOUT_MS (or its
+// task duration) and the next source down takes over where its own timeline is. When
+// the last source is released the wheels are told to stop; when it expires they are
+// left to their own deadline / lease hard stop, as without the arbiter.
+class DriveArbiter {
+public:
+  enum Source : uint8_t { LIVE, GROUP, BEHAVIOR, MACRO, QUEUE, SOURCE_COUNT };  // highest priority first
+  static constexpr uint8_t NONE = SOURCE_COUNT;
+  static_assert(sizeof(ARB_TIMEOUT_MS) / sizeof(ARB_TIMEOUT_MS[0]) == SOURCE_COUNT, "one ARB_TIMEOUT_MS per source");
+
+  struct Setpoint {
+    int8_t left;
+    int8_t right;
+    uint32_t durationMs;  // 0 = open-ended
+    bool shaped;          // already acceleration-limited upstream (twist): no wheel slew
+  };
+
+  void submit(Source s, int8_t left, int8_t right, uint32_t durationMs, uint32_t now, bool shaped = false) {
+    Slot& slot = slots_[s];
+    const uint32_t holdMs = durationMs ? durationMs : ARB_TIMEOUT_MS[s];
+    slot.sp = {left, right, durationMs, shaped};
+    slot.active = true;
+    slot.expires = holdMs != 0;
+    slot.untilMs = now + holdMs;
+    if (s <= owner_) dirty_ = true;  // takes over, or updates the current owner
+  }
+
+  // New output of a running source (e.g. a twist ramp step): keeps its timeout, so a
+  // source that is only being played out still expires when its commands stop
+  void update(Source s, int8_t left, int8_t right) {
+    Slot& slot = slots_[s];
+    if (!slot.active) return;
+    slot.sp.left = left;
+    slot.sp.right = right;
+    if (s <= owner_) dirty_ = true;
+  }
+
+  // Renewal without a new setpoint (lease frame): open-ended slots only
+  void extend(Source s, uint32_t now, uint32_t ms) {
+    Slot& slot = slots_[s];
+    if (!slot.active || !slot.expires || slot.sp.durationMs) return;
+    if ((int32_t)(now + ms - slot.untilMs) > 0) slot.untilMs = now + ms;
+  }
+
+  void release(Source s) {
+    if (!slots_[s].active) return;
+    slots_[s].active = false;
+    if (s == owner_) dirty_ = true;
+  }
+
+  // Stop fast path / disconnect: the caller stops the wheels itself
+  void clear() {
+    for (auto& slot : slots_) slot.active = false;
+    owner_ = NONE;
+    dirty_ = false;
+  }
+
+  bool active(Source s) const { return slots_[s].active; }
+  uint8_t owner() const { return owner_; }
+  bool owns(Source s) const { return owner_ == s; }
+
+  // Once per loop() after all sources ran: true when the wheels target has to change
+  bool poll(uint32_t now, Setpoint& out) {
+    uint8_t next = NONE;
+    bool ownerExpired = false;
+    for (uint8_t s = 0; s < SOURCE_COUNT; ++s) {
+      Slot& slot = slots_[s];
+      // Same wrap-safe "past the end" test as the wheels lease
+      if (slot.active && slot.expires && (int32_t)(now - slot.untilMs) > 0) {
+        slot.active = false;
+        ownerExpired |= s == owner_;
+      }
+      if (slot.active && next == NONE) next = s;
+    }
+    if (next != owner_) {
+      Serial.printf("[ARB] t=%lu %s -> %s\n", (unsigned long)now, name(owner_), name(next));
+      owner_ = next;
+      dirty_ = true;
+    }
+    if (!dirty_) return false;
+    dirty_ = false;
+    if (owner_ == NONE) {
+      out = {0, 0, 0, false};
+      return !ownerExpired;
+    }
+    const Slot& slot = slots_[owner_];
+    out = slot.sp;
+    // A timed setpoint handed back after a higher source let go keeps its own end time
+    if (slot.sp.durationMs) out.durationMs = max<uint32_t>(1, slot.untilMs - now);
+    return true;
+  }
+
+  static const char* name(uint8_t s) {
+    static const char* const kNames[] = {"live", "group", "behavior", "macro", "queue", "none"};
+    return kNames[s < SOURCE_COUNT ? s : NONE];
+  }
+
+private:
+  struct Slot {
+    Setpoint sp;
+    uint32_t untilMs;
+    bool active;
+    bool expires;
+  };
+  Slot slots_[SOURCE_COUNT] = {};
+  uint8_t owner_ = NONE;
+  bool dirty_ = false;
+};
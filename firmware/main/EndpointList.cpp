@@ -0,0 +1,237 @@
+// firmware/src/EndpointList.cpp
+#include "EndpointList.h"
+#include <LittleFS.h>
+#include <ESP8266WiFi.h>
+#include <lwip/tcp.h>
+#include <type_traits>
+
+#include "MacroStore.h"
+
+static_assert(std::is_same<err_t, int8_t>::value, "EndpointList callbacks are declared with int8_t err_t");
+
+static constexpr const char* kEndpointsPath = "/net/endpoints.bin";
+
+void EndpointList::begin() {
+  count_ = 0;
+  Endpoint ep;
+  if (parse(WS_HOST, strlen(WS_HOST), ep)) {
+    ep.port = WS_PORT;
+    eps_[count_++] = ep;
+  }
+  const char* p = WS_FALLBACK_ENDPOINTS;
+  while (*p && count_ < EP_MAX) {
+    const char* end = strchr(p, ',');
+    const size_t len = end ? (size_t)(end - p) : strlen(p);
+    if (parse(p, len, ep)) eps_[count_++] = ep;
+    p += len + (end ? 1 : 0);
+  }
+
+  if (load()) Serial.println("[EP] using the stored server list");
+  active_ = 0;
+  resetHealth();
+  for (uint8_t i = 0; i < count_; ++i) {
+    char text[EP_HOST_LEN + 6];
+    format(i, text, sizeof(text));
+    Serial.printf("[EP] %u: %s\n", i, text);
+  }
+}
+
+bool EndpointList::set(const char* const* entries, uint8_t count) {
+  if (count == 0 || count > EP_MAX) return false;
+  Endpoint next[EP_MAX];
+  for (uint8_t i = 0; i < count; ++i) {
+    if (!entries[i] || !parse(entries[i], strlen(entries[i]), next[i])) return false;
+  }
+
+  // The session in progress stays where it is; it only gets an index in the new list
+  const Endpoint cur = current();
+  abortProbes();
+  memcpy(eps_, next, count * sizeof(Endpoint));
+  count_ = count;
+  active_ = 0;
+  for (uint8_t i = 0; i < count_; ++i) {
+    if (eps_[i].port == cur.port && strcmp(eps_[i].host, cur.host) == 0) active_ = i;
+  }
+  resetHealth();
+  const bool stored = save();
+  Serial.printf("[EP] new server list (%u), %s\n", count_, stored ? "stored" : "not stored");
+  return true;
+}
+
+int8_t EndpointList::failover() const {
+  for (uint8_t i = 0; i < count_; ++i) {
+    if (i != active_ && health_[i].up) return (int8_t)i;
+  }
+  return -1;
+}
+
+void EndpointList::probe(uint32_t now) {
+  for (uint8_t i = 0; i < count_; ++i) {
+    settle(i);
+    startProbe(i, now);
+  }
+}
+
+// Fold the last round of endpoint i into its health
+void EndpointList::settle(uint8_t i) {
+  Probe& pr = probes_[i];
+  if (pr.pcb) {
+    // No SYN-ACK within a round
+    tcp_arg(pr.pcb, nullptr);
+    tcp_err(pr.pcb, nullptr);
+    tcp_abort(pr.pcb);
+    pr.pcb = nullptr;
+    pr.state = PROBE_FAILED;
+  }
+  Health& h = health_[i];
+  if (pr.state == PROBE_OK) {
+    if (!h.up) Serial.printf("[EP] %s:%u up (%ums)\n", eps_[i].host, eps_[i].port, pr.rttMs);
+    h.up = true;
+    h.misses = 0;
+    h.rttMs = pr.rttMs;
+  } else if (pr.state == PROBE_FAILED) {
+    if (h.misses < 0xFF) h.misses++;
+    if (h.up && h.misses >= EP_PROBE_FAILS) {
+      Serial.printf("[EP] %s:%u down\n", eps_[i].host, eps_[i].port);
+      h.up = false;
+    }
+  }
+  pr.state = PROBE_IDLE;
+}
+
+void EndpointList::startProbe(uint8_t i, uint32_t now) {
+  IPAddress ip;
+  if (!ip.fromString(eps_[i].host)) return;  // host name: not probed
+  tcp_pcb* pcb = tcp_new();
+  if (!pcb) return;  // out of pcbs: skip this round, no verdict
+
+  Probe& pr = probes_[i];
+  pr.startMs = now;
+  pr.state = PROBE_PENDING;
+  pr.pcb = pcb;
+  ip_addr_t addr;
+  IP_ADDR4(&addr, ip[0], ip[1], ip[2], ip[3]);
+  tcp_arg(pcb, &pr);
+  tcp_err(pcb, &EndpointList::onError);
+  if (tcp_connect(pcb, &addr, eps_[i].port, &EndpointList::onConnected) != ERR_OK) {
+    tcp_arg(pcb, nullptr);
+    tcp_err(pcb, nullptr);
+    tcp_abort(pcb);
+    pr.pcb = nullptr;
+    pr.state = PROBE_FAILED;
+  }
+}
+
+// SYN-ACK: the server is listening. Reset the connection right away (no TIME_WAIT pcb).
+int8_t EndpointList::onConnected(void* arg, tcp_pcb* pcb, int8_t /*err*/) {
+  Probe* pr = static_cast<Probe*>(arg);
+  if (pr) {
+    pr->rttMs = (uint16_t)min<uint32_t>(millis() - pr->startMs, 0xFFFF);
+    pr->pcb = nullptr;
+    pr->state = PROBE_OK;
+  }
+  tcp_arg(pcb, nullptr);
+  tcp_err(pcb, nullptr);
+  tcp_abort(pcb);
+  return ERR_ABRT;
+}
+
+// Refused / unreachable; lwIP has freed the pcb already
+void EndpointList::onError(void* arg, int8_t /*err*/) {
+  Probe* pr = static_cast<Probe*>(arg);
+  if (!pr) return;
+  pr->pcb = nullptr;
+  pr->state = PROBE_FAILED;
+}
+
+void EndpointList::abortProbes() {
+  for (uint8_t i = 0; i < EP_MAX; ++i) {
+    Probe& pr = probes_[i];
+    if (pr.pcb) {
+      tcp_arg(pr.pcb, nullptr);
+      tcp_err(pr.pcb, nullptr);
+      tcp_abort(pr.pcb);
+    }
+    pr = Probe{};
+  }
+}
+
+void EndpointList::resetHealth() {
+  for (Health& h : health_) h = Health{true, 0, 0};
+}
+
+uint32_t EndpointList::hash() const {
+  char text[EP_MAX * (EP_HOST_LEN + 6)];
+  size_t len = 0;
+  for (uint8_t i = 0; i < count_; ++i) {
+    if (i) text[len++] = ',';
+    format(i, text + len, sizeof(text) - len);
+    len += strlen(text + len);
+  }
+  return MacroStore::fnv1a(reinterpret_cast<const uint8_t*>(text), len);
+}
+
+void EndpointList::format(uint8_t i, char* out, size_t len) const {
+  snprintf(out, len, "%s:%u", eps_[i].host, eps_[i].port);
+}
+
+// "host[:port]" (port defaults to WS_PORT)
+bool EndpointList::parse(const char* text, size_t len, Endpoint& out) {
+  const char* colon = static_cast<const char*>(memchr(text, ':', len));
+  const size_t hostLen = colon ? (size_t)(colon - text) : len;
+  if (hostLen == 0 || hostLen >= EP_HOST_LEN) return false;
+  uint32_t port = WS_PORT;
+  if (colon) {
+    port = 0;
+    for (const char* c = colon + 1; c < text + len; ++c) {
+      if (*c < '0' || *c > '9' || port > 0xFFFF) return false;
+      port = port * 10 + (*c - '0');
+    }
+    if (port == 0 || port > 0xFFFF) return false;
+  }
+  memcpy(out.host, text, hostLen);
+  out.host[hostLen] = '\0';
+  out.port = (uint16_t)port;
+  return true;
+}
+
+bool EndpointList::load() {
+  if (!LittleFS.exists(kEndpointsPath)) return false;
+  File f = LittleFS.open(kEndpointsPath, "r");
+  if (!f) return false;
+  Header h;
+  Endpoint stored[EP_MAX];
+  bool ok = f.read(reinterpret_cast<uint8_t*>(&h), sizeof(h)) == sizeof(h) && h.magic == MAGIC &&
+            h.count > 0 && h.count <= EP_MAX;
+  if (ok) {
+    const size_t len = h.count * sizeof(Endpoint);
+    ok = f.read(reinterpret_cast<uint8_t*>(stored), len) == len;
+  }
+  f.close();
+  if (!ok) return false;
+  for (uint8_t i = 0; i < h.count; ++i) {
+    if (stored[i].host[0] == '\0' || memchr(stored[i].host, '\0', EP_HOST_LEN) == nullptr) return false;
+  }
+
+  Endpoint defaults[EP_MAX];
+  const uint8_t defaultCount = count_;
+  memcpy(defaults, eps_, sizeof(eps_));
+  memcpy(eps_, stored, h.count * sizeof(Endpoint));
+  count_ = h.count;
+  if (hash() == h.hash) return true;
+  memcpy(eps_, defaults, sizeof(eps_));
+  count_ = defaultCount;
+  return false;
+}
+
+bool EndpointList::save() const {
+  File f = LittleFS.open(kEndpointsPath, "w");
+  if (!f) return false;
+  const Header h{MAGIC, hash(), count_, {0, 0, 0}};
+  const size_t len = count_ * sizeof(Endpoint);
+  const bool ok = f.write(reinterpret_cast<const uint8_t*>(&h), sizeof(h)) == sizeof(h) &&
+                  f.write(reinterpret_cast<const uint8_t*>(eps_), len) == len;
+  f.close();
+  if (!ok) LittleFS.remove(kEndpointsPath);
+  return ok;
+}
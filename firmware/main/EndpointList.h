@@ -0,0 +1,87 @@
+// firmware/src/EndpointList.h
+#pragma once
+#include <Arduino.h>
+#include "Config.h"
+
+struct tcp_pcb;
+
+// Prioritised WebSocket servers (index 0 = preferred). The list starts from Config.h;
+// a list pushed by the server (`endpoints`) replaces it and is stored in LittleFS
+// (/net/endpoints.bin, mounted by MacroStore), so it survives a reboot.
+//
+// Health: once per EP_PROBE_MS every IPv4 endpoint gets a TCP connect probe, all in
+// flight together (lwIP raw API: no blocking connect, no WiFiClient per probe). A
+// SYN-ACK marks it up and the connection is reset at once; a refusal, or no answer
+// by the next round, counts as a miss. Host names are not probed and count as up.
+class EndpointList {
+public:
+  struct Endpoint {
+    char host[EP_HOST_LEN];
+    uint16_t port;
+  };
+
+  struct Health {
+    bool up;          // no verdict yet = up
+    uint8_t misses;   // failed probe rounds in a row
+    uint16_t rttMs;   // connect time of the last good probe
+  };
+
+  void begin();  // Config.h defaults, then the stored list if any
+
+  // Replace the list ("host[:port]" entries, highest priority first) and persist it.
+  // All or nothing: false on an empty list or a bad entry.
+  bool set(const char* const* entries, uint8_t count);
+
+  uint8_t count() const { return count_; }
+  const Endpoint& at(uint8_t i) const { return eps_[i]; }
+  const Health& health(uint8_t i) const { return health_[i]; }
+  uint8_t active() const { return active_; }
+  const Endpoint& current() const { return eps_[active_]; }
+  void select(uint8_t i) { if (i < count_) active_ = i; }
+
+  // Highest-priority endpoint that is up, other than the active one (-1 = none)
+  int8_t failover() const;
+
+  // One probe round: settle the previous one, then probe every endpoint again
+  void probe(uint32_t now);
+
+  // FNV-1a of "host:port,host:port,..." (the server compares it with its own list)
+  uint32_t hash() const;
+
+  // "host:port" of endpoint i
+  void format(uint8_t i, char* out, size_t len) const;
+
+private:
+  struct Header {
+    uint32_t magic;
+    uint32_t hash;
+    uint8_t count;
+    uint8_t reserved[3];
+  };
+  static constexpr uint32_t MAGIC = 0x314C5045;  // "EPL1"
+
+  enum : uint8_t { PROBE_IDLE, PROBE_PENDING, PROBE_OK, PROBE_FAILED };
+  struct Probe {
+    tcp_pcb* pcb;             // connect in flight (nullptr once lwIP settled it)
+    uint32_t startMs;
+    uint16_t rttMs;
+    volatile uint8_t state;   // written from the lwIP callbacks
+  };
+
+  static bool parse(const char* text, size_t len, Endpoint& out);
+  void resetHealth();
+  void abortProbes();
+  void startProbe(uint8_t i, uint32_t now);
+  void settle(uint8_t i);
+  bool load();
+  bool save() const;
+
+  static int8_t onConnected(void* arg, tcp_pcb* pcb, int8_t err);
+  static void onError(void* arg, int8_t err);
+
+  Endpoint eps_[EP_MAX] = {};
+  Health health_[EP_MAX] = {};
+  Probe probes_[EP_MAX] = {};
+  uint8_t count_ = 0;
+  uint8_t active_ = 0;
+};
@@ -0,0 +1,91 @@
+// firmware/src/FrameScanner.cpp
+#include "FrameScanner.h"
+#include "Protocol.h"
+#include <string.h>
+
+namespace {
+
+// Position just past `"key"` followed by optional whitespace and ':' (or -1)
+int findKey(const uint8_t* p, size_t len, const char* key, size_t from = 0) {
+  const size_t klen = strlen(key);
+  for (size_t i = from; i + klen + 2 <= len; ++i) {
+    if (p[i] != '"' || p[i + klen + 1] != '"' || memcmp(p + i + 1, key, klen) != 0) continue;
+    size_t j = i + klen + 2;
+    while (j < len && (p[j] == ' ' || p[j] == '\t')) ++j;
+    if (j >= len || p[j] != ':') continue;
+    ++j;
+    while (j < len && (p[j] == ' ' || p[j] == '\t')) ++j;
+    return (int)j;
+  }
+  return -1;
+}
+
+bool stringIs(const uint8_t* p, size_t len, int at, const char* value) {
+  if (at < 0) return false;
+  const size_t vlen = strlen(value);
+  return (size_t)at + vlen + 2 <= len && p[at] == '"' &&
+         memcmp(p + at + 1, value, vlen) == 0 && p[at + vlen + 1] == '"';
+}
+
+// Integer literal equal to zero ("0", "-0", "0.0"); anything else is false
+bool numberIsZero(const uint8_t* p, size_t len, int at) {
+  if (at < 0) return false;
+  size_t j = at;
+  if (j < len && p[j] == '-') ++j;
+  if (j >= len || p[j] != '0') return false;
+  ++j;
+  if (j < len && p[j] == '.') {
+    ++j;
+    while (j < len && p[j] == '0') ++j;
+  }
+  return j >= len || p[j] == ',' || p[j] == '}' || p[j] == ']' || p[j] == ' ' || p[j] == '\n' || p[j] == '\r';
+}
+
+size_t countKey(const uint8_t* p, size_t len, const char* key) {
+  size_t n = 0;
+  for (int at = findKey(p, len, key); at >= 0; at = findKey(p, len, key, at)) ++n;
+  return n;
+}
+
+bool leftRightZero(const uint8_t* p, size_t len) {
+  return numberIsZero(p, len, findKey(p, len, "left")) && numberIsZero(p, len, findKey(p, len, "right"));
+}
+
+}  // namespace
+
+namespace FrameScanner {
+
+Stop scanStopText(const uint8_t* p, size_t len) {
+  const int kind = findKey(p, len, "kind");
+  if (kind < 0) return Stop::NONE;
+
+  if (stringIs(p, len, kind, Protocol::CMD_TASK_CANCEL)) {
+    return stringIs(p, len, findKey(p, len, "device"), Protocol::DEVICE_WHEELS) ? Stop::CANCEL : Stop::NONE;
+  }
+  if (stringIs(p, len, kind, Protocol::CMD_DRIVE)) {
+    return leftRightZero(p, len) ? Stop::DRIVE_ZERO : Stop::NONE;
+  }
+  if (stringIs(p, len, kind, Protocol::CMD_LEASE)) {
+    return numberIsZero(p, len, findKey(p, len, "ttl")) ? Stop::LEASE_REVOKE : Stop::NONE;
+  }
+  // Live-drive stop from the server: a replace carrying exactly one (wheels) task at 0/0
+  if (stringIs(p, len, kind, Protocol::CMD_TASK_REPLACE)) {
+    if (countKey(p, len, "device") != 1) return Stop::NONE;
+    if (!stringIs(p, len, findKey(p, len, "device"), Protocol::DEVICE_WHEELS)) return Stop::NONE;
+    return leftRightZero(p, len) ? Stop::REPLACE_ZERO : Stop::NONE;
+  }
+  return Stop::NONE;
+}
+
+Stop scanStopBinary(const uint8_t* p, size_t len) {
+  return (len >= 1 && p[0] == Protocol::BIN_STOP) ? Stop::BINARY : Stop::NONE;
+}
+
+bool isLastWinsDrive(const uint8_t* p, size_t len) {
+  const int kind = findKey(p, len, "kind");
+  if (stringIs(p, len, kind, Protocol::CMD_DRIVE) || stringIs(p, len, kind, Protocol::CMD_TWIST)) return true;
+  return stringIs(p, len, kind, Protocol::CMD_TASK_REPLACE) && countKey(p, len, "device") == 1 &&
+         stringIs(p, len, findKey(p, len, "device"), Protocol::DEVICE_WHEELS);
+}
+
+}  // namespace FrameScanner
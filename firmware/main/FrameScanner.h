@@ -0,0 +1,33 @@
+// firmware/src/FrameScanner.h
+#pragma once
+#include <Arduino.h>
+
+// Pre-parse byte scanners on the raw WebSocket payload, run before any
+// deserializeJson()/String copy. Conservative: anything they are not sure
+// about is reported as "no match" and takes the regular path.
+namespace FrameScanner {
+
+// ---- Stop fast path ----
+// A stop reaches the wheels without waiting for the full parse. The regular
+// handler still processes the frame afterwards (acks, flow seq, queue bookkeeping).
+
+enum class Stop : uint8_t {
+  NONE = 0,
+  CANCEL,        // {"kind":"task.cancel","device":"wheels"}
+  DRIVE_ZERO,    // {"kind":"drive","left":0,"right":0}
+  REPLACE_ZERO,  // {"kind":"task.replace","tasks":[{"device":"wheels",...,"left":0,"right":0}]}
+  LEASE_REVOKE,  // {"kind":"lease","ttl":0}
+  BINARY,        // binary frame starting with Protocol::BIN_STOP
+  DATAGRAM,      // UDP drive datagram with Protocol::UDP_FLAG_STOP (NetClient::pollUdp)
+};
+
+Stop scanStopText(const uint8_t* payload, size_t length);
+Stop scanStopBinary(const uint8_t* payload, size_t length);
+
+// ---- Superseded-frame elision ----
+// Last-wins wheels command: `drive`/`twist`, or a `task.replace` carrying exactly one
+// (wheels) task. A newer one makes an older one a no-op, so when a burst is
+// drained only the newest needs a full parse.
+bool isLastWinsDrive(const uint8_t* payload, size_t length);
+
+}  // namespace FrameScanner
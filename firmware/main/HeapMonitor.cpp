@@ -0,0 +1,45 @@
+// firmware/src/HeapMonitor.cpp
+#include "HeapMonitor.h"
+#include "Config.h"
+
+void HeapMonitor::begin() {
+  sample();
+  lastReportMs_ = millis();
+  reportPending_ = false;
+}
+
+// Alerts are probed at a faster cadence than the periodic report so a
+// sudden drop is reported without waiting for the next interval
+bool HeapMonitor::poll(uint32_t now) {
+  const uint8_t prevAlerts = alerts_;
+  const bool periodic = (now - lastReportMs_) >= HEAP_STATS_INTERVAL_MS;
+  sample();
+
+  if (alerts_ & ~prevAlerts) {
+    Serial.printf("[HEAP] ALERT 0x%02X free=%u blk=%u frag=%u%%\n",
+                  alerts_, (unsigned)freeHeap_, (unsigned)maxBlock_, fragPct_);
+  }
+
+  if (!periodic && !reportPending_ && alerts_ == prevAlerts) {
+    return false;
+  }
+  lastReportMs_ = now;
+  reportPending_ = false;
+  return true;
+}
+
+void HeapMonitor::sample() {
+  freeHeap_ = ESP.getFreeHeap();
+  maxBlock_ = ESP.getMaxFreeBlockSize();
+  fragPct_ = ESP.getHeapFragmentation();
+
+  if (freeHeap_ < minFreeHeap_) minFreeHeap_ = freeHeap_;
+  if (maxBlock_ < minMaxBlock_) minMaxBlock_ = maxBlock_;
+  if (fragPct_ > maxFragPct_) maxFragPct_ = fragPct_;
+
+  uint8_t a = 0;
+  if (freeHeap_ < HEAP_ALERT_FREE_BYTES) a |= ALERT_LOW_HEAP;
+  if (fragPct_ >= HEAP_ALERT_FRAG_PCT) a |= ALERT_FRAGMENTED;
+  if (maxBlock_ < HEAP_ALERT_MAX_BLOCK_BYTES) a |= ALERT_SMALL_BLOCK;
+  alerts_ = a;
+}
@@ -0,0 +1,54 @@
+// firmware/src/HeapMonitor.h
+#pragma once
+#include <Arduino.h>
+
+// Periodic heap/fragmentation sampling + counters for the fallback paths in
+// NetClient. Reported upstream as a compact "stats" envelope.
+class HeapMonitor {
+public:
+  // Fallback paths we want to keep an eye on (free-running, wrap at 2^32)
+  enum class Fallback : uint8_t {
+    TX_DROPPED = 0,  // sendEnvelope(): envelope did not fit the tx buffer, dropped
+    RX_STRING,       // handleText() copied an inbound frame into a String
+    COUNT
+  };
+
+  // Alert bits (set while the condition holds)
+  static constexpr uint8_t ALERT_LOW_HEAP = 0x01;
+  static constexpr uint8_t ALERT_FRAGMENTED = 0x02;
+  static constexpr uint8_t ALERT_SMALL_BLOCK = 0x04;
+
+  void begin();
+
+  // Sample; called every HEAP_ALERT_CHECK_MS (NetClient's "heap" job). Returns true when
+  // a report is due (HEAP_STATS_INTERVAL_MS elapsed, an alert bit changed, or a deferred retry).
+  bool poll(uint32_t now);
+
+  // Reporting was rate-limited; try again on the next poll()
+  void deferReport() { reportPending_ = true; }
+
+  void noteFallback(Fallback site) { fallbackCounts_[static_cast<uint8_t>(site)]++; }
+
+  uint32_t freeHeap() const { return freeHeap_; }
+  uint32_t minFreeHeap() const { return minFreeHeap_; }
+  uint32_t maxBlock() const { return maxBlock_; }
+  uint32_t minMaxBlock() const { return minMaxBlock_; }
+  uint8_t fragmentation() const { return fragPct_; }
+  uint8_t maxFragmentation() const { return maxFragPct_; }
+  uint8_t alerts() const { return alerts_; }
+  uint32_t fallbackCount(Fallback site) const { return fallbackCounts_[static_cast<uint8_t>(site)]; }
+
+private:
+  uint32_t lastReportMs_ = 0;
+  uint32_t freeHeap_ = 0;
+  uint32_t minFreeHeap_ = UINT32_MAX;
+  uint32_t maxBlock_ = 0;
+  uint32_t minMaxBlock_ = UINT32_MAX;
+  uint8_t fragPct_ = 0;
+  uint8_t maxFragPct_ = 0;
+  uint8_t alerts_ = 0;
+  bool reportPending_ = false;
+  uint32_t fallbackCounts_[static_cast<uint8_t>(Fallback::COUNT)] = {0};
+
+  void sample();
+};
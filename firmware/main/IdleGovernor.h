@@ -0,0 +1,83 @@
+// firmware/src/IdleGovernor.h
+#pragma once
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include "Config.h"
+
+// Power-aware idle. Once the devices have been parked for POWER_IDLE_ENTER_MS the
+// radio may light-sleep between DTIM beacons (the AP buffers frames for us and the
+// beacon wakes us for them) and loop() sleeps until the next device tick instead of
+// spinning. The first pass that sees work restores full-power Wi-Fi; the tick
+// governor switches to the fast period on its own, so a command received during a
+// sleep slice is applied no later than the tick the slice was sized to.
+class IdleGovernor {
+public:
+  void begin(uint32_t now) {
+    parkedSinceMs_ = now;
+    windowStartMs_ = now;
+  }
+
+  // Once per loop(): how long loop() may sleep (0 = keep spinning)
+  uint32_t poll(uint32_t now, bool parked, uint32_t nextTickMs) {
+    if (!parked) {
+      parkedSinceMs_ = now;
+      if (idle_) setIdle(false);
+      return 0;
+    }
+    if (!idle_) {
+      if (!POWER_IDLE || now - parkedSinceMs_ < POWER_IDLE_ENTER_MS) return 0;
+      setIdle(true);
+    }
+    const int32_t slack = (int32_t)(nextTickMs - now);
+    return slack > 0 ? min<uint32_t>((uint32_t)slack, POWER_IDLE_MAX_SLEEP_MS) : 0;
+  }
+
+  // Actual length of a sleep slice: overrun = wake cost beyond the requested slice
+  void onSlept(uint32_t requestedMs, uint32_t actualUs) {
+    sleptUs_ += actualUs;
+    if (actualUs > maxSleepUs_) maxSleepUs_ = actualUs;
+    const uint32_t overrunUs = actualUs > requestedMs * 1000 ? actualUs - requestedMs * 1000 : 0;
+    if (overrunUs > maxOverrunUs_) maxOverrunUs_ = overrunUs;
+  }
+
+  bool idle() const { return idle_; }
+
+  // Since the previous report: share of time asleep, idle entries (running total),
+  // longest slice (= worst wait of a command received while asleep) and overrun
+  struct Report {
+    uint16_t sleepPermille;
+    uint32_t entries;
+    uint32_t maxSleepUs;
+    uint32_t maxOverrunUs;
+  };
+  Report takeReport(uint32_t now) {
+    const uint32_t elapsedMs = now - windowStartMs_;
+    const Report r{elapsedMs ? (uint16_t)min<uint32_t>(1000, sleptUs_ / elapsedMs) : (uint16_t)0,
+                   entries_, maxSleepUs_, maxOverrunUs_};
+    windowStartMs_ = now;
+    sleptUs_ = 0;
+    maxSleepUs_ = 0;
+    maxOverrunUs_ = 0;
+    return r;
+  }
+
+private:
+  void setIdle(bool idle) {
+    idle_ = idle;
+    if (idle) entries_++;
+    // Light sleep needs the station's listen interval; 0 = wake on every DTIM beacon
+    if (idle) WiFi.setSleepMode(WIFI_LIGHT_SLEEP, POWER_LISTEN_INTERVAL);
+    else WiFi.setSleepMode(WIFI_NONE_SLEEP);
+#if DEBUG_LOGS
+    Serial.printf("[POWER] %s\n", idle ? "idle (light sleep)" : "active");
+#endif
+  }
+
+  uint32_t parkedSinceMs_ = 0;
+  uint32_t windowStartMs_ = 0;
+  uint32_t sleptUs_ = 0;
+  uint32_t maxSleepUs_ = 0;
+  uint32_t maxOverrunUs_ = 0;
+  uint32_t entries_ = 0;
+  bool idle_ = false;
+};
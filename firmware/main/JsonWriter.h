@@ -0,0 +1,135 @@
+// firmware/src/JsonWriter.h
+#pragma once
+#include <Arduino.h>
+#include <type_traits>
+
+// DOM-free JSON writer for outbound envelopes: appends straight into the shared
+// transmit buffer, no intermediate document. Output is what serializeJson() gave
+// for the same insertion order (no whitespace, integers only, ArduinoJson's
+// escapes: \" \\ \b \f \n \r \t), so the wire format is unchanged.
+// On overflow the writer stops and ok() is false; the partial text must not be sent.
+class JsonWriter {
+public:
+  JsonWriter(char* buf, size_t cap) : buf_(buf), cap_(cap) {}
+
+  JsonWriter& beginObject() { return open('{'); }
+  JsonWriter& endObject() { return close('}'); }
+  JsonWriter& beginArray(const char* key) {
+    name(key);
+    return open('[');
+  }
+  JsonWriter& endArray() { return close(']'); }
+
+  // Object members
+  JsonWriter& add(const char* key, const char* value) {
+    name(key);
+    string(value);
+    return *this;
+  }
+  template <typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+  JsonWriter& add(const char* key, T value) {
+    name(key);
+    number(value);
+    return *this;
+  }
+
+  // Array elements
+  template <typename T>
+  JsonWriter& item(T value) {
+    separator();
+    number(value);
+    return *this;
+  }
+
+  bool ok() const { return !overflow_; }
+  const char* data() const { return buf_; }
+  size_t length() const { return overflow_ ? 0 : len_; }
+
+private:
+  char* buf_;
+  size_t cap_;
+  size_t len_ = 0;
+  bool first_ = true;  // no member/element yet in the open object/array
+  bool overflow_ = false;
+
+  void put(char c) {
+    if (len_ + 1 >= cap_) {  // keep room for the terminator
+      overflow_ = true;
+      return;
+    }
+    buf_[len_++] = c;
+    buf_[len_] = '\0';
+  }
+
+  void separator() {
+    if (!first_) put(',');
+    first_ = false;
+  }
+
+  JsonWriter& open(char c) {
+    put(c);
+    first_ = true;
+    return *this;
+  }
+
+  JsonWriter& close(char c) {
+    put(c);
+    first_ = false;
+    return *this;
+  }
+
+  void name(const char* key) {
+    separator();
+    string(key);
+    put(':');
+  }
+
+  void string(const char* s) {
+    if (!s) {
+      put('n'); put('u'); put('l'); put('l');
+      return;
+    }
+    put('"');
+    for (; *s; ++s) {
+      const char c = *s;
+      char esc = 0;
+      switch (c) {
+        case '"': esc = '"'; break;
+        case '\\': esc = '\\'; break;
+        case '\b': esc = 'b'; break;
+        case '\f': esc = 'f'; break;
+        case '\n': esc = 'n'; break;
+        case '\r': esc = 'r'; break;
+        case '\t': esc = 't'; break;
+      }
+      if (esc) {
+        put('\\');
+        put(esc);
+      } else {
+        put(c);
+      }
+    }
+    put('"');
+  }
+
+  template <typename T>
+  void number(T value) {
+    static_assert(std::is_integral<T>::value && !std::is_same<T, bool>::value, "JsonWriter writes integers only");
+    if (std::is_signed<T>::value && (int32_t)value < 0) {
+      put('-');
+      digits(0u - (uint32_t)(int32_t)value);
+    } else {
+      digits((uint32_t)value);
+    }
+  }
+
+  void digits(uint32_t v) {
+    char tmp[10];
+    uint8_t n = 0;
+    do {
+      tmp[n++] = (char)('0' + v % 10);
+      v /= 10;
+    } while (v);
+    while (n) put(tmp[--n]);
+  }
+};
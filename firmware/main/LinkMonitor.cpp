@@ -0,0 +1,96 @@
+// firmware/src/LinkMonitor.cpp
+#include "LinkMonitor.h"
+#include <ESP8266WiFi.h>
+
+void LinkMonitor::reset(uint32_t now) {
+  rssiValid_ = false;
+  srttMs_ = 0;
+  lastProbeMs_ = now;
+  samplesSinceProbe_ = 0;
+  probeOut_ = false;
+  lostRun_ = 0;
+  txFailRecent_ = false;
+  grade_ = GOOD;
+  betterSinceMs_ = 0;
+  lastReportMs_ = now;
+  reportPending_ = true;
+}
+
+void LinkMonitor::poll(uint32_t now) {
+  if (probeOut_ && now - lastProbeMs_ >= LINK_PROBE_TIMEOUT_MS) {
+    probeOut_ = false;
+    if (lost_ < 0xFFFF) lost_++;
+    if (lostRun_ < 0xFF) lostRun_++;
+  }
+  if (samplesSinceProbe_ < 0xFF) samplesSinceProbe_++;
+
+  const int32_t dbm = WiFi.RSSI();
+  if (dbm < 0) {  // 31 = not associated
+    const int16_t x16 = (int16_t)(dbm * 16);
+    rssiX16_ = rssiValid_ ? (int16_t)(rssiX16_ + (x16 - rssiX16_) / 4) : x16;
+    rssiValid_ = true;
+  }
+
+  const Grade measured = measure();
+  txFailRecent_ = false;
+  if (measured > grade_) {
+    setGrade(measured);  // worse: at once
+    betterSinceMs_ = 0;
+  } else if (measured < grade_) {
+    if (!betterSinceMs_) betterSinceMs_ = now;
+    if (now - betterSinceMs_ >= LINK_UPGRADE_HOLD_MS) {
+      setGrade((Grade)(grade_ - 1));  // one step per hold
+      betterSinceMs_ = 0;
+    }
+  } else {
+    betterSinceMs_ = 0;
+  }
+}
+
+uint16_t LinkMonitor::startProbe(uint32_t now) {
+  lastProbeMs_ = now;
+  samplesSinceProbe_ = 0;
+  probeOut_ = true;
+  return ++probeId_;
+}
+
+void LinkMonitor::onProbeEcho(uint16_t id, uint32_t now) {
+  if (!probeOut_ || id != probeId_) return;  // late echo of a probe already counted lost
+  probeOut_ = false;
+  lostRun_ = 0;
+  const uint32_t rtt = min<uint32_t>(now - lastProbeMs_, 0xFFFF);
+  srttMs_ = srttMs_ ? (uint16_t)(srttMs_ + ((int32_t)rtt - srttMs_) / 8) : (uint16_t)rtt;
+}
+
+bool LinkMonitor::reportDue(uint32_t now) {
+  if (!reportPending_ && now - lastReportMs_ < LINK_REPORT_MS) return false;
+  reportPending_ = false;
+  lastReportMs_ = now;
+  return true;
+}
+
+LinkMonitor::Grade LinkMonitor::measure() const {
+  Grade g = GOOD;
+  auto worse = [&g](Grade c) {
+    if (c > g) g = c;
+  };
+  if (rssiValid_) {
+    const int8_t dbm = rssi();
+    if (dbm < LINK_RSSI_POOR_DBM) worse(POOR);
+    else if (dbm < LINK_RSSI_FAIR_DBM) worse(FAIR);
+  }
+  if (srttMs_ > LINK_RTT_POOR_MS) worse(POOR);
+  else if (srttMs_ > LINK_RTT_FAIR_MS) worse(FAIR);
+  if (lostRun_ >= 2) worse(POOR);
+  else if (lostRun_ == 1) worse(FAIR);
+  if (txFailRecent_) worse(FAIR);
+  return g;
+}
+
+void LinkMonitor::setGrade(Grade g) {
+  if (g == grade_) return;
+  grade_ = g;
+  reportPending_ = true;
+  Serial.printf("[LINK] %s rssi=%d rtt=%ums lost=%u txfail=%u\n",
+                g == GOOD ? "GOOD" : g == FAIR ? "FAIR" : "POOR", rssi(), srttMs_, lost_, txFails_);
+}
@@ -0,0 +1,64 @@
+// firmware/src/LinkMonitor.h
+#pragma once
+#include <Arduino.h>
+#include "Config.h"
+
+// Continuous link-quality estimate for the WS session: smoothed RSSI, RTT from
+// "probe" echoes (TCP-style srtt), probe loss and failed sends. The grade drives
+// the local telemetry budget and the command rate / payload mode advertised to
+// the server, so a weak link carries fewer, fresher messages.
+class LinkMonitor {
+public:
+  enum Grade : uint8_t { GOOD = 0, FAIR, POOR };
+
+  void reset(uint32_t now);
+
+  // Sample RSSI, expire the outstanding probe, re-grade. Call every LINK_SAMPLE_MS
+  // while connected (NetClient's "link" job).
+  void poll(uint32_t now);
+
+  // Probe scheduling: probeDue() -> send {"kind":"probe","id":..} -> onProbeEcho(id).
+  // Counted in samples, so a late job release does not stretch the probe period.
+  bool probeDue() const { return !probeOut_ && samplesSinceProbe_ >= LINK_PROBE_MS / LINK_SAMPLE_MS; }
+  uint16_t startProbe(uint32_t now);
+  void onProbeEcho(uint16_t id, uint32_t now);
+
+  // ws.sendTXT/sendBIN returned false (TCP send buffer full / socket stalled)
+  void noteTxFail() {
+    if (txFails_ < 0xFFFF) txFails_++;
+    txFailRecent_ = true;
+  }
+
+  // Grade changed or LINK_REPORT_MS elapsed; clears the flag
+  bool reportDue(uint32_t now);
+
+  Grade grade() const { return grade_; }
+  int8_t rssi() const { return (int8_t)(rssiX16_ / 16); }
+  uint16_t rttMs() const { return srttMs_; }
+  uint16_t probesLost() const { return lost_; }
+  uint16_t txFails() const { return txFails_; }
+  uint8_t cmdHz() const { return LINK_CMD_HZ[grade_]; }
+  uint8_t telemetryPerSec() const { return LINK_TLM_PER_SEC[grade_]; }
+  uint8_t odomPeriodMul() const { return LINK_ODOM_MUL[grade_]; }
+  const char* payloadMode() const { return grade_ == GOOD ? "full" : "lean"; }
+
+private:
+  int16_t rssiX16_ = 0;        // EWMA (1/4) of RSSI dBm, x16
+  bool rssiValid_ = false;
+  uint16_t srttMs_ = 0;        // EWMA (1/8) of probe RTT
+  uint32_t lastProbeMs_ = 0;
+  uint8_t samplesSinceProbe_ = 0;
+  uint16_t probeId_ = 0;
+  bool probeOut_ = false;
+  uint8_t lostRun_ = 0;        // consecutive lost probes
+  uint16_t lost_ = 0;
+  uint16_t txFails_ = 0;
+  bool txFailRecent_ = false;  // a send failed since the last grading
+  Grade grade_ = GOOD;
+  uint32_t betterSinceMs_ = 0; // 0 = no upgrade candidate
+  uint32_t lastReportMs_ = 0;
+  bool reportPending_ = true;
+
+  Grade measure() const;
+  void setGrade(Grade g);
+};
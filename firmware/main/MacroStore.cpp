@@ -0,0 +1,95 @@
+// firmware/src/MacroStore.cpp
+#include "MacroStore.h"
+#include <LittleFS.h>
+
+bool MacroStore::begin() {
+  mounted_ = LittleFS.begin();
+  if (!mounted_) {
+    Serial.println("[MACRO] LittleFS mount failed; macros disabled");
+    return false;
+  }
+
+  uint8_t found = 0;
+  for (uint8_t id = 0; id < MACRO_SLOTS; ++id) {
+    Macro m;
+    hashes_[id] = load(id, m) ? m.hash : 0;
+    if (hashes_[id]) found++;
+  }
+  Serial.printf("[MACRO] %u macro(s) in flash\n", found);
+  return true;
+}
+
+bool MacroStore::put(uint8_t id, uint32_t hash, const uint8_t* data, size_t len) {
+  if (!mounted_ || id >= MACRO_SLOTS) return false;
+  if (len == 0 || len % sizeof(MacroStep) != 0 || len / sizeof(MacroStep) > MACRO_MAX_STEPS) {
+    return false;
+  }
+  if (fnv1a(data, len) != hash) {
+    Serial.printf("[MACRO] put id=%u hash mismatch\n", id);
+    return false;
+  }
+  if (hashes_[id] == hash) return true;  // already stored
+
+  char path[24];
+  pathFor(id, path, sizeof(path));
+  File f = LittleFS.open(path, "w");
+  if (!f) return false;
+
+  Header h{MAGIC, hash, (uint8_t)(len / sizeof(MacroStep)), {0, 0, 0}};
+  bool ok = f.write(reinterpret_cast<const uint8_t*>(&h), sizeof(h)) == sizeof(h) &&
+            f.write(data, len) == len;
+  f.close();
+  if (!ok) {
+    LittleFS.remove(path);
+    hashes_[id] = 0;
+    return false;
+  }
+  hashes_[id] = hash;
+  Serial.printf("[MACRO] stored id=%u steps=%u hash=%08x\n", id, h.count, (unsigned)hash);
+  return true;
+}
+
+bool MacroStore::load(uint8_t id, Macro& out) const {
+  if (!mounted_ || id >= MACRO_SLOTS) return false;
+  char path[24];
+  pathFor(id, path, sizeof(path));
+  if (!LittleFS.exists(path)) return false;
+
+  File f = LittleFS.open(path, "r");
+  if (!f) return false;
+  Header h;
+  bool ok = f.read(reinterpret_cast<uint8_t*>(&h), sizeof(h)) == sizeof(h) &&
+            h.magic == MAGIC && h.count > 0 && h.count <= MACRO_MAX_STEPS;
+  if (ok) {
+    const size_t len = h.count * sizeof(MacroStep);
+    ok = f.read(reinterpret_cast<uint8_t*>(out.steps), len) == len &&
+         fnv1a(reinterpret_cast<const uint8_t*>(out.steps), len) == h.hash;
+  }
+  f.close();
+  if (!ok) return false;
+  out.hash = h.hash;
+  out.count = h.count;
+  return true;
+}
+
+bool MacroStore::remove(uint8_t id) {
+  if (!mounted_ || id >= MACRO_SLOTS) return false;
+  char path[24];
+  pathFor(id, path, sizeof(path));
+  hashes_[id] = 0;
+  return LittleFS.remove(path);
+}
+
+// FNV-1a 32-bit (same function in server/src/macros.ts)
+uint32_t MacroStore::fnv1a(const uint8_t* data, size_t len) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < len; ++i) {
+    h ^= data[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+void MacroStore::pathFor(uint8_t id, char* out, size_t len) {
+  snprintf(out, len, "/macros/%u.bin", id);
+}
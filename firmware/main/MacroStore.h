@@ -0,0 +1,61 @@
+// firmware/src/MacroStore.h
+#pragma once
+#include <Arduino.h>
+#include "Config.h"
+
+// ==== Flash-resident motion macros ====
+// A macro is a short list of fixed-size steps stored in LittleFS (/macros/<id>.bin).
+// It is uploaded once (macro.put, content-hashed) and replayed by id (macro.run)
+// on TaskRunner's clock, so repeated runs are bit-identical.
+
+enum class MacroDevice : uint8_t {
+  WHEELS = 0,  // left/right %, durationMs
+  ARM = 1,     // angle, durationMs
+  NECK = 2,    // angle, durationMs
+  WAIT = 3     // durationMs only
+};
+
+// Wire/flash format: 6 bytes per step, little-endian duration
+struct __attribute__((packed)) MacroStep {
+  uint8_t device;      // MacroDevice
+  int8_t left;
+  int8_t right;
+  uint8_t angle;
+  uint16_t durationMs;
+};
+static_assert(sizeof(MacroStep) == 6, "MacroStep must stay 6 bytes (wire format)");
+
+struct Macro {
+  uint32_t hash = 0;
+  uint8_t count = 0;
+  MacroStep steps[MACRO_MAX_STEPS];
+};
+
+class MacroStore {
+public:
+  bool begin();  // mount LittleFS and index stored macros
+
+  // Verify FNV-1a hash of `data` and persist it; returns false on bad hash/size/IO
+  bool put(uint8_t id, uint32_t hash, const uint8_t* data, size_t len);
+  bool load(uint8_t id, Macro& out) const;
+  bool remove(uint8_t id);
+
+  // 0 = slot empty
+  uint32_t hashOf(uint8_t id) const { return id < MACRO_SLOTS ? hashes_[id] : 0; }
+
+  static uint32_t fnv1a(const uint8_t* data, size_t len);
+
+private:
+  struct Header {
+    uint32_t magic;
+    uint32_t hash;
+    uint8_t count;
+    uint8_t reserved[3];
+  };
+  static constexpr uint32_t MAGIC = 0x3152434D;  // "MCR1"
+
+  bool mounted_ = false;
+  uint32_t hashes_[MACRO_SLOTS] = {0};
+
+  static void pathFor(uint8_t id, char* out, size_t len);
+};
@@ -0,0 +1,157 @@
+// firmware/src/MaxBus.cpp
+#include "MaxBus.h"
+
+// timer1 at 80MHz / 16 = 5 ticks per us
+static constexpr uint32_t TICKS_PER_US = 5;
+static constexpr uint32_t BIT_TICKS = MaxBus::BIT_US * TICKS_PER_US;
+static constexpr uint32_t SAMPLE_TICKS = BIT_TICKS / MaxBus::RX_OVERSAMPLE;
+
+MaxBus MaxBus::s_bus;
+
+bool MaxBus::begin(const uint8_t (&pins)[CHANNELS]) {
+  chMask_ = 0;
+  for (uint8_t ch = 0; ch < CHANNELS; ++ch) {
+    gpio_[ch] = 0;
+    if (pins[ch] == MAX_PIN_UNUSED) continue;
+    if (pins[ch] > 15) {
+      Serial.printf("[MAXBUS] channel %u: GPIO%u is not on the GPO register\n", ch, pins[ch]);
+      return false;
+    }
+    pinMode(pins[ch], OUTPUT);
+    digitalWrite(pins[ch], HIGH);  // idle high
+    gpio_[ch] = 1u << pins[ch];
+    chMask_ |= 1u << ch;
+  }
+
+  timer1_isr_init();
+  timer1_attachInterrupt(&MaxBus::onTimer);
+  timer1_enable(TIM_DIV16, TIM_EDGE, TIM_SINGLE);
+  Serial.printf("[MAXBUS] bit-parallel bus on channel mask 0x%X, frame %luus\n", chMask_,
+                (unsigned long)FRAME_US);
+  return chMask_ != 0;
+}
+
+bool MaxBus::submit(uint8_t ch, uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3) {
+  if (!enabled(ch)) return false;
+
+  noInterrupts();
+  uint8_t idx;
+  if (qCount_[ch] < QUEUE_DEPTH) {
+    idx = (qHead_[ch] + qCount_[ch]) % QUEUE_DEPTH;
+    qCount_[ch]++;
+  } else {
+    // Newest-wins: overwrite the last queued frame (never the one on the wire)
+    idx = (qHead_[ch] + QUEUE_DEPTH - 1) % QUEUE_DEPTH;
+    coalesced_[ch]++;
+  }
+  Frame& f = queue_[ch][idx];
+  f.data[0] = d0;
+  f.data[1] = d1;
+  f.data[2] = d2;
+  f.data[3] = d3;
+  interrupts();
+  return true;
+}
+
+void MaxBus::kick() {
+  if (phase_ != Phase::IDLE) return;
+  noInterrupts();
+  if (phase_ == Phase::IDLE) startFrame();
+  interrupts();
+}
+
+bool MaxBus::idle(uint8_t ch) const {
+  return ch >= CHANNELS || (qCount_[ch] == 0 && !(active_ & (1u << ch)));
+}
+
+void IRAM_ATTR MaxBus::onTimer() {
+  s_bus.onTick();
+}
+
+// Frame boundary: pop the next frame of every channel, drive the lines high
+// (output enabled) and clock the first slot one bit time later.
+void IRAM_ATTR MaxBus::startFrame() {
+  uint8_t active = 0;
+  uint32_t gpio = 0;
+  for (uint8_t ch = 0; ch < CHANNELS; ++ch) {
+    if (!qCount_[ch]) continue;
+    const Frame& f = queue_[ch][qHead_[ch]];
+    qHead_[ch] = (qHead_[ch] + 1) % QUEUE_DEPTH;
+    qCount_[ch]--;
+
+    uint8_t* w = wire_[ch];
+    w[0] = 0xFF;
+    w[1] = f.data[0];
+    w[2] = f.data[1];
+    w[3] = f.data[2];
+    w[4] = f.data[3];
+    w[5] = checksum(f.data[0], f.data[1], f.data[2], f.data[3], module_[ch]);
+    rxHigh_[ch] = rxBit_[ch] = rxByte_[ch] = 0;
+    active |= 1u << ch;
+    gpio |= gpio_[ch];
+  }
+
+  active_ = active;
+  activeGpio_ = gpio;
+  if (!active) {
+    phase_ = Phase::IDLE;  // TIM_SINGLE: not re-armed
+    return;
+  }
+  GPOS = gpio;
+  GPES = gpio;
+  phase_ = Phase::TX;
+  slot_ = 0;
+  timer1_write(BIT_TICKS);
+}
+
+void IRAM_ATTR MaxBus::onTick() {
+  const uint8_t active = active_;
+
+  if (phase_ == Phase::TX) {
+    if (slot_ < FRAME_SLOTS) {
+      uint32_t set, clr;
+      slotMasks(wire_, gpio_, active, slot_, set, clr);
+      GPO = (GPO | set) & ~clr;  // every channel changes level in the same write
+      slot_++;
+      timer1_write(BIT_TICKS);
+      return;
+    }
+    // Last stop bit done: release the lines for the module reply
+    GPEC = activeGpio_;
+    phase_ = Phase::RX;
+    slot_ = 0;
+    rxArmed_ = 0;
+    timer1_write(SAMPLE_TICKS);
+    return;
+  }
+
+  if (phase_ == Phase::RX) {
+    const uint32_t in = GPI;
+    for (uint8_t ch = 0; ch < CHANNELS; ++ch) {
+      if (!(active & (1u << ch)) || slot_ < RX_SETTLE_SAMPLES) continue;
+      // Count high pulses only after the line was seen low (skip the released idle level)
+      if (!(rxArmed_ & (1u << ch))) {
+        if (!(in & gpio_[ch])) rxArmed_ |= 1u << ch;
+        continue;
+      }
+      if (in & gpio_[ch]) {
+        if (rxHigh_[ch] < 0xFF) rxHigh_[ch]++;
+      } else if (rxHigh_[ch]) {
+        if (rxBit_[ch] < 8 && rxHigh_[ch] >= RX_ONE_SAMPLES) rxByte_[ch] |= 1u << rxBit_[ch];
+        rxBit_[ch]++;
+        rxHigh_[ch] = 0;
+      }
+    }
+    if (++slot_ < RX_SAMPLES) {
+      timer1_write(SAMPLE_TICKS);
+      return;
+    }
+    for (uint8_t ch = 0; ch < CHANNELS; ++ch) {
+      if (!(active & (1u << ch))) continue;
+      replies_[ch][module_[ch]] = rxByte_[ch];
+      module_[ch] = (module_[ch] + 1) & 3;
+      framesSent_[ch]++;
+    }
+    startFrame();
+  }
+}
@@ -0,0 +1,116 @@
+// firmware/src/MaxBus.h
+#pragma once
+#include <Arduino.h>
+#include "Config.h"
+
+// ==== Bit-parallel multi-channel MAX bus ====
+// One timer1 ISR clocks every MAX channel (one GPIO each) in the same bit slots:
+// a slot is a single GPO register write carrying the level of all channels, so
+// frames on up to four channels take the wire time of one.
+//
+// Frame (per channel), 2400 baud: 0xFF, data[pos 0..3], checksum|module, each
+// byte = start bit (0) + 8 data bits LSB first + 2 stop bits (1). The lines are
+// then released for the reply window, where the addressed module answers with
+// pulse-width coded bits (long high pulse = 1). Module addresses rotate 0..3
+// per frame, as in the MeccaChannel library.
+//
+// Producers (devices) queue frames per channel without blocking; the ISR pops
+// the next frame of every channel at each frame boundary.
+class MaxBus {
+public:
+  static constexpr uint8_t CHANNELS = MAXProtocol::CHANNEL_COUNT;
+  static constexpr uint8_t QUEUE_DEPTH = 2;
+  static constexpr uint8_t FRAME_BYTES = 6;
+  static constexpr uint8_t SLOTS_PER_BYTE = 11;
+  static constexpr uint16_t FRAME_SLOTS = FRAME_BYTES * SLOTS_PER_BYTE;
+  static constexpr uint32_t BIT_US = 417;                       // 2400 baud
+  static constexpr uint8_t RX_OVERSAMPLE = 4;                   // reply sampled at BIT_US / 4
+  static constexpr uint16_t RX_SAMPLES = MAX_REPLY_WINDOW_US * RX_OVERSAMPLE / BIT_US;
+  static constexpr uint8_t RX_ONE_SAMPLES = RX_OVERSAMPLE;      // high pulse >= ~1 bit time = 1
+  static constexpr uint16_t RX_SETTLE_SAMPLES = 1500 * RX_OVERSAMPLE / BIT_US;  // ~1.5ms turnaround
+  static constexpr uint32_t FRAME_US = (FRAME_SLOTS + 1) * BIT_US + MAX_REPLY_WINDOW_US;
+
+  static MaxBus& instance() { return s_bus; }
+
+  // pins[ch] = GPIO for channel ch, MAX_PIN_UNUSED to leave it off.
+  // GPIO16 is not on the GPO register and is rejected.
+  bool begin(const uint8_t (&pins)[CHANNELS]);
+
+  // Queue a frame; the 4 bytes are the data for positions 0..3. When the
+  // channel queue is full the newest queued (not yet started) frame is replaced.
+  // Returns false only if the channel is not configured.
+  bool submit(uint8_t ch, uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3);
+
+  // Start transmitting if the bus is idle. Called once per loop after every
+  // device had its turn, so frames submitted in the same pass share slots.
+  void kick();
+
+  bool enabled(uint8_t ch) const { return ch < CHANNELS && (chMask_ & (1u << ch)); }
+  bool idle(uint8_t ch) const;                           // nothing queued or on the wire
+  uint8_t reply(uint8_t ch, uint8_t pos) const { return replies_[ch][pos & 3]; }
+  uint32_t framesSent(uint8_t ch) const { return framesSent_[ch]; }
+  uint32_t coalesced(uint8_t ch) const { return coalesced_[ch]; }
+
+  // ---- Waveform (pure: no hardware access) ----
+  static uint8_t checksum(uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3, uint8_t module) {
+    uint16_t cs = d0 + d1 + d2 + d3;
+    cs = cs + (cs >> 8);
+    cs = cs + (cs << 4);
+    return (uint8_t)((cs & 0xF0) | (module & 0x0F));
+  }
+
+  // Line level of bit slot `slot` (0..FRAME_SLOTS-1) of a serialised frame
+  static bool slotLevel(const uint8_t (&wire)[FRAME_BYTES], uint16_t slot) {
+    const uint8_t k = slot % SLOTS_PER_BYTE;
+    if (k == 0) return false;                 // start bit
+    if (k > 8) return true;                   // 2 stop bits
+    return (wire[slot / SLOTS_PER_BYTE] >> (k - 1)) & 1;
+  }
+
+  // GPO bits to set/clear for one slot across the channels in `active`
+  static void slotMasks(const uint8_t (&wire)[CHANNELS][FRAME_BYTES], const uint32_t (&gpio)[CHANNELS],
+                        uint8_t active, uint16_t slot, uint32_t& set, uint32_t& clr) {
+    set = clr = 0;
+    for (uint8_t ch = 0; ch < CHANNELS; ++ch) {
+      if (!(active & (1u << ch))) continue;
+      (slotLevel(wire[ch], slot) ? set : clr) |= gpio[ch];
+    }
+  }
+
+private:
+  enum class Phase : uint8_t { IDLE, TX, RX };
+
+  struct Frame {
+    uint8_t data[4];
+  };
+
+  static MaxBus s_bus;
+  static void IRAM_ATTR onTimer();
+
+  // Configuration
+  uint8_t chMask_ = 0;
+  uint32_t gpio_[CHANNELS] = {0};
+
+  // Per-channel queues (main loop produces, ISR consumes)
+  Frame queue_[CHANNELS][QUEUE_DEPTH];
+  volatile uint8_t qHead_[CHANNELS] = {0};
+  volatile uint8_t qCount_[CHANNELS] = {0};
+
+  // ISR state
+  volatile Phase phase_ = Phase::IDLE;
+  volatile uint8_t active_ = 0;            // channels with a frame in flight
+  uint32_t activeGpio_ = 0;
+  uint8_t rxArmed_ = 0;
+  uint16_t slot_ = 0;
+  uint8_t wire_[CHANNELS][FRAME_BYTES];
+  uint8_t module_[CHANNELS] = {0};
+  uint8_t rxHigh_[CHANNELS] = {0};
+  uint8_t rxBit_[CHANNELS] = {0};
+  uint8_t rxByte_[CHANNELS] = {0};
+  uint8_t replies_[CHANNELS][4] = {{0}};
+  uint32_t framesSent_[CHANNELS] = {0};
+  uint32_t coalesced_[CHANNELS] = {0};
+
+  void IRAM_ATTR startFrame();
+  void IRAM_ATTR onTick();
+};
@@ -5,6 +5,8 @@
 #include <vector>
 
 #include "TaskRunner.h"
+#include "RtcSnapshot.h"
+#include "PeriodicScheduler.h"
 #include "Protocol.h"
 
 // static
@@ -15,13 +17,29 @@ NetClient::NetClient()
       connected(false),
       lastConnectAttempt(0),
       reconnectDelay(WS_RECONNECT_BASE_MS),
+      wifiConnecting_(false),
+      lastWifiCheckMs_(0),
       msgSeq_(0),
       lastTelemetryMs_(0),
       telemetryCount_(0),
-      wifiConnecting_(false),
-      lastWifiCheckMs_(0) {
-  // Initialize JSON buffer
-  jsonBuffer_[0] = '\0';
+      rxSeq_(0),
+      flowAckPending_(false),
+      lastFlowAckMs_(0),
+      lastAdvertisedWin_(0),
+      odomMoving_(false),
+      binTelemetry_(false),
+      stopLat_{0, 0, 0, 0},
+      lastPollUs_(0),
+      rxHeldLen_(0),
+      rxFrames_(0),
+      rxElided_(0),
+      udpToken_(0),
+      udpSeq_(0),
+      udpRx_(0),
+      udpDropped_(0),
+      udpHold_(false),
+      udpFenced_(false) {
+  txBuffer_[0] = '\0';
 }
 
 void NetClient::begin(TaskRunner* r) {
@@ -36,10 +54,21 @@ void NetClient::begin(TaskRunner* r) {
   WiFi.setSleep(false);  // Prevent modem-sleep to avoid PONG delays
 
   // Start Wi-Fi connection (non-blocking)
-  Serial.printf("[NET] Starting WiFi connection to: %s\n", WIFI_SSID);
-  WiFi.begin(WIFI_SSID, WIFI_PASS);
-  wifiConnecting_ = true;
-  lastWifiCheckMs_ = millis();
+  beginWifi();
+
+  endpoints_.begin();
+
+  PeriodicScheduler& sched = PeriodicScheduler::instance();
+  wifiJob_ = sched.add("wifi", warmWifi_ ? WARM_WIFI_POLL_MS : WIFI_CHECK_MS, 2, SCHED_NET_BUDGET_US,
+                       &NetClient::wifiThunk, this);
+  sched.add("probe", EP_PROBE_MS, 2, SCHED_NET_BUDGET_US, &NetClient::probeThunk, this);
+  linkJob_ = sched.add("link", LINK_SAMPLE_MS, 2, SCHED_NET_BUDGET_US, &NetClient::linkThunk, this);
+  if (ODOM_STREAM_MS) {
+    odomJob_ = sched.add("odom", ODOM_STREAM_MS, 3, SCHED_NET_BUDGET_US, &NetClient::odomThunk, this);
+  }
+  sched.add("heap", HEAP_ALERT_CHECK_MS, 3, SCHED_NET_BUDGET_US, &NetClient::heapThunk, this);
+  sched.add("rtc", RTC_SNAPSHOT_MS, 3, SCHED_NET_BUDGET_US, &NetClient::snapshotThunk, this);
+  if (SCHED_REPORT_MS) sched.add("report", SCHED_REPORT_MS, 4, SCHED_NET_BUDGET_US, &NetClient::schedReportThunk, this);
 
   // Callback C-style -> trampoline
   ws.onEvent(&NetClient::onWsEventThunk);
@@ -56,37 +85,168 @@ void NetClient::begin(TaskRunner* r) {
                      WS_HEARTBEAT_TRIES);
 
   Serial.printf("[NET] WS cfg host=%s port=%u path=%s hb=%ums/%umsx%u\n",
-                WS_HOST, WS_PORT, WS_PATH,
+                endpoints_.current().host, endpoints_.current().port, WS_PATH,
                 (unsigned)WS_HEARTBEAT_INTERVAL_MS,
                 (unsigned)WS_HEARTBEAT_TIMEOUT_MS,
                 (unsigned)WS_HEARTBEAT_TRIES);
 
+  heap_.begin();
+
+  if (UDP_DRIVE_PORT) {
+    udp_.begin(UDP_DRIVE_PORT);
+    Serial.printf("[NET] UDP drive port %u\n", (unsigned)UDP_DRIVE_PORT);
+  }
+
   // WebSocket connection will be attempted in loop() once WiFi is ready
 }
 
+void NetClient::beginWifi() {
+  RtcSnapshot& rtc = RtcSnapshot::instance();
+  const RtcSnapshot::State& st = rtc.state();
+  if (rtc.warm()) msgSeq_ = st.msgSeq;  // server sees one continuing sequence
+
+  warmWifi_ = rtc.warm() && st.channel != 0;
+  if (warmWifi_) {
+    // Skip the scan and DHCP: same AP, channel and address as before the reset;
+    // first WS attempt without backoff
+    Serial.printf("[NET] Warm WiFi rejoin: %s ch=%u\n", WIFI_SSID, st.channel);
+    WiFi.config(IPAddress(st.ip), IPAddress(st.gateway), IPAddress(st.subnet), IPAddress(st.dns));
+    WiFi.begin(WIFI_SSID, WIFI_PASS, st.channel, st.bssid);
+    reconnectDelay = 0;
+  } else {
+    Serial.printf("[NET] Starting WiFi connection to: %s\n", WIFI_SSID);
+    WiFi.begin(WIFI_SSID, WIFI_PASS);
+  }
+  wifiConnecting_ = true;
+  lastWifiCheckMs_ = millis();
+  warmWifiStartMs_ = lastWifiCheckMs_;
+}
+
+// Remember this association for a warm rejoin after a crash
+void NetClient::onWifiConnected() {
+  RtcSnapshot& rtc = RtcSnapshot::instance();
+  RtcSnapshot::State& st = rtc.state();
+  const uint8_t* bssid = WiFi.BSSID();
+  if (bssid) memcpy(st.bssid, bssid, sizeof(st.bssid));
+  st.channel = (uint8_t)WiFi.channel();
+  st.ip = WiFi.localIP();
+  st.gateway = WiFi.gatewayIP();
+  st.subnet = WiFi.subnetMask();
+  st.dns = WiFi.dnsIP();
+  rtc.save();
+  if (warmWifi_) {
+    Serial.printf("[NET] Warm WiFi rejoin took %lums\n", (unsigned long)(millis() - warmWifiStartMs_));
+  }
+  warmWifi_ = false;
+}
+
+void NetClient::wifiThunk(void* ctx, uint32_t now) { static_cast<NetClient*>(ctx)->pollWifi(now); }
+
+void NetClient::probeThunk(void* ctx, uint32_t now) { static_cast<NetClient*>(ctx)->pollEndpoints(now); }
+
+void NetClient::linkThunk(void* ctx, uint32_t now) {
+  NetClient* self = static_cast<NetClient*>(ctx);
+  if (self->connected) self->pollLink(now);
+}
+
+void NetClient::odomThunk(void* ctx, uint32_t now) {
+  NetClient* self = static_cast<NetClient*>(ctx);
+  if (self->connected) self->pollOdometry(now);
+}
+
+// Heap telemetry: sample always (keeps minimum-ever accurate), report when online
+void NetClient::heapThunk(void* ctx, uint32_t now) {
+  NetClient* self = static_cast<NetClient*>(ctx);
+  if (self->heap_.poll(now) && self->connected) self->sendStats();
+}
+
+void NetClient::snapshotThunk(void* ctx, uint32_t /*now*/) {
+  NetClient* self = static_cast<NetClient*>(ctx);
+  if (self->connected) self->saveSnapshot();
+}
+
+void NetClient::schedReportThunk(void* ctx, uint32_t /*now*/) {
+  NetClient* self = static_cast<NetClient*>(ctx);
+  if (self->connected) self->sendSchedReport();
+}
+
+// Session seq and pose, refreshed every RTC_SNAPSHOT_MS (RTC memory, no flash wear)
+void NetClient::saveSnapshot() {
+  RtcSnapshot& rtc = RtcSnapshot::instance();
+  RtcSnapshot::State& st = rtc.state();
+  st.msgSeq = msgSeq_;
+  if (runner) {
+    const Odometry& odom = runner->odometry();
+    st.poseXMm = odom.xMm();
+    st.poseYMm = odom.yMm();
+    st.headingBam = odom.headingBam();
+    st.poseEpoch = odom.epoch();
+  }
+  rtc.save();
+}
+
 void NetClient::loop() {
-  ws.loop();      // Must be called frequently (< ~50ms)
+  // Gap between receive polls = how long a stop frame can wait to be read
+  const uint32_t pollUs = micros();
+  if (lastPollUs_ != 0 && pollUs - lastPollUs_ > stopLat_.pollGapMaxUs) {
+    stopLat_.pollGapMaxUs = pollUs - lastPollUs_;
+  }
+  lastPollUs_ = pollUs;
+
+  // Drain what the socket has (a burst after a Wi-Fi stall arrives one frame per
+  // ws.loop()), then apply the newest held drive frame once
+  for (uint8_t i = 0; i < RX_DRAIN_MAX_FRAMES; ++i) {
+    const uint32_t before = rxFrames_;
+    ws.loop();      // Must be called frequently (< ~50ms)
+    if (rxFrames_ == before) break;
+  }
+  flushHeldDrive();
+  pollUdp();
   yield();        // Feed Wi-Fi stack to avoid starvation
 
   const uint32_t now = millis();
-  
-  // Check Wi-Fi connection status periodically (non-blocking)
+
+  // Attempt WebSocket connection if WiFi is ready and not already connected
+  if (!connected && WiFi.status() == WL_CONNECTED) {
+    if (now - lastConnectAttempt >= reconnectDelay) {
+      connect();
+    }
+  }
+
+  if (connected) {
+    pollGroupReport();
+    pollBehaviorReport();
+    flushFlowAck(now);
+    // Re-evaluated every pass: motion starting switches the odom job to the fast
+    // period at once (re-phased from its last release)
+    PeriodicScheduler::instance().setPeriod(odomJob_, odomPeriodMs());
+  }
+}
+
+// Wi-Fi status check: scheduler job, every WIFI_CHECK_MS (WARM_WIFI_POLL_MS while rejoining warm)
+void NetClient::pollWifi(uint32_t now) {
   if (wifiConnecting_) {
-    if (now - lastWifiCheckMs_ >= 500) {  // Check every 500ms
-      lastWifiCheckMs_ = now;
-      wl_status_t status = WiFi.status();
-      
-      if (status == WL_CONNECTED) {
-        wifiConnecting_ = false;
-        Serial.printf("[NET] WiFi connected, IP=%s\n", WiFi.localIP().toString().c_str());
-      } else if (status == WL_CONNECT_FAILED || status == WL_NO_SSID_AVAIL) {
-        // Connection failed, retry after delay
-        wifiConnecting_ = false;
-        Serial.println("[NET] WiFi connection failed, will retry");
-        lastWifiCheckMs_ = now + 5000;  // Retry after 5s
-      }
-      // Otherwise still connecting, keep waiting
+    lastWifiCheckMs_ = now;
+    wl_status_t status = WiFi.status();
+
+    if (status == WL_CONNECTED) {
+      wifiConnecting_ = false;
+      Serial.printf("[NET] WiFi connected, IP=%s\n", WiFi.localIP().toString().c_str());
+      onWifiConnected();
+    } else if (warmWifi_ && (status == WL_CONNECT_FAILED || status == WL_NO_SSID_AVAIL ||
+                             now - warmWifiStartMs_ >= WARM_WIFI_TIMEOUT_MS)) {
+      // AP moved or the address is gone: back to scan + DHCP
+      Serial.println("[NET] Warm WiFi rejoin failed, scanning");
+      warmWifi_ = false;
+      WiFi.config(IPAddress(), IPAddress(), IPAddress());
+      WiFi.begin(WIFI_SSID, WIFI_PASS);
+    } else if (status == WL_CONNECT_FAILED || status == WL_NO_SSID_AVAIL) {
+      // Connection failed, retry after delay
+      wifiConnecting_ = false;
+      Serial.println("[NET] WiFi connection failed, will retry");
+      lastWifiCheckMs_ = now + 5000;  // Retry after 5s
     }
+    // Otherwise still connecting, keep waiting
   } else if (WiFi.status() != WL_CONNECTED) {
     // WiFi disconnected, attempt reconnection
     if (now - lastWifiCheckMs_ >= 5000) {
@@ -96,56 +256,156 @@ void NetClient::loop() {
       lastWifiCheckMs_ = now;
     }
   }
+  PeriodicScheduler::instance().setPeriod(wifiJob_, warmWifi_ && wifiConnecting_ ? WARM_WIFI_POLL_MS : WIFI_CHECK_MS);
+}
 
-  // Attempt WebSocket connection if WiFi is ready and not already connected
-  if (!connected && WiFi.status() == WL_CONNECTED) {
-    if (now - lastConnectAttempt >= reconnectDelay) {
-      connect();
-    }
+// One "sched" envelope per job: lateness/overrun histograms since that job was last
+// reported. Only the jobs sent start a new window; when the budget runs out the
+// rest keep counting and lead the next report.
+void NetClient::sendSchedReport() {
+  PeriodicScheduler& sched = PeriodicScheduler::instance();
+  for (uint8_t n = 0; n < sched.count(); ++n) {
+    if (!canSendTelemetry()) break;
+    const uint8_t i = schedReportNext_ < sched.count() ? schedReportNext_ : 0;
+    const PeriodicScheduler::Stats& st = sched.stats(i);
+    JsonWriter json = beginEnvelope(Protocol::RESP_SCHED);
+    json.add("job", st.name);
+    json.add("p", st.periodMs);
+    json.add("b", st.budgetUs);
+    json.add("n", st.runs);
+    json.add("skip", st.skipped);
+    json.add("lateMax", st.maxLateUs);
+    json.add("runMax", st.maxRunUs);
+    json.beginArray("late");
+    for (uint16_t c : st.late) json.item(c);
+    json.endArray();
+    json.beginArray("over");
+    for (uint16_t c : st.over) json.item(c);
+    json.endArray();
+    json.add("seq", ++msgSeq_);
+    sendEnvelope(json);
+    sched.resetStats(i);
+    schedReportNext_ = i + 1;
   }
 }
 
 void NetClient::sendAck(const String& taskId) {
-  if (!connected || !canSendTelemetry()) return;
-  ackDoc_.clear();
-  ackDoc_["kind"] = Protocol::RESP_ACK;
-  ackDoc_["taskId"] = taskId;
-  ackDoc_["seq"] = ++msgSeq_;
-  sendEnvelope(ackDoc_);
+  if (!connected) return;
+  chargeTelemetry();
+  const int32_t rec[TelemetryEncoder::PROGRESS_FIELDS] = {0, 0};
+  if (sendTelemetry(TelemetryEncoder::PROGRESS, rec, taskId.c_str())) return;
+  JsonWriter json = beginEnvelope(Protocol::RESP_ACK);
+  json.add("taskId", taskId.c_str());
+  json.add("seq", ++msgSeq_);
+  sendEnvelope(json);
 }
 
 void NetClient::sendProgress(const String& taskId, uint8_t pct, const String& note) {
   if (!connected || !canSendTelemetry()) return;
-  progressDoc_.clear();
-  progressDoc_["kind"] = Protocol::RESP_PROGRESS;
-  progressDoc_["taskId"] = taskId;
-  progressDoc_["pct"] = pct;
-  progressDoc_["seq"] = ++msgSeq_;
+  const int32_t rec[TelemetryEncoder::PROGRESS_FIELDS] = {1, pct};
+  if (note.length() == 0 && sendTelemetry(TelemetryEncoder::PROGRESS, rec, taskId.c_str())) return;
+  JsonWriter json = beginEnvelope(Protocol::RESP_PROGRESS);
+  json.add("taskId", taskId.c_str());
+  json.add("pct", pct);
+  json.add("seq", ++msgSeq_);
   if (note.length() > 0) {
-    progressDoc_["note"] = note;
+    json.add("note", note.c_str());
   }
-  sendEnvelope(progressDoc_);
+  sendEnvelope(json);
 }
 
 void NetClient::sendDone(const String& taskId) {
-  if (!connected || !canSendTelemetry()) return;
-  doneDoc_.clear();
-  doneDoc_["kind"] = Protocol::RESP_DONE;
-  doneDoc_["taskId"] = taskId;
-  doneDoc_["seq"] = ++msgSeq_;
-  sendEnvelope(doneDoc_);
+  if (!connected) return;
+  chargeTelemetry();
+  const int32_t rec[TelemetryEncoder::PROGRESS_FIELDS] = {2, 100};
+  if (sendTelemetry(TelemetryEncoder::PROGRESS, rec, taskId.c_str())) return;
+  JsonWriter json = beginEnvelope(Protocol::RESP_DONE);
+  json.add("taskId", taskId.c_str());
+  json.add("seq", ++msgSeq_);
+  sendEnvelope(json);
 }
 
 void NetClient::sendError(const String& taskId, const String& message) {
-  if (!connected || !canSendTelemetry()) return;
-  errorDoc_.clear();
-  errorDoc_["kind"] = Protocol::RESP_ERROR;
-  errorDoc_["seq"] = ++msgSeq_;
+  if (!connected) return;
+  chargeTelemetry();
+  JsonWriter json = beginEnvelope(Protocol::RESP_ERROR);
+  json.add("seq", ++msgSeq_);
   if (taskId.length() > 0) {
-    errorDoc_["taskId"] = taskId;
+    json.add("taskId", taskId.c_str());
   }
-  errorDoc_["message"] = message;
-  sendEnvelope(errorDoc_);
+  json.add("message", message.c_str());
+  sendEnvelope(json);
+}
+
+void NetClient::applyFastStop(FrameScanner::Stop stop, uint32_t startUs) {
+  if (stop == FrameScanner::Stop::NONE || !runner) return;
+  runner->fastStop();
+  // A WS stop can overtake drive datagrams still in flight. Unless the server's stop
+  // seq already fenced them off (binary stop), none may restart motion until the
+  // server shows new drive intent (lease, drive, twist over WS).
+  if (stop != FrameScanner::Stop::DATAGRAM && udpToken_ && !udpFenced_) udpHold_ = true;
+  const uint32_t us = micros() - startUs;
+  if (stopLat_.count < 0xFFFF) stopLat_.count++;
+  stopLat_.lastUs = us;
+  if (us > stopLat_.maxUs) stopLat_.maxUs = us;
+#if DEBUG_LOGS
+  Serial.printf("[NET] fast stop kind=%u in %luus\n", (unsigned)stop, (unsigned long)us);
+#endif
+}
+
+static uint32_t readLe32(const uint8_t* p) {
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// Drain queued drive datagrams and apply only the newest (same idea as drive-frame
+// elision on the WS path). Read even while the channel is off so stale ones do not pile up.
+void NetClient::pollUdp() {
+  if (!UDP_DRIVE_PORT) return;
+  uint8_t best[Protocol::UDP_DRIVE_LEN];
+  uint32_t bestSeq = udpSeq_;
+  bool have = false;
+  uint32_t startUs = 0;
+  for (uint8_t i = 0; i < UDP_DRAIN_MAX; ++i) {
+    const int size = udp_.parsePacket();
+    if (size <= 0) break;
+    if (!have) startUs = micros();
+    uint8_t pkt[Protocol::UDP_DRIVE_LEN];
+    const int n = udp_.read(pkt, sizeof(pkt));
+    if (!udpToken_ || size != (int)Protocol::UDP_DRIVE_LEN || n != size || pkt[0] != Protocol::UDP_DRIVE ||
+        readLe32(pkt + 2) != udpToken_) {
+      udpDropped_++;
+      continue;
+    }
+    const uint32_t seq = readLe32(pkt + 6);
+    if ((int32_t)(seq - bestSeq) <= 0) {
+      udpDropped_++;  // reordered/duplicated behind a newer one
+      continue;
+    }
+    if (have) udpDropped_++;  // superseded within this burst
+    memcpy(best, pkt, sizeof(best));
+    bestSeq = seq;
+    have = true;
+  }
+  if (!have) return;
+  udpSeq_ = bestSeq;
+  const bool stop = best[1] & Protocol::UDP_FLAG_STOP;
+  if (udpHold_ && !stop) {
+    udpDropped_++;  // may predate the WS stop
+    return;
+  }
+  udpRx_++;
+  if (!runner) return;
+
+  if (stop) {
+    applyFastStop(FrameScanner::Stop::DATAGRAM, startUs);
+    return;
+  }
+  udpFenced_ = false;
+  const int left = constrain((int8_t)best[10], -100, 100);
+  const int right = constrain((int8_t)best[11], -100, 100);
+  runner->handleDriveTask((int8_t)left, (int8_t)right, 0);
+  const uint16_t ttl = (uint16_t)(best[12] | best[13] << 8);
+  if (ttl) runner->grantLease(ttl);
 }
 
 void NetClient::connect() {
@@ -162,13 +422,50 @@ void NetClient::connect() {
     return;
   }
 
+  // The last attempt never got a session: next healthy endpoint (the backoff already ran)
+  if (attemptPending_) {
+    const int8_t next = endpoints_.failover();
+    if (next >= 0) endpoints_.select((uint8_t)next);
+  }
+  attemptPending_ = true;
+
   lastConnectAttempt = millis();
+  const EndpointList::Endpoint& ep = endpoints_.current();
   Serial.printf("[NET] Connecting ws://%s:%u%s  (IP=%s)\n",
-                WS_HOST, WS_PORT, WS_PATH, WiFi.localIP().toString().c_str());
+                ep.host, ep.port, WS_PATH, WiFi.localIP().toString().c_str());
 
   // Nếu server có yêu cầu subprotocol, truyền ở tham số 4.
   // Nhiều server không cần -> có thể để "".
-  ws.begin(WS_HOST, WS_PORT, WS_PATH /*, "arduino"*/);
+  ws.begin(ep.host, ep.port, WS_PATH /*, "arduino"*/);
+}
+
+// Session lost: straight to the best other endpoint that answers its probes, no
+// backoff. false = none known healthy (the caller backs off as before).
+bool NetClient::failover() {
+  const int8_t next = endpoints_.failover();
+  if (next < 0) return false;
+  char from[EP_HOST_LEN + 6];
+  char to[EP_HOST_LEN + 6];
+  endpoints_.format(endpoints_.active(), from, sizeof(from));
+  endpoints_.format((uint8_t)next, to, sizeof(to));
+  Serial.printf("[NET] failover %s -> %s\n", from, to);
+  endpoints_.select((uint8_t)next);
+  connected = false;
+  attemptPending_ = false;
+  reconnectDelay = 0;
+  return true;
+}
+
+// Endpoint probe job (EP_PROBE_MS). The active server is probed too: when it stops
+// answering (host gone, no FIN/RST to end the session) and another one is up, the
+// session is closed here instead of waiting for the WS heartbeat to fail.
+void NetClient::pollEndpoints(uint32_t now) {
+  if (endpoints_.count() < 2 || WiFi.status() != WL_CONNECTED) return;
+  endpoints_.probe(now);
+  if (connected && !endpoints_.health(endpoints_.active()).up && endpoints_.failover() >= 0) {
+    Serial.printf("[NET] %s:%u stopped answering probes\n", endpoints_.current().host, endpoints_.current().port);
+    ws.disconnect();  // -> WStype_DISCONNECTED -> failover()
+  }
 }
 
 void NetClient::scheduleReconnect() {
@@ -196,12 +493,23 @@ void NetClient::handleEvent(WStype_t type, uint8_t* payload, size_t length) {
   switch (type) {
     case WStype_CONNECTED: {
       connected = true;
+      attemptPending_ = false;
       reconnectDelay = WS_RECONNECT_BASE_MS;
-      msgSeq_ = 0;
+      // msgSeq_ carries on across sessions (and servers)
       lastTelemetryMs_ = millis();
       telemetryCount_ = 0;
+      flowAckPending_ = false;
+      rxHeldLen_ = 0;
+      binTelemetry_ = false;  // until the server hello offers it
+      udpToken_ = 0;          // until the server enables the UDP channel
+      udpSeq_ = 0;
+      udpHold_ = false;
+      udpFenced_ = false;
+      link_.reset(millis());
       Serial.println("[NET] WebSocket CONNECTED");
       sendHello();
+      rxSeq_ = 0;  // task seq is per session; the hello reported where the last one stopped
+      PeriodicScheduler::instance().runNow(linkJob_);  // first sample and "link" report now
       
       // Wheels are already initialized and running via TaskRunner::loop()
       // No need to start continuous task here - tick() handles it
@@ -215,8 +523,14 @@ void NetClient::handleEvent(WStype_t type, uint8_t* payload, size_t length) {
     case WStype_DISCONNECTED: {
       // length không phải “code” chuẩn; chỉ log tối thiểu
       Serial.println("[NET] WebSocket DISCONNECTED");
-      scheduleReconnect();
-      if (runner) runner->onDisconnected();
+      rxHeldLen_ = 0;  // superseded by the stop below
+      binTelemetry_ = false;
+      udpToken_ = 0;  // datagrams belong to the session
+      // A Wi-Fi drop is not the server's fault: same endpoint, usual backoff
+      const bool failedOver = connected && WiFi.status() == WL_CONNECTED && failover();
+      if (!failedOver) scheduleReconnect();
+      // Failing over: live motion coasts on its lease until the next server renews it
+      if (runner) runner->onDisconnected(failedOver);
       break;
     }
     case WStype_ERROR: {
@@ -228,12 +542,32 @@ void NetClient::handleEvent(WStype_t type, uint8_t* payload, size_t length) {
       break;
     }
     case WStype_TEXT: {
-      String msg;
-      msg.reserve(length + 1);
-      for (size_t i = 0; i < length; ++i) msg += (char)payload[i];
-      handleMessage(msg);
+      rxFrames_++;
+      if (length <= RX_HOLD_BYTES && FrameScanner::isLastWinsDrive(payload, length)) {
+        // Stop/cancel act before the full parse; otherwise parse only the newest
+        applyFastStop(FrameScanner::scanStopText(payload, length), micros());
+        if (rxHeldLen_) rxElided_++;
+        memcpy(rxHeld_, payload, length);
+        rxHeldLen_ = length;
+        break;
+      }
+      flushHeldDrive();
+      applyFastStop(FrameScanner::scanStopText(payload, length), micros());
+      handleText(payload, length);
       break;
     }
+    case WStype_BIN:
+      rxFrames_++;
+      flushHeldDrive();
+      applyFastStop(FrameScanner::scanStopBinary(payload, length), micros());
+      // Stop seq: drive datagrams the server sent before the stop are stale even if late
+      if (udpToken_ && length >= Protocol::BIN_STOP_SEQ_LEN && payload[0] == Protocol::BIN_STOP) {
+        const uint32_t stopSeq = readLe32(payload + 1);
+        if ((int32_t)(stopSeq - udpSeq_) > 0) udpSeq_ = stopSeq;
+        udpHold_ = false;
+        udpFenced_ = true;
+      }
+      break;
     case WStype_PING:
       // lib sẽ tự PONG, không cần log
       break;
@@ -242,6 +576,21 @@ void NetClient::handleEvent(WStype_t type, uint8_t* payload, size_t length) {
   }
 }
 
+void NetClient::handleText(const uint8_t* payload, size_t length) {
+  heap_.noteFallback(HeapMonitor::Fallback::RX_STRING);
+  String msg;
+  msg.reserve(length + 1);
+  for (size_t i = 0; i < length; ++i) msg += (char)payload[i];
+  handleMessage(msg);
+}
+
+void NetClient::flushHeldDrive() {
+  if (!rxHeldLen_) return;
+  const size_t len = rxHeldLen_;
+  rxHeldLen_ = 0;
+  handleText(rxHeld_, len);
+}
+
 void NetClient::handleMessage(const String& payload) {
   StaticJsonDocument<512> doc;
   DeserializationError err = deserializeJson(doc, payload);
@@ -257,13 +606,54 @@ void NetClient::handleMessage(const String& payload) {
   }
 
   if (strcmp(kind, Protocol::CMD_HELLO) == 0) {
-    Serial.println("[NET] Server hello");
+    binTelemetry_ = TLM_BINARY && (doc["tlm"] | 0) >= 1;
+    tlm_.reset();
+    Serial.printf("[NET] Server hello (telemetry %s)\n", binTelemetry_ ? "binary" : "json");
+    return;
+  }
+
+  // Lease heartbeat: renews motion without a full drive command
+  if (strcmp(kind, Protocol::CMD_LEASE) == 0) {
+    const uint32_t ttl = doc["ttl"] | 0;
+    if (ttl) udpHold_ = false;
+    if (runner) runner->grantLease(ttl);
+    return;
+  }
+
+  // UDP drive channel accepted: datagrams must carry this token, seq restarts
+  if (strcmp(kind, Protocol::CMD_UDP) == 0) {
+    udpToken_ = UDP_DRIVE_PORT ? (doc["tok"] | 0u) : 0;
+    udpSeq_ = 0;
+    udpHold_ = false;
+    udpFenced_ = false;
+    Serial.printf("[NET] UDP drive channel %s\n", udpToken_ ? "on" : "off");
+    return;
+  }
+
+  if (strcmp(kind, Protocol::CMD_PROBE) == 0) {
+    link_.onProbeEcho(doc["id"] | 0, millis());
+    return;
+  }
+
+  if (strcmp(kind, Protocol::CMD_ENDPOINTS) == 0) {
+    handleEndpoints(doc);
+    return;
+  }
+
+  if (strcmp(kind, Protocol::CMD_POSE_RESET) == 0) {
+    if (runner) runner->resetPose();
+    PeriodicScheduler::instance().runNow(odomJob_);  // new pose out at once
     return;
   }
 
   // Legacy task protocol (kept for backward compatibility, but new system uses "drive" messages)
-  if (strcmp(kind, Protocol::CMD_TASK_REPLACE) == 0 || strcmp(kind, Protocol::CMD_TASK_ENQUEUE) == 0) {
-    // Try to extract wheels drive tasks and convert to simplified protocol
+  // Wheels tasks go through TaskRunner's bounded queue; free slots are advertised back
+  // to the server as the flow-control window with a cumulative ack of "seq".
+  const bool isReplace = strcmp(kind, Protocol::CMD_TASK_REPLACE) == 0;
+  if (isReplace || strcmp(kind, Protocol::CMD_TASK_ENQUEUE) == 0) {
+    const uint32_t seq = doc["seq"] | 0;
+    bool cleared = !isReplace;  // replace drops the wheels queue once it carries a wheels task
+    uint8_t dropped = 0;
     JsonArrayConst arr = doc["tasks"].as<JsonArrayConst>();
     for (JsonVariantConst item : arr) {
       if (!item.is<JsonObjectConst>()) continue;
@@ -273,11 +663,25 @@ void NetClient::handleMessage(const String& payload) {
         int left = obj["left"] | 0;
         int right = obj["right"] | 0;
         uint32_t dur = obj["durationMs"] | 0;
-        if (runner) {
-          ((TaskRunner*)runner)->handleDriveTask((int8_t)left, (int8_t)right, dur);
+        if (!cleared && runner) {
+          runner->clearTaskQueue();
+          cleared = true;
+        }
+        if (runner && !runner->enqueueDriveTask((int8_t)left, (int8_t)right, dur)) {
+          dropped++;
         }
       }
     }
+    if (dropped) {
+      Serial.printf("[NET] task queue full, dropped %u task(s) seq=%u\n", dropped, (unsigned)seq);
+      sendError("", String("Task queue full, dropped ") + dropped + " task(s) at seq " + seq);
+    }
+    noteRxSeq(seq);
+    return;
+  }
+
+  if (strcmp(kind, Protocol::CMD_TASK_GROUP) == 0) {
+    handleTaskGroup(doc);
     return;
   }
 
@@ -287,15 +691,26 @@ void NetClient::handleMessage(const String& payload) {
     if (strcmp(device.c_str(), Protocol::DEVICE_WHEELS) == 0 && runner) {
       runner->onDisconnected(); // Emergency stop wheels
     }
+    noteRxSeq(doc["seq"] | 0);
+    return;
+  }
+
+  if (strncmp(kind, "macro.", 6) == 0) {
+    handleMacro(kind, doc);
+    return;
+  }
+
+  if (strncmp(kind, "behavior.", 9) == 0) {
+    handleBehavior(kind, doc);
     return;
   }
 
   if (strcmp(kind, Protocol::CMD_PING) == 0) {
-    pongDoc_.clear();
-    pongDoc_["kind"] = Protocol::RESP_PONG;
-    pongDoc_["t"] = doc["t"] | (uint32_t)millis();
-    pongDoc_["seq"] = ++msgSeq_;
-    sendEnvelope(pongDoc_);
+    const uint32_t t = doc["t"] | (uint32_t)millis();
+    JsonWriter json = beginEnvelope(Protocol::RESP_PONG);
+    json.add("t", t);
+    json.add("seq", ++msgSeq_);
+    sendEnvelope(json);
     return;
   }
 
@@ -324,6 +739,7 @@ void NetClient::handleMessage(const String& payload) {
       dur = 60000;  // Cap at 60s
     }
     
+    if (left || right) udpHold_ = false;
     if (runner) {
       // Call new simplified TaskRunner interface
       ((TaskRunner*)runner)->handleDriveTask((int8_t)left, (int8_t)right, dur);
@@ -331,19 +747,462 @@ void NetClient::handleMessage(const String& payload) {
     return;
   }
 
+  // Twist (v mm/s, w mrad/s): mixed into wheel speeds on the ESP (TwistMixer)
+  if (strcmp(kind, Protocol::CMD_TWIST) == 0) {
+    if (!doc.containsKey("v") || !doc.containsKey("w")) {
+      sendError("", "Missing v/w fields in twist command");
+      return;
+    }
+    const long v = doc["v"];
+    const long w = doc["w"];
+    uint32_t dur = doc["durationMs"] | 0;
+    if (v < -10000 || v > 10000 || w < -30000 || w > 30000) {
+      Serial.printf("[NET] twist out of range: v=%ld w=%ld\n", v, w);
+      sendError("", "Twist values out of range");
+      return;
+    }
+    if (dur > 60000) dur = 60000;
+    if (v || w) udpHold_ = false;
+    if (runner) runner->handleTwist((int16_t)v, (int16_t)w, dur);
+    return;
+  }
+
   Serial.printf("[NET] Unknown kind=%s\n", kind);
   sendError("", String("Unknown command kind: ") + kind);
 }
 
 void NetClient::sendHello() {
-  helloDoc_.clear();
-  helloDoc_["kind"] = Protocol::CMD_HELLO;
-  helloDoc_["espId"] = String(ESP.getChipId(), HEX);
-  helloDoc_["fw"] = "robot-max-fw/1.0";
-  helloDoc_["rssi"] = WiFi.RSSI();
-  helloDoc_["ip"] = WiFi.localIP().toString();
-  helloDoc_["seq"] = ++msgSeq_;
-  sendEnvelope(helloDoc_);
+  // espId/ip formatted on the stack (was String(chipId, HEX) / IPAddress::toString())
+  char espId[9];
+  snprintf(espId, sizeof(espId), "%x", (unsigned)ESP.getChipId());
+  const IPAddress ipAddr = WiFi.localIP();
+  char ip[16];
+  snprintf(ip, sizeof(ip), "%u.%u.%u.%u", ipAddr[0], ipAddr[1], ipAddr[2], ipAddr[3]);
+
+  JsonWriter json = beginEnvelope(Protocol::CMD_HELLO);
+  json.add("espId", espId);
+  json.add("fw", "robot-max-fw/1.0");
+  json.add("rssi", WiFi.RSSI());
+  json.add("ip", ip);
+  lastAdvertisedWin_ = runner ? runner->freeTaskSlots() : TASK_QUEUE_CAPACITY;
+  json.add("win", lastAdvertisedWin_);
+  json.add("lease", LEASE_MAX_TTL_MS);
+  json.add("tlm", TLM_BINARY ? 1 : 0);
+  if (UDP_DRIVE_PORT) json.add("udp", UDP_DRIVE_PORT);
+  json.add("twist", ODOM_WHEEL_MM_S_MAX);  // twist supported; wheel rim speed at 100 %
+  // Resumption on this (possibly different) server: [last seq sent, last server task
+  // seq processed, live lease ms left], plus the endpoint index and list hash
+  const uint32_t leaseMs = runner ? runner->wheelsState().leaseRemaining(millis()) : 0;
+  json.beginArray("resume").item(msgSeq_).item(rxSeq_).item(leaseMs).endArray();
+  json.add("ep", endpoints_.active());
+  json.add("eph", endpoints_.hash());
+  // First hello after a reset: [reason, warm, boots, hw wdt, exception, soft wdt] + ms since boot
+  if (!resetReported_) {
+    RtcSnapshot& rtc = RtcSnapshot::instance();
+    const RtcSnapshot::State& st = rtc.state();
+    json.beginArray("rst")
+        .item(rtc.resetReason())
+        .item(rtc.warm() ? 1 : 0)
+        .item(st.boots)
+        .item(st.crashes[0])
+        .item(st.crashes[1])
+        .item(st.crashes[2])
+        .endArray();
+    json.add("boot", millis());
+    resetReported_ = true;
+  }
+  // Stored macro hashes by id (0 = empty) so the server uploads only what is missing
+  if (runner) {
+    json.beginArray("macros");
+    for (uint8_t id = 0; id < MACRO_SLOTS; ++id) {
+      json.item(runner->macros().hashOf(id));
+    }
+    json.endArray();
+  }
+  json.add("seq", ++msgSeq_);
+  sendEnvelope(json);
+}
+
+// Server list pushed by the server: replaces (and persists) the configured one
+void NetClient::handleEndpoints(JsonDocument& doc) {
+  const char* entries[EP_MAX];
+  uint8_t n = 0;
+  for (JsonVariantConst item : doc["eps"].as<JsonArrayConst>()) {
+    if (n == EP_MAX || !item.is<const char*>()) {
+      n = 0;  // too long or malformed: rejected whole
+      break;
+    }
+    entries[n++] = item.as<const char*>();
+  }
+  if (!endpoints_.set(entries, n)) sendError("", "Invalid endpoint list");
+}
+
+void NetClient::noteRxSeq(uint32_t seq) {
+  if (seq == 0) return;  // server without flow control
+  if (seq > rxSeq_) rxSeq_ = seq;
+  flowAckPending_ = true;
+}
+
+// One cumulative ack per batch: everything up to rxSeq_ is processed and `win`
+// queue slots are free. Also sent unprompted when the window re-opens.
+void NetClient::flushFlowAck(uint32_t now) {
+  if (rxSeq_ == 0 || !runner) return;
+  const uint8_t win = runner->freeTaskSlots();
+  if (!flowAckPending_ && win <= lastAdvertisedWin_) return;
+  if (now - lastFlowAckMs_ < FLOW_ACK_DELAY_MS) return;
+
+  JsonWriter json = beginEnvelope(Protocol::RESP_ACK);
+  json.add("ack", rxSeq_);
+  json.add("win", win);
+  json.add("seq", ++msgSeq_);
+  sendEnvelope(json);
+
+  flowAckPending_ = false;
+  lastAdvertisedWin_ = win;
+  lastFlowAckMs_ = now;
+}
+
+static int8_t hexNibble(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+void NetClient::handleMacro(const char* kind, JsonDocument& doc) {
+  if (!runner) return;
+  const int id = doc["id"] | -1;
+  if (id < 0 || id >= MACRO_SLOTS) {
+    sendError("", "Macro id out of range");
+    return;
+  }
+
+  if (strcmp(kind, Protocol::CMD_MACRO_RUN) == 0) {
+    const int scale = doc["scale"] | 100;
+    const bool mirror = doc["mirror"] | false;
+    if (!runner->runMacro((uint8_t)id, (uint8_t)constrain(scale, 0, 200), mirror)) {
+      sendError("", String("Macro not stored: ") + id);
+    }
+    return;
+  }
+
+  if (strcmp(kind, Protocol::CMD_MACRO_PUT) == 0) {
+    // data = hex-encoded MacroStep array, hash = FNV-1a over the decoded bytes
+    const char* hex = doc["data"] | "";
+    const uint32_t hash = doc["hash"] | 0u;
+    const size_t hexLen = strlen(hex);
+    uint8_t buf[MACRO_MAX_STEPS * sizeof(MacroStep)];
+    if (hexLen == 0 || (hexLen & 1) || hexLen / 2 > sizeof(buf)) {
+      sendError("", "Macro data size invalid");
+      return;
+    }
+    for (size_t i = 0; i < hexLen / 2; ++i) {
+      const int8_t hi = hexNibble(hex[2 * i]);
+      const int8_t lo = hexNibble(hex[2 * i + 1]);
+      if (hi < 0 || lo < 0) {
+        sendError("", "Macro data not hex");
+        return;
+      }
+      buf[i] = (uint8_t)((hi << 4) | lo);
+    }
+    if (!runner->macros().put((uint8_t)id, hash, buf, hexLen / 2)) {
+      sendError("", String("Macro store failed: ") + id);
+      return;
+    }
+    JsonWriter json = beginEnvelope(Protocol::RESP_ACK);
+    json.add("macro", id);
+    json.add("hash", hash);
+    json.add("seq", ++msgSeq_);
+    sendEnvelope(json);
+    return;
+  }
+
+  if (strcmp(kind, Protocol::CMD_MACRO_DEL) == 0) {
+    runner->macros().remove((uint8_t)id);
+    return;
+  }
+
+  sendError("", String("Unknown command kind: ") + kind);
+}
+
+// task.group: {grp, at | in, tasks[]} — at = device millis(), in = ms from receipt
+// (server without a clock offset estimate yet). One task per device; held in
+// TaskRunner and started in one control tick, reported back as a `group` envelope.
+void NetClient::handleTaskGroup(JsonDocument& doc) {
+  if (!runner) return;
+  TaskGroup g{};
+  g.id = doc["grp"] | 0;
+  g.atMs = doc.containsKey("at") ? (doc["at"] | 0u) : millis() + (doc["in"] | 0u);
+  JsonArrayConst arr = doc["tasks"].as<JsonArrayConst>();
+  for (JsonVariantConst item : arr) {
+    if (!item.is<JsonObjectConst>()) continue;
+    JsonObjectConst obj = item.as<JsonObjectConst>();
+    const char* device = obj["device"] | "";
+    if (strcmp(device, Protocol::DEVICE_WHEELS) == 0) {
+      g.members |= TaskGroup::WHEELS;
+      g.left = (int8_t)constrain(obj["left"] | 0, -100, 100);
+      g.right = (int8_t)constrain(obj["right"] | 0, -100, 100);
+      g.wheelsMs = obj["durationMs"] | 0;
+    } else if (strcmp(device, Protocol::DEVICE_ARM) == 0) {
+      g.members |= TaskGroup::ARM;
+      g.armAngle = obj["angle"] | 0;
+      g.armMs = obj["durationMs"] | 0;
+    } else if (strcmp(device, Protocol::DEVICE_NECK) == 0) {
+      g.members |= TaskGroup::NECK;
+      g.neckAngle = obj["angle"] | 0;
+      g.neckMs = obj["durationMs"] | 0;
+    }
+  }
+  if (!runner->scheduleGroup(g)) {
+    Serial.printf("[NET] task.group %u rejected (members=0x%02x)\n", g.id, g.members);
+    sendError("", String("Task group rejected: ") + g.id);
+  }
+}
+
+void NetClient::pollGroupReport() {
+  GroupReport r;
+  if (!runner || !runner->takeGroupReport(r)) return;
+  Serial.printf("[NET] group %u started late=%ldms skew=%luus span=%luus\n", r.id, (long)r.lateMs,
+                (unsigned long)r.skewUs, (unsigned long)r.spanUs);
+  JsonWriter json = beginEnvelope(Protocol::RESP_GROUP);
+  json.add("id", r.id);
+  json.add("n", (uint8_t)__builtin_popcount(r.members));
+  json.add("late", r.lateMs);
+  json.add("skew", r.skewUs);
+  json.add("span", r.spanUs);
+  json.add("seq", ++msgSeq_);
+  sendEnvelope(json);
+}
+
+// behavior.load: {code, hash, run} — code = hex bytecode, hash = FNV-1a over the
+// decoded bytes. Verified before it replaces the loaded program; a rejected program
+// comes back as an error with the verifier's reason and offset.
+void NetClient::handleBehavior(const char* kind, JsonDocument& doc) {
+  if (!runner) return;
+  if (strcmp(kind, Protocol::CMD_BEHAVIOR_STOP) == 0) {
+    runner->stopBehavior();
+    return;
+  }
+  if (strcmp(kind, Protocol::CMD_BEHAVIOR_LOAD) != 0) {
+    sendError("", String("Unknown command kind: ") + kind);
+    return;
+  }
+
+  const char* hex = doc["code"] | "";
+  const uint32_t hash = doc["hash"] | 0u;
+  const size_t hexLen = strlen(hex);
+  uint8_t buf[BEH_CODE_MAX];
+  if (hexLen == 0 || (hexLen & 1) || hexLen / 2 > sizeof(buf)) {
+    sendError("", "Behavior code size invalid");
+    return;
+  }
+  for (size_t i = 0; i < hexLen / 2; ++i) {
+    const int8_t hi = hexNibble(hex[2 * i]);
+    const int8_t lo = hexNibble(hex[2 * i + 1]);
+    if (hi < 0 || lo < 0) {
+      sendError("", "Behavior code not hex");
+      return;
+    }
+    buf[i] = (uint8_t)((hi << 4) | lo);
+  }
+  if (MacroStore::fnv1a(buf, hexLen / 2) != hash) {
+    sendError("", "Behavior code hash mismatch");
+    return;
+  }
+  uint16_t errPc = 0;
+  const BehaviorVm::Error err = runner->loadBehavior(buf, hexLen / 2, doc["run"] | true, errPc);
+  if (err != BehaviorVm::OK) {
+    Serial.printf("[NET] behavior rejected: %s at pc=%u\n", BehaviorVm::errorName(err), errPc);
+    sendError("", String("Behavior rejected: ") + BehaviorVm::errorName(err) + " at pc " + errPc);
+  }
+}
+
+void NetClient::pollBehaviorReport() {
+  BehaviorReport r;
+  if (!runner || !runner->takeBehaviorReport(r)) return;
+  JsonWriter json = beginEnvelope(Protocol::RESP_BEHAVIOR);
+  json.add("st", BehaviorVm::stateName(r.state));
+  if (r.error) json.add("err", BehaviorVm::errorName(r.error));
+  json.add("pc", r.pc);
+  json.add("size", r.size);
+  json.add("n", r.ticks);
+  json.add("insns", r.insns);
+  json.add("ipt", r.maxInsns);
+  json.add("us", r.maxTickUs);
+  json.add("seq", ++msgSeq_);
+  sendEnvelope(json);
+}
+
+void NetClient::sendStats() {
+  if (!canSendTelemetry()) {
+    heap_.deferReport();
+    return;
+  }
+  const IdleGovernor::Report pwr = runner ? runner->takePowerReport() : IdleGovernor::Report{};
+  if (binTelemetry_) {
+    int32_t rec[TelemetryEncoder::STATS_FIELDS] = {
+        (int32_t)heap_.freeHeap(), (int32_t)heap_.minFreeHeap(), (int32_t)heap_.maxBlock(),
+        (int32_t)heap_.minMaxBlock(), heap_.fragmentation(), heap_.maxFragmentation(), heap_.alerts(),
+        (int32_t)heap_.fallbackCount(HeapMonitor::Fallback::TX_DROPPED),
+        (int32_t)heap_.fallbackCount(HeapMonitor::Fallback::RX_STRING)};
+    if (runner) {
+      rec[9] = (int32_t)runner->coroutines().resumes();
+      rec[10] = (int32_t)runner->coroutines().avgResumeUs();
+      rec[11] = (int32_t)runner->coroutines().maxResumeUs();
+      rec[12] = runner->rate().hzX10();
+      rec[13] = runner->rate().framesPerSec();
+      rec[14] = runner->rate().dutyPermille();
+    }
+    rec[15] = stopLat_.count;
+    rec[16] = (int32_t)stopLat_.lastUs;
+    rec[17] = (int32_t)stopLat_.maxUs;
+    rec[18] = (int32_t)stopLat_.pollGapMaxUs;
+    rec[19] = (int32_t)rxFrames_;
+    rec[20] = (int32_t)rxElided_;
+    rec[21] = (int32_t)udpRx_;
+    rec[22] = (int32_t)udpDropped_;
+    rec[23] = pwr.sleepPermille;
+    rec[24] = (int32_t)pwr.entries;
+    rec[25] = (int32_t)pwr.maxSleepUs;
+    rec[26] = (int32_t)pwr.maxOverrunUs;
+    rec[27] = (int32_t)(millis() / 1000);
+    if (sendTelemetry(TelemetryEncoder::STATS, rec)) {
+      stopLat_.pollGapMaxUs = 0;
+      return;
+    }
+  }
+  JsonWriter json = beginEnvelope(Protocol::RESP_STATS);
+  json.add("heap", heap_.freeHeap());
+  json.add("heapMin", heap_.minFreeHeap());
+  json.add("blk", heap_.maxBlock());
+  json.add("blkMin", heap_.minMaxBlock());
+  json.add("frag", heap_.fragmentation());
+  json.add("fragMax", heap_.maxFragmentation());
+  json.add("alert", heap_.alerts());
+  // Fallback-path counters: [tx envelopes dropped, rx String copies]
+  json.beginArray("fb")
+      .item(heap_.fallbackCount(HeapMonitor::Fallback::TX_DROPPED))
+      .item(heap_.fallbackCount(HeapMonitor::Fallback::RX_STRING))
+      .endArray();
+  // Coroutine scheduling overhead: [resumes, avg us, max us]
+  if (runner) {
+    json.beginArray("co")
+        .item(runner->coroutines().resumes())
+        .item(runner->coroutines().avgResumeUs())
+        .item(runner->coroutines().maxResumeUs())
+        .endArray();
+    // Device tick governor: [achieved Hz x10, bus frames/s, bus duty permille]
+    json.beginArray("rate")
+        .item(runner->rate().hzX10())
+        .item(runner->rate().framesPerSec())
+        .item(runner->rate().dutyPermille())
+        .endArray();
+  }
+  // Stop fast path: [count, last us, max us, max receive-poll gap us since last report]
+  json.beginArray("stop")
+      .item(stopLat_.count)
+      .item(stopLat_.lastUs)
+      .item(stopLat_.maxUs)
+      .item(stopLat_.pollGapMaxUs)
+      .endArray();
+  stopLat_.pollGapMaxUs = 0;
+  // Receive path: [frames, drive frames elided unparsed, UDP datagrams applied, UDP dropped]
+  json.beginArray("rx").item(rxFrames_).item(rxElided_).item(udpRx_).item(udpDropped_).endArray();
+  // Power-aware idle since last report: [asleep permille, idle entries, max sleep us, max overrun us]
+  json.beginArray("pwr")
+      .item(pwr.sleepPermille)
+      .item(pwr.entries)
+      .item(pwr.maxSleepUs)
+      .item(pwr.maxOverrunUs)
+      .endArray();
+  json.add("up", millis() / 1000);
+  json.add("seq", ++msgSeq_);
+  sendEnvelope(json);
+}
+
+// Link job (LINK_SAMPLE_MS). Probes and link reports are control traffic: outside
+// the telemetry budget
+void NetClient::pollLink(uint32_t now) {
+  link_.poll(now);
+  // No probes while idle: the RTT would measure our sleep, not the link
+  if (link_.probeDue() && !(runner && runner->powerIdle())) {
+    JsonWriter json = beginEnvelope(Protocol::RESP_PROBE);
+    json.add("id", link_.startProbe(now));
+    json.add("t", now);  // lets the server estimate our clock offset (task.group `at`)
+    sendEnvelope(json);
+  }
+  if (!link_.reportDue(now)) return;
+  // q = grade (0 good, 1 fair, 2 poor), hz = advised drive command rate, tlm = our telemetry msgs/s
+  JsonWriter json = beginEnvelope(Protocol::RESP_LINK);
+  json.add("q", (uint8_t)link_.grade());
+  json.add("rssi", link_.rssi());
+  json.add("rtt", link_.rttMs());
+  json.add("lost", link_.probesLost());
+  json.add("txf", link_.txFails());
+  json.add("hz", link_.cmdHz());
+  json.add("tlm", link_.telemetryPerSec());
+  json.add("mode", link_.payloadMode());
+  json.add("seq", ++msgSeq_);
+  sendEnvelope(json);
+}
+
+// ODOM_STREAM_MS while moving (plus one report once stopped), ODOM_IDLE_STREAM_MS
+// otherwise, both stretched on a weaker link
+uint32_t NetClient::odomPeriodMs() const {
+  const bool moving = runner && (runner->odometry().vMmS() != 0 || runner->odometry().wMradS() != 0);
+  return ((moving || odomMoving_) ? ODOM_STREAM_MS : ODOM_IDLE_STREAM_MS) * link_.odomPeriodMul();
+}
+
+// Odom job (period from odomPeriodMs())
+void NetClient::pollOdometry(uint32_t now) {
+  if (!runner) return;
+  if (!canSendTelemetry()) return;  // budget spent: this release is dropped
+  const Odometry& odom = runner->odometry();
+  odomMoving_ = odom.vMmS() != 0 || odom.wMradS() != 0;
+
+  if (binTelemetry_) {
+    const WheelsDevice& w = runner->wheelsState();
+    const int32_t wheels[TelemetryEncoder::WHEELS_FIELDS] = {
+        w.targetPctL(), w.targetPctR(), w.appliedPctL(), w.appliedPctR()};
+    const int32_t pose[TelemetryEncoder::POSE_FIELDS] = {
+        odom.xMm(), odom.yMm(), odom.headingCdeg(), odom.vMmS(), odom.wMradS(), odom.epoch(), (int32_t)now};
+    tlm_.beginFrame(reinterpret_cast<uint8_t*>(txBuffer_), TX_BUFFER_SIZE);
+    if (link_.grade() == LinkMonitor::GOOD) tlm_.add(TelemetryEncoder::WHEELS, wheels);  // lean: pose only
+    tlm_.add(TelemetryEncoder::POSE, pose);
+    sendTelemetryFrame();
+    return;
+  }
+
+  // x/y mm, th centidegrees (0..35999, CCW), v mm/s, w mrad/s, ep = reset epoch
+  JsonWriter json = beginEnvelope(Protocol::RESP_ODOM);
+  json.add("x", odom.xMm());
+  json.add("y", odom.yMm());
+  json.add("th", odom.headingCdeg());
+  json.add("v", odom.vMmS());
+  json.add("w", odom.wMradS());
+  json.add("ep", odom.epoch());
+  json.add("t", now);
+  json.add("seq", ++msgSeq_);
+  sendEnvelope(json);
+}
+
+// One record in its own frame; false = binary telemetry off (caller sends JSON)
+bool NetClient::sendTelemetry(TelemetryEncoder::Type type, const int32_t* fields, const char* text) {
+  if (!binTelemetry_) return false;
+  tlm_.beginFrame(reinterpret_cast<uint8_t*>(txBuffer_), TX_BUFFER_SIZE);
+  tlm_.add(type, fields, text);
+  sendTelemetryFrame();
+  return true;
+}
+
+void NetClient::sendTelemetryFrame() {
+  const size_t len = tlm_.length();
+  if (!len || !connected) return;
+  if (ws.getConnectionState() != WStype_CONNECTED) {
+    connected = false;
+    return;
+  }
+  if (!ws.sendBIN(reinterpret_cast<uint8_t*>(txBuffer_), len)) link_.noteTxFail();
 }
 
 bool NetClient::canSendTelemetry() {
@@ -353,15 +1212,31 @@ bool NetClient::canSendTelemetry() {
     telemetryCount_ = 0;
     lastTelemetryMs_ = now;
   }
-  // Limit to 10 messages per second
-  if (telemetryCount_ >= 10) {
+  // Budget per second follows the link grade (10 on a good link)
+  if (telemetryCount_ >= link_.telemetryPerSec()) {
     return false;
   }
   telemetryCount_++;
   return true;
 }
 
-void NetClient::sendEnvelope(JsonDocument& doc) {
+// Task lifecycle (ack/done) and errors are never held back: the server has to learn
+// how every task ended, however poor the link. They still take a slot of the window
+// while one is left, so odom/stats/progress back off behind them.
+void NetClient::chargeTelemetry() {
+  canSendTelemetry();
+}
+
+// Outbound envelopes are written member by member straight into txBuffer_
+JsonWriter NetClient::beginEnvelope(const char* kind) {
+  JsonWriter json(txBuffer_, TX_BUFFER_SIZE);
+  json.beginObject();
+  json.add("kind", kind);
+  return json;
+}
+
+void NetClient::sendEnvelope(JsonWriter& json) {
+  json.endObject();
   if (!connected) return;
   // Double-check WebSocket connection state before sending
   // getConnectionState() returns WStype_CONNECTED when connected
@@ -369,14 +1244,11 @@ void NetClient::sendEnvelope(JsonDocument& doc) {
     connected = false;
     return;
   }
-  // Use pre-allocated char buffer instead of String to reduce heap usage
-  size_t len = serializeJson(doc, jsonBuffer_, JSON_BUFFER_SIZE);
-  if (len > 0 && len < JSON_BUFFER_SIZE) {
-    ws.sendTXT(jsonBuffer_, len);
-  } else {
-    // Fallback to String if buffer too small (shouldn't happen with current message sizes)
-    String buffer;
-    serializeJson(doc, buffer);
-    ws.sendTXT(buffer);
+  if (!json.ok()) {
+    // Only free-text fields (error message, task id) can get here: drop, never send partial JSON
+    heap_.noteFallback(HeapMonitor::Fallback::TX_DROPPED);
+    Serial.println("[NET] envelope too large for tx buffer, dropped");
+    return;
   }
+  if (!ws.sendTXT(txBuffer_, json.length())) link_.noteTxFail();
 }
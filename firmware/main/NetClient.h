@@ -4,8 +4,15 @@
 #include <Arduino.h>
 #include <ArduinoJson.h>
 #include <WebSocketsClient.h>
+#include <WiFiUdp.h>
 
 #include "Config.h"
+#include "EndpointList.h"
+#include "HeapMonitor.h"
+#include "JsonWriter.h"
+#include "LinkMonitor.h"
+#include "FrameScanner.h"
+#include "TelemetryEncoder.h"
 #include "TaskTypes.h"
 
 class TaskRunner;
@@ -47,6 +54,9 @@ class NetClient {
   void sendDone(const String& taskId);
   void sendError(const String& taskId, const String& message);
 
+  // Short network deadline pending (keeps TaskRunner out of its idle sleep)
+  bool idleBlocked() const { return flowAckPending_; }
+
  private:
   // ==== WS state ====
   WebSocketsClient ws;
@@ -54,27 +64,98 @@ class NetClient {
   bool connected;
   uint32_t lastConnectAttempt;
   uint32_t reconnectDelay;
+
+  // Server list + health probes. A lost session moves to the best healthy endpoint
+  // at once (no backoff); a failed attempt tries the next one after the backoff.
+  EndpointList endpoints_;
+  bool attemptPending_ = false;  // ws.begin() issued, no session yet
   
   // Wi-Fi non-blocking connection state
   bool wifiConnecting_;
   uint32_t lastWifiCheckMs_;
+
+  // Warm start (RtcSnapshot): rejoin the last BSSID/channel with a static IP, polled
+  // fast; falls back to scan + DHCP on failure. The reset cause goes out in the first hello.
+  bool warmWifi_ = false;
+  uint32_t warmWifiStartMs_ = 0;
+  bool resetReported_ = false;
+
+  // PeriodicScheduler jobs (Wi-Fi check period follows the warm/normal rejoin, odom
+  // period follows motion and link grade)
+  int8_t wifiJob_ = -1;
+  int8_t linkJob_ = -1;
+  int8_t odomJob_ = -1;
+  uint8_t schedReportNext_ = 0;  // rank of the first job in the next "sched" report
+  static void wifiThunk(void* ctx, uint32_t now);
+  static void probeThunk(void* ctx, uint32_t now);
+  static void linkThunk(void* ctx, uint32_t now);
+  static void odomThunk(void* ctx, uint32_t now);
+  static void heapThunk(void* ctx, uint32_t now);
+  static void snapshotThunk(void* ctx, uint32_t now);
+  static void schedReportThunk(void* ctx, uint32_t now);
   
   // Message sequencing and rate limiting
   uint32_t msgSeq_;
   uint32_t lastTelemetryMs_;
   uint32_t telemetryCount_;
+
+  // Task stream flow control: cumulative ack of server seq + free queue slots
+  uint32_t rxSeq_;             // highest server seq processed
+  bool flowAckPending_;
+  uint32_t lastFlowAckMs_;
+  uint8_t lastAdvertisedWin_;
   
-  // Reusable JSON buffers (preallocated to reduce heap churn)
-  StaticJsonDocument<384> helloDoc_;
-  StaticJsonDocument<256> ackDoc_;
-  StaticJsonDocument<256> progressDoc_;
-  StaticJsonDocument<256> doneDoc_;
-  StaticJsonDocument<384> errorDoc_;
-  StaticJsonDocument<96> pongDoc_;
+  // Odometry stream: ODOM_STREAM_MS while moving (plus one report once stopped),
+  // ODOM_IDLE_STREAM_MS heartbeat otherwise; sent at once after pose.reset
+  bool odomMoving_;
+
+  // Binary telemetry (server hello tlm >= 1): progress, wheel state, pose and
+  // stats go out as delta records instead of JSON; reset per connection
+  bool binTelemetry_;
+  TelemetryEncoder tlm_;
+
+  // Heap/fragmentation telemetry (periodic "stats" envelope + alerts)
+  HeapMonitor heap_;
+
+  // Link quality (RSSI, probe RTT/loss, send failures): sets the telemetry budget
+  // and odom period here, advertised to the server as a "link" envelope
+  LinkMonitor link_;
+
+  // Stop fast-path latency (us). handling = scan + STOP frame; pollGapMax bounds how
+  // long a frame can sit behind the main loop (e.g. an in-flight bus frame) before
+  // ws.loop() reads it. Worst-case stop latency <= pollGapMax + maxUs.
+  struct StopLatency {
+    uint16_t count;
+    uint32_t lastUs;
+    uint32_t maxUs;
+    uint32_t pollGapMaxUs;  // reset after each stats report
+  };
+  StopLatency stopLat_;
+  uint32_t lastPollUs_;
+
+  // Superseded-frame elision: while a burst is drained, the newest last-wins drive
+  // frame is held here; an older one is dropped unparsed. Any other frame flushes
+  // the held one first, so relative order with enqueue/cancel is unchanged.
+  uint8_t rxHeld_[RX_HOLD_BYTES];
+  size_t rxHeldLen_;
+  uint32_t rxFrames_;   // frames received (text + binary)
+  uint32_t rxElided_;   // drive frames dropped unparsed
+
+  // UDP drive channel (UDP_DRIVE_PORT): on for this session once the server's `udp`
+  // envelope hands out a token. Drive/stop datagrams skip TCP head-of-line blocking;
+  // per loop() only the newest seq is applied, older/foreign ones are dropped.
+  WiFiUDP udp_;
+  uint32_t udpToken_;   // 0 = channel off
+  uint32_t udpSeq_;     // last applied seq
+  uint32_t udpRx_;      // datagrams applied
+  uint32_t udpDropped_; // stale, superseded in a burst, foreign token, malformed or held
+  bool udpHold_;        // WS stop without a stop seq: drive datagrams ignored until new WS drive intent
+  bool udpFenced_;      // udpSeq_ raised to the server's stop seq since the last applied drive datagram
   
-  // Shared char buffer for JSON serialization (avoids String heap allocation)
-  static constexpr size_t JSON_BUFFER_SIZE = 512;
-  char jsonBuffer_[JSON_BUFFER_SIZE];
+  // Shared transmit buffer: every outbound envelope (JsonWriter) and binary
+  // telemetry frame is built here, one at a time; no per-message documents
+  static constexpr size_t TX_BUFFER_SIZE = 512;
+  char txBuffer_[TX_BUFFER_SIZE];
 
   // Static trampoline vì WebSocketsClient callback là C-style function ptr
   static NetClient* s_instance;
@@ -83,9 +164,36 @@ class NetClient {
   // ==== Internal helpers ====
   void connect();
   void scheduleReconnect();
+  bool failover();
+  void pollEndpoints(uint32_t now);
+  void handleEndpoints(JsonDocument& doc);
+  void beginWifi();
+  void onWifiConnected();
+  void pollWifi(uint32_t now);
+  void saveSnapshot();
+  void sendSchedReport();
   void handleEvent(WStype_t type, uint8_t* payload, size_t length);
   void handleMessage(const String& payload);
+  void handleText(const uint8_t* payload, size_t length);
+  void flushHeldDrive();
+  void applyFastStop(FrameScanner::Stop stop, uint32_t startUs);
+  void pollUdp();
   void sendHello();
-  void sendEnvelope(JsonDocument& doc);
+  void sendStats();
+  uint32_t odomPeriodMs() const;
+  void pollOdometry(uint32_t now);
+  void pollLink(uint32_t now);
+  void handleMacro(const char* kind, JsonDocument& doc);
+  void handleTaskGroup(JsonDocument& doc);
+  void pollGroupReport();
+  void handleBehavior(const char* kind, JsonDocument& doc);
+  void pollBehaviorReport();
+  void noteRxSeq(uint32_t seq);
+  void flushFlowAck(uint32_t now);
+  JsonWriter beginEnvelope(const char* kind);
+  void sendEnvelope(JsonWriter& json);  // closes the object and sends it
+  bool sendTelemetry(TelemetryEncoder::Type type, const int32_t* fields, const char* text = nullptr);
+  void sendTelemetryFrame();
   bool canSendTelemetry();
+  void chargeTelemetry();
 };
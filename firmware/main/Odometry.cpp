@@ -0,0 +1,40 @@
+// firmware/src/Odometry.cpp
+#include "Odometry.h"
+
+// sin(i * 90deg / 64) in Q15, i = 0..64
+static const int16_t kQuarterSine[65] = {
+    0, 804, 1608, 2410, 3212, 4011, 4808, 5602, 6393,
+    7179, 7962, 8739, 9512, 10278, 11039, 11793, 12539, 13279,
+    14010, 14732, 15446, 16151, 16846, 17530, 18204, 18868, 19519,
+    20159, 20787, 21403, 22005, 22594, 23170, 23731, 24279, 24811,
+    25329, 25832, 26319, 26790, 27245, 27683, 28105, 28510, 28898,
+    29268, 29621, 29956, 30273, 30571, 30852, 31113, 31356, 31580,
+    31785, 31971, 32137, 32285, 32412, 32521, 32609, 32678, 32728,
+    32757, 32767};
+
+int16_t Odometry::sinQ15(uint16_t bam) {
+  const uint8_t quadrant = bam >> 14;
+  uint16_t f = bam & 0x3FFF;
+  if (quadrant & 1) f = 16384 - f;  // mirror: 2nd/4th quadrant
+  const uint8_t i = f >> 8;
+  const uint8_t frac = f & 0xFF;
+  int32_t s = kQuarterSine[i];
+  if (frac) s += ((int32_t)(kQuarterSine[i + 1] - kQuarterSine[i]) * frac) >> 8;
+  return (int16_t)((quadrant & 2) ? -s : s);
+}
+
+void Odometry::integrate(int16_t vL, int16_t vR, uint32_t dtMs) {
+  v_ = (int16_t)(((int32_t)vL + vR) / 2);
+  w_ = (int16_t)(((int32_t)vR - vL) * 1000 / ODOM_TRACK_MM);
+  if (dtMs == 0 || (vL == 0 && vR == 0)) return;
+
+  // mm/s * ms = um travelled by the wheel centre
+  const int64_t dsUm = ((int64_t)vL + vR) * dtMs / 2;
+  // (vR - vL) * dt / track [rad] -> binary angle << 16: * 2^32 / 2pi
+  const int64_t dHeading = ((int64_t)vR - vL) * dtMs * 4294967296LL / (6283LL * ODOM_TRACK_MM);
+  const uint16_t mid = (heading_ + (uint32_t)(dHeading / 2)) >> 16;
+
+  xUm_ += (int32_t)((dsUm * cosQ15(mid)) >> 15);
+  yUm_ += (int32_t)((dsUm * sinQ15(mid)) >> 15);
+  heading_ += (uint32_t)dHeading;
+}
@@ -0,0 +1,50 @@
+// firmware/src/Odometry.h
+#pragma once
+#include <Arduino.h>
+#include "Config.h"
+
+// Dead-reckoning pose from the wheel speeds actually applied on the bus.
+// Fixed point throughout: position in micrometres (int32, ±2 km), heading as a
+// 16-bit binary angle (65536 = one turn, wraps for free) carried with 16 more
+// fraction bits so short ticks don't truncate away slow turns, sin/cos from a
+// quarter-wave Q15 table. Integration uses the midpoint heading of each step.
+class Odometry {
+public:
+  void reset() {
+    xUm_ = yUm_ = 0;
+    heading_ = 0;
+    epoch_++;
+  }
+
+  // Warm start: resume the pose saved before a crash (same epoch, so the server
+  // sees a continuing track)
+  void restore(int32_t xMm, int32_t yMm, uint16_t headingBam, uint16_t epoch) {
+    xUm_ = xMm * 1000;
+    yUm_ = yMm * 1000;
+    heading_ = (uint32_t)headingBam << 16;
+    epoch_ = epoch;
+  }
+
+  // vL/vR: wheel rim speeds in mm/s, held for dtMs
+  void integrate(int16_t vL, int16_t vR, uint32_t dtMs);
+
+  int32_t xMm() const { return xUm_ / 1000; }
+  int32_t yMm() const { return yUm_ / 1000; }
+  uint16_t headingBam() const { return heading_ >> 16; }
+  uint16_t headingCdeg() const { return (uint16_t)(((uint32_t)headingBam() * 36000u) >> 16); }  // 0..35999
+  int16_t vMmS() const { return v_; }     // body forward speed
+  int16_t wMradS() const { return w_; }   // body yaw rate, CCW positive
+  uint16_t epoch() const { return epoch_; }  // bumped by reset()
+
+  // Q15 sine/cosine of a binary angle (pure)
+  static int16_t sinQ15(uint16_t bam);
+  static int16_t cosQ15(uint16_t bam) { return sinQ15(bam + 16384); }
+
+private:
+  int32_t xUm_ = 0;
+  int32_t yUm_ = 0;
+  uint32_t heading_ = 0;  // binary angle << 16
+  int16_t v_ = 0;
+  int16_t w_ = 0;
+  uint16_t epoch_ = 0;
+};
@@ -0,0 +1,117 @@
+// firmware/src/PeriodicScheduler.cpp
+#include "PeriodicScheduler.h"
+
+PeriodicScheduler& PeriodicScheduler::instance() {
+  static PeriodicScheduler scheduler;
+  return scheduler;
+}
+
+int8_t PeriodicScheduler::add(const char* name, uint32_t periodMs, uint8_t priority, uint32_t budgetUs, Job job,
+                              void* ctx) {
+  if (count_ >= SCHED_SLOTS || !job || !periodMs) return -1;
+  const uint8_t id = count_;
+  Slot& slot = slots_[id];
+  slot.job = job;
+  slot.ctx = ctx;
+  slot.periodUs = periodMs * 1000;
+  slot.nextUs = micros() + slot.periodUs;
+  slot.priority = priority;
+  slot.stats = Stats{};
+  slot.stats.name = name;
+  slot.stats.periodMs = periodMs;
+  slot.stats.budgetUs = budgetUs;
+
+  // Insertion into the priority order (stable: equal priority keeps registration order)
+  uint8_t pos = count_;
+  while (pos > 0 && slots_[order_[pos - 1]].priority > priority) {
+    order_[pos] = order_[pos - 1];
+    --pos;
+  }
+  order_[pos] = id;
+  count_++;
+  return (int8_t)id;
+}
+
+void PeriodicScheduler::setPeriod(int8_t id, uint32_t periodMs) {
+  if (id < 0 || id >= count_ || !periodMs) return;
+  Slot& slot = slots_[id];
+  const uint32_t periodUs = periodMs * 1000;
+  if (periodUs == slot.periodUs) return;
+  slot.nextUs = slot.nextUs - slot.periodUs + periodUs;
+  slot.periodUs = periodUs;
+  slot.stats.periodMs = periodMs;
+}
+
+void PeriodicScheduler::runNow(int8_t id) {
+  if (id < 0 || id >= count_) return;
+  Slot& slot = slots_[id];
+  const uint32_t nowUs = micros();
+  if ((int32_t)(nowUs - slot.nextUs) >= 0) {
+    release(slot, nowUs);
+    return;
+  }
+  slot.job(slot.ctx, millis());
+}
+
+void PeriodicScheduler::run() {
+  for (uint8_t i = 0; i < count_; ++i) {
+    Slot& slot = slots_[order_[i]];
+    const uint32_t nowUs = micros();
+    if ((int32_t)(nowUs - slot.nextUs) >= 0) release(slot, nowUs);
+  }
+}
+
+void PeriodicScheduler::release(Slot& slot, uint32_t startUs) {
+  const uint32_t releaseUs = slot.nextUs;
+  // Stay on the grid; whole periods already gone are skipped, not caught up
+  slot.nextUs += slot.periodUs;
+  const uint32_t behindUs = startUs - releaseUs;
+  if (behindUs >= slot.periodUs) {
+    const uint32_t missed = behindUs / slot.periodUs;
+    slot.nextUs += missed * slot.periodUs;
+    slot.stats.skipped += missed;
+  }
+
+  slot.job(slot.ctx, millis());
+  const uint32_t runUs = micros() - startUs;
+
+  Stats& st = slot.stats;
+  st.runs++;
+  const uint32_t lateUs = behindUs % slot.periodUs;
+  if (st.late[bucket(lateUs)] < 0xFFFF) st.late[bucket(lateUs)]++;
+  if (lateUs > st.maxLateUs) st.maxLateUs = lateUs;
+  if (runUs > st.maxRunUs) st.maxRunUs = runUs;
+  if (st.budgetUs && runUs > st.budgetUs) {
+    const uint8_t b = bucket(runUs - st.budgetUs);
+    if (st.over[b] < 0xFFFF) st.over[b]++;
+  }
+}
+
+uint32_t PeriodicScheduler::msUntilNext() const {
+  if (!count_) return UINT32_MAX;
+  const uint32_t nowUs = micros();
+  int32_t soonestUs = INT32_MAX;
+  for (uint8_t i = 0; i < count_; ++i) {
+    const int32_t dueInUs = (int32_t)(slots_[i].nextUs - nowUs);
+    if (dueInUs < soonestUs) soonestUs = dueInUs;
+  }
+  return soonestUs > 0 ? (uint32_t)soonestUs / 1000 : 0;
+}
+
+void PeriodicScheduler::resetStats(uint8_t i) {
+  if (i >= count_) return;
+  Stats& st = slots_[order_[i]].stats;
+  st.runs = st.skipped = st.maxLateUs = st.maxRunUs = 0;
+  memset(st.late, 0, sizeof(st.late));
+  memset(st.over, 0, sizeof(st.over));
+}
+
+uint8_t PeriodicScheduler::bucket(uint32_t us) {
+  uint8_t b = 0;
+  uint32_t limit = SCHED_HIST_BASE_US;
+  while (b < HIST_BUCKETS - 1 && us >= limit) {
+    ++b;
+    limit <<= 1;
+  }
+  return b;
+}
@@ -0,0 +1,72 @@
+// firmware/src/PeriodicScheduler.h
+#pragma once
+#include <Arduino.h>
+#include "Config.h"
+
+// Fixed-rate cooperative scheduler for the periodic jobs of the main loop. Releases
+// are on a fixed grid (next += period), so a late pass does not shift the phase of
+// the following ones; releases missed entirely are skipped (counted), not replayed
+// as a burst. Due jobs run once per pass in priority order (0 = first).
+//
+// Per job and report window: lateness (release -> start) and overrun (run time past
+// the job's budget) as log2 histograms, bucket i < SCHED_HIST_BASE_US << i, the last
+// one open-ended.
+class PeriodicScheduler {
+public:
+  using Job = void (*)(void* ctx, uint32_t now);  // now = millis()
+  static constexpr uint8_t HIST_BUCKETS = 8;
+
+  struct Stats {
+    const char* name;
+    uint32_t periodMs;
+    uint32_t budgetUs;
+    uint32_t runs;
+    uint32_t skipped;      // releases missed entirely
+    uint32_t maxLateUs;
+    uint32_t maxRunUs;
+    uint16_t late[HIST_BUCKETS];
+    uint16_t over[HIST_BUCKETS];  // only runs over budget
+  };
+
+  static PeriodicScheduler& instance();
+
+  // Returns the job id, or -1 when all SCHED_SLOTS are taken. First release one
+  // period from now.
+  int8_t add(const char* name, uint32_t periodMs, uint8_t priority, uint32_t budgetUs, Job job, void* ctx);
+
+  // New period, phased from the last release (an overdue job becomes due at once)
+  void setPeriod(int8_t id, uint32_t periodMs);
+
+  // Run a job out of phase now (e.g. a synchronised start). A release that is
+  // already due is consumed by this run; otherwise the grid is left alone.
+  void runNow(int8_t id);
+
+  // Once per loop(): every due job, highest priority first
+  void run();
+
+  // ms until the next release of any job (0 = something is due)
+  uint32_t msUntilNext() const;
+
+  uint8_t count() const { return count_; }
+  // Statistics of the job at priority rank i since the last reset
+  const Stats& stats(uint8_t i) const { return slots_[order_[i]].stats; }
+  // Start a new report window for the job at priority rank i
+  void resetStats(uint8_t i);
+
+private:
+  struct Slot {
+    Job job;
+    void* ctx;
+    uint32_t nextUs;    // next release on the grid (wrap-safe compare)
+    uint32_t periodUs;
+    uint8_t priority;
+    Stats stats;
+  };
+
+  void release(Slot& slot, uint32_t releaseUs);
+  static uint8_t bucket(uint32_t us);
+
+  Slot slots_[SCHED_SLOTS] = {};
+  uint8_t order_[SCHED_SLOTS] = {};  // slot indices by priority
+  uint8_t count_ = 0;
+};
@@ -8,15 +8,50 @@ namespace Protocol {
   static constexpr const char* CMD_TASK_REPLACE = "task.replace";
   static constexpr const char* CMD_TASK_ENQUEUE = "task.enqueue";
   static constexpr const char* CMD_TASK_CANCEL = "task.cancel";
+  static constexpr const char* CMD_TASK_GROUP = "task.group";  // start tasks together at `at`
   static constexpr const char* CMD_PING = "ping";
   static constexpr const char* CMD_DRIVE = "drive";
+  static constexpr const char* CMD_TWIST = "twist";
+  static constexpr const char* CMD_LEASE = "lease";
+  static constexpr const char* CMD_MACRO_PUT = "macro.put";
+  static constexpr const char* CMD_MACRO_RUN = "macro.run";
+  static constexpr const char* CMD_MACRO_DEL = "macro.del";
+  static constexpr const char* CMD_POSE_RESET = "pose.reset";
+  static constexpr const char* CMD_UDP = "udp";  // enables the UDP drive channel (token)
+  static constexpr const char* CMD_PROBE = "probe";  // echo of an ESP link probe (same id)
+  static constexpr const char* CMD_ENDPOINTS = "endpoints";  // new server list ("host:port", by priority)
+  static constexpr const char* CMD_BEHAVIOR_LOAD = "behavior.load";  // bytecode for the onboard VM (hex)
+  static constexpr const char* CMD_BEHAVIOR_STOP = "behavior.stop";
   
+  // Binary frames (server -> ESP): first byte is the opcode
+  static constexpr uint8_t BIN_STOP = 0x01;  // wheels emergency stop
+  // While the UDP channel is on the stop frame carries [1..4] the server's UDP seq
+  // at the stop (LE): datagrams up to it were sent before the stop and are stale
+  static constexpr size_t BIN_STOP_SEQ_LEN = 5;
+
+  // Binary frames (ESP -> server)
+  static constexpr uint8_t BIN_TELEMETRY = 0x10;  // delta-encoded records (TelemetryEncoder.h)
+
+  // UDP drive datagram (server -> ESP, UDP_DRIVE_PORT), little-endian:
+  //   [0] 0x20  [1] flags  [2..5] token  [6..9] seq  [10] left  [11] right  [12..13] lease ttl ms
+  // Datagrams with a foreign token or seq <= the last applied one are dropped.
+  static constexpr uint8_t UDP_DRIVE = 0x20;
+  static constexpr size_t UDP_DRIVE_LEN = 14;
+  static constexpr uint8_t UDP_FLAG_STOP = 0x01;  // emergency stop (left/right ignored)
+
   // Message kinds (inbound to server)
   static constexpr const char* RESP_ACK = "ack";
   static constexpr const char* RESP_PROGRESS = "progress";
   static constexpr const char* RESP_DONE = "done";
   static constexpr const char* RESP_ERROR = "error";
   static constexpr const char* RESP_PONG = "pong";
+  static constexpr const char* RESP_STATS = "stats";
+  static constexpr const char* RESP_ODOM = "odom";
+  static constexpr const char* RESP_PROBE = "probe";  // link RTT probe, echoed by the server
+  static constexpr const char* RESP_LINK = "link";    // link grade + advised command rate
+  static constexpr const char* RESP_GROUP = "group";  // achieved start skew of a task.group
+  static constexpr const char* RESP_SCHED = "sched";  // periodic job lateness/overrun histograms
+  static constexpr const char* RESP_BEHAVIOR = "behavior";  // behaviour VM state change + cost
   
   // Device names
   static constexpr const char* DEVICE_WHEELS = "wheels";
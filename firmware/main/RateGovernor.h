@@ -0,0 +1,56 @@
+// firmware/src/RateGovernor.h
+#pragma once
+#include <Arduino.h>
+#include "Config.h"
+
+// Picks the device tick period (fast while anything is moving, slow once parked)
+// and measures what was actually achieved over RATE_WINDOW_MS windows:
+// tick rate and MAX bus duty cycle (time spent inside bus frames).
+class RateGovernor {
+public:
+  void begin(uint32_t now) {
+    windowStartMs_ = now;
+    ticks_ = 0;
+    fast_ = true;
+  }
+
+  uint32_t period(bool parked) {
+    if (fast_ == parked) {
+      fast_ = !parked;
+#if DEBUG_LOGS
+      Serial.printf("[RATE] %s tick\n", fast_ ? "fast" : "idle");
+#endif
+    }
+    return fast_ ? WHEELS_TICK_MS : WHEELS_TICK_IDLE_MS;
+  }
+
+  void onTick() { ticks_++; }
+
+  // busFrames/busBusyUs are the bus owner's running totals
+  void poll(uint32_t now, uint32_t busFrames, uint32_t busBusyUs) {
+    const uint32_t elapsed = now - windowStartMs_;
+    if (elapsed < RATE_WINDOW_MS) return;
+    hzX10_ = (uint16_t)((ticks_ * 10000UL) / elapsed);
+    framesPerSec_ = (uint16_t)(((busFrames - lastFrames_) * 1000UL) / elapsed);
+    dutyPermille_ = (uint16_t)min<uint32_t>(1000, (busBusyUs - lastBusyUs_) / elapsed);
+    lastFrames_ = busFrames;
+    lastBusyUs_ = busBusyUs;
+    ticks_ = 0;
+    windowStartMs_ = now;
+  }
+
+  bool fast() const { return fast_; }
+  uint16_t hzX10() const { return hzX10_; }               // achieved tick rate ×10
+  uint16_t framesPerSec() const { return framesPerSec_; } // bus frames written
+  uint16_t dutyPermille() const { return dutyPermille_; } // bus busy time, ‰
+
+private:
+  uint32_t windowStartMs_ = 0;
+  uint32_t ticks_ = 0;
+  uint32_t lastFrames_ = 0;
+  uint32_t lastBusyUs_ = 0;
+  uint16_t hzX10_ = 0;
+  uint16_t framesPerSec_ = 0;
+  uint16_t dutyPermille_ = 0;
+  bool fast_ = true;
+};
@@ -0,0 +1,43 @@
+// firmware/src/RtcSnapshot.cpp
+#include "RtcSnapshot.h"
+#include <stddef.h>
+#include "MacroStore.h"
+
+RtcSnapshot& RtcSnapshot::instance() {
+  static RtcSnapshot snapshot;
+  return snapshot;
+}
+
+uint32_t RtcSnapshot::checksumOf(const State& s) {
+  return MacroStore::fnv1a(reinterpret_cast<const uint8_t*>(&s), offsetof(State, checksum));
+}
+
+void RtcSnapshot::begin() {
+  reason_ = (uint8_t)ESP.getResetInfoPtr()->reason;
+  const bool valid = ESP.rtcUserMemoryRead(RTC_SNAPSHOT_OFFSET, reinterpret_cast<uint32_t*>(&s_), sizeof(s_)) &&
+                     s_.magic == MAGIC && s_.checksum == checksumOf(s_);
+  if (!valid || reason_ == REASON_DEFAULT_RST) {
+    s_ = State{};
+    s_.magic = MAGIC;
+  }
+
+  // Only crashes take the warm path; a deliberate restart or reset button starts clean
+  switch (reason_) {
+    case REASON_WDT_RST: s_.crashes[0]++; break;
+    case REASON_EXCEPTION_RST: s_.crashes[1]++; break;
+    case REASON_SOFT_WDT_RST: s_.crashes[2]++; break;
+    default: break;
+  }
+  warm_ = valid && (reason_ == REASON_WDT_RST || reason_ == REASON_EXCEPTION_RST ||
+                    reason_ == REASON_SOFT_WDT_RST);
+  s_.boots++;
+  save();
+
+  Serial.printf("[RTC] reset reason=%u %s boots=%u crashes wdt=%u exc=%u swdt=%u\n", reason_,
+                warm_ ? "warm" : "cold", s_.boots, s_.crashes[0], s_.crashes[1], s_.crashes[2]);
+}
+
+void RtcSnapshot::save() {
+  s_.checksum = checksumOf(s_);
+  ESP.rtcUserMemoryWrite(RTC_SNAPSHOT_OFFSET, reinterpret_cast<uint32_t*>(&s_), sizeof(s_));
+}
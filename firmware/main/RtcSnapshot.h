@@ -0,0 +1,52 @@
+// firmware/src/RtcSnapshot.h
+#pragma once
+#include <Arduino.h>
+#include "Config.h"
+
+// Small state snapshot in RTC user memory: survives watchdog and exception resets
+// (not power loss) and is checksummed, so garbage after power-on reads as "cold".
+// After an unplanned reset the firmware takes the warm path: Wi-Fi rejoins the last
+// BSSID/channel with the last address as static IP (no scan, no DHCP), the WS
+// connects without backoff, message seq and pose resume, and the first hello
+// reports the reset cause with the crash counters.
+class RtcSnapshot {
+public:
+  struct State {
+    uint32_t magic;
+    uint16_t boots;          // resets since power-on
+    uint16_t crashes[3];     // hardware WDT, exception, soft WDT
+    // Last association (channel 0 = none stored)
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint8_t reserved;
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+    // Session / odometry
+    uint32_t msgSeq;
+    int32_t poseXMm;
+    int32_t poseYMm;
+    uint16_t headingBam;
+    uint16_t poseEpoch;
+    uint32_t checksum;       // FNV-1a over everything above
+  };
+  static_assert(sizeof(State) % 4 == 0, "RTC memory is read/written in 32-bit words");
+
+  static RtcSnapshot& instance();
+
+  void begin();  // read + validate, classify and count this reset
+  void save();   // re-checksum and write back
+
+  bool warm() const { return warm_; }
+  uint8_t resetReason() const { return reason_; }  // rst_reason of this boot
+  State& state() { return s_; }
+
+private:
+  static constexpr uint32_t MAGIC = 0x31435452;  // "RTC1"
+  static uint32_t checksumOf(const State& s);
+
+  State s_{};
+  uint8_t reason_ = 0;
+  bool warm_ = false;
+};
@@ -1,25 +1,127 @@
 // firmware/src/TaskRunner.cpp
 #include "TaskRunner.h"
 #include "Config.h"
+#include "RtcSnapshot.h"
+#include "PeriodicScheduler.h"
 
 void TaskRunner::begin() {
-  wheels_.begin();
-  lastWheelsTick_ = millis();
-  lastDriveProcessMs_ = millis();
+  if (MAX_BUS_PARALLEL && !MaxBus::instance().begin(MAX_CHANNEL_PINS)) {
+    Serial.println("[RUNNER] ERROR: MAX bus pins invalid");
+  }
+  devices_.begin();
+  macros_.begin();
+  // Warm start after a crash: continue the pose track (epoch kept) instead of restarting at 0
+  RtcSnapshot& rtc = RtcSnapshot::instance();
+  if (rtc.warm()) {
+    const RtcSnapshot::State& st = rtc.state();
+    wheels().restorePose(st.poseXMm, st.poseYMm, st.headingBam, st.poseEpoch);
+  }
+  const uint32_t now = millis();
+  rate_.begin(now);
+  power_.begin(now);
+  tickJob_ = PeriodicScheduler::instance().add("tick", WHEELS_TICK_MS, 0, SCHED_TICK_BUDGET_US,
+                                               &TaskRunner::tickThunk, this);
 }
 
 void TaskRunner::loop() {
   const uint32_t now = millis();
-  if (now - lastWheelsTick_ >= WHEELS_TICK_MS) {
-    wheels_.tick();
-    lastWheelsTick_ = now;
+  wheels().enforceLease(now);
+
+  // A released group is ticked in this pass so every member's frame goes out together
+  uint32_t releaseUs = 0;
+  const bool released = releaseGroups(now, releaseUs);
+
+  // Re-evaluated every pass: a new target switches back to the fast period at once
+  // (re-phased from the last tick, so an overdue tick runs in this pass)
+  PeriodicScheduler& sched = PeriodicScheduler::instance();
+  sched.setPeriod(tickJob_, rate_.period(devicesParked(now)));
+  if (released) sched.runNow(tickJob_);
+  sched.run();
+  if (MAX_BUS_PARALLEL) MaxBus::instance().kick();
+  if (released) groupReport_.spanUs = micros() - releaseUs;
+  rate_.poll(now, wheels().busFrames(), wheels().busBusyUs());
+
+  processTaskQueue(now);
+  // A timed group wheels move gets no lease frames: renew it like a queued task
+  if (groupWheelsEndMs_) {
+    if ((int32_t)(now - groupWheelsEndMs_) >= 0) groupWheelsEndMs_ = 0;
+    else if (arb_.owns(DriveArbiter::GROUP)) wheels().keepAlive(now);
+  }
+  co_.run(now);
+  applyDrive(now);
+}
+
+// Only the winning source reaches the slew limiter; switches are logged by the arbiter
+void TaskRunner::applyDrive(uint32_t now) {
+  if (twist_.running()) {
+    // Live slot expired or was taken by a stop: the ramp ends with it
+    int8_t l, r;
+    if (!arb_.active(DriveArbiter::LIVE)) twist_.stop();
+    else if (twist_.step(now, l, r)) arb_.update(DriveArbiter::LIVE, l, r);
+  }
+  DriveArbiter::Setpoint sp;
+  if (arb_.poll(now, sp)) wheels().setTarget(sp.left, sp.right, sp.durationMs, sp.shaped);
+}
+
+void TaskRunner::grantLease(uint32_t ttlMs) {
+  const uint32_t now = millis();
+  wheels().grantLease(now, ttlMs);
+  if (ttlMs == 0) {
+    arb_.release(DriveArbiter::LIVE);
+    arb_.release(DriveArbiter::GROUP);
+    return;
   }
-  
-  // Process pending drive commands every ~33ms (coalesce spam)
+  arb_.extend(DriveArbiter::LIVE, now, ttlMs);
+  arb_.extend(DriveArbiter::GROUP, now, ttlMs);
+}
+
+void TaskRunner::tickThunk(void* ctx, uint32_t now) {
+  static_cast<TaskRunner*>(ctx)->tickDevices(now);
+}
+
+// Newest live drive goes in right before the tick that puts it on the bus
+void TaskRunner::tickDevices(uint32_t now) {
   processPendingDrive();
+  tickBehavior(now);
+  applyDrive(now);
+  devices_.tick(now);
+  rate_.onTick();
+}
+
+void TaskRunner::idle(bool netBusy) {
+  // Not while a wheels frame is queued or clocking on the parallel MAX bus (the
+  // parked keepalive): light sleep would stretch the timer1 bit slots. Skipping
+  // the poll leaves the power state as is; the next pass sleeps.
+  if (!wheels().busIdle()) return;
+  const uint32_t now = millis();
+  const uint32_t ms = power_.poll(now, !netBusy && devicesParked(now),
+                                  now + PeriodicScheduler::instance().msUntilNext());
+  if (!ms) return;
+  const uint32_t startUs = micros();
+  delay(ms);  // lets the SDK enter light sleep; received frames wait in the AP/lwIP
+  power_.onSlept(ms, micros() - startUs);
+}
+
+bool TaskRunner::devicesParked(uint32_t now) {
+  return wheels().parked(now) && !pendingDrive_.hasPending && !twist_.running() && queueCount_ == 0 &&
+         !queuedTaskActive_ && !co_.alive(macroCo_) &&
+         !devices_.get<ArmDevice>().isRunning() && !devices_.get<NeckDevice>().isRunning() &&
+         !groupsPending() && !vm_.active();
+}
+
+bool TaskRunner::groupsPending() const {
+  for (const auto& slot : groups_) {
+    if (slot.pending) return true;
+  }
+  return false;
 }
 
 void TaskRunner::handleDriveTask(int8_t leftPct, int8_t rightPct, uint32_t durationMs) {
+  // Live drive pre-empts queued task, macro playback and the behaviour program
+  clearTaskQueue();
+  stopMacro();
+  stopBehavior();
+  twist_.stop();
   // Queue the latest drive command (overwrite previous if not yet processed)
   pendingDrive_.left = leftPct;
   pendingDrive_.right = rightPct;
@@ -27,19 +129,347 @@ void TaskRunner::handleDriveTask(int8_t leftPct, int8_t rightPct, uint32_t durat
   pendingDrive_.hasPending = true;
 }
 
+void TaskRunner::handleTwist(int16_t vMmS, int16_t wMradS, uint32_t durationMs) {
+  // Same pre-emption as live drive; the ramp starts from the motion on the bus
+  clearTaskQueue();
+  stopMacro();
+  stopBehavior();
+  pendingDrive_.hasPending = false;
+  const uint32_t now = millis();
+  const Odometry& odom = wheels().odometry();
+  twist_.setTarget(vMmS, wMradS, odom.vMmS(), odom.wMradS(), now);
+  int8_t l, r;
+  twist_.step(now, l, r);
+  arb_.submit(DriveArbiter::LIVE, twist_.left(), twist_.right(), durationMs, now, true);
+}
+
 void TaskRunner::processPendingDrive() {
   if (!pendingDrive_.hasPending) return;
-  
-  const uint32_t now = millis();
-  // Only process every ~33ms to prevent spam
-  if (now - lastDriveProcessMs_ < 33) return;
-  
-  wheels_.setTarget(pendingDrive_.left, pendingDrive_.right, pendingDrive_.durationMs);
+  arb_.submit(DriveArbiter::LIVE, pendingDrive_.left, pendingDrive_.right, pendingDrive_.durationMs, millis());
   pendingDrive_.hasPending = false;
-  lastDriveProcessMs_ = now;
 }
 
-void TaskRunner::onDisconnected() {
-  wheels_.emergencyStop();
+bool TaskRunner::enqueueDriveTask(int8_t leftPct, int8_t rightPct, uint32_t durationMs) {
+  if (queueCount_ >= TASK_QUEUE_CAPACITY) return false;
+  stopMacro();
+  const uint8_t tail = (queueHead_ + queueCount_) % TASK_QUEUE_CAPACITY;
+  queue_[tail] = {leftPct, rightPct, durationMs};
+  queueCount_++;
+  return true;
+}
+
+void TaskRunner::clearTaskQueue() {
+  queueHead_ = 0;
+  queueCount_ = 0;
+  queuedTaskActive_ = false;
+  arb_.release(DriveArbiter::QUEUE);
+}
+
+void TaskRunner::processTaskQueue(uint32_t now) {
+  if (queuedTaskActive_) {
+    // Timed task still running; open-ended task yields as soon as another is queued
+    const bool expired = queuedTaskEndMs_ != 0 && (int32_t)(now - queuedTaskEndMs_) >= 0;
+    if (!expired && (queuedTaskEndMs_ != 0 || queueCount_ == 0)) {
+      if (queuedTaskEndMs_ != 0 && arb_.owns(DriveArbiter::QUEUE)) wheels().keepAlive(now);
+      return;
+    }
+    queuedTaskActive_ = false;
+  }
+  if (queueCount_ == 0) return;
+
+  const QueuedDrive& next = queue_[queueHead_];
+  queueHead_ = (queueHead_ + 1) % TASK_QUEUE_CAPACITY;
+  queueCount_--;
+
+  // A pending live drive outranks the queue: the arbiter decides, nothing is dropped here
+  arb_.submit(DriveArbiter::QUEUE, next.left, next.right, next.durationMs, now);
+  queuedTaskActive_ = true;
+  queuedTaskEndMs_ = next.durationMs ? (now + next.durationMs) : 0;
+}
+
+bool TaskRunner::scheduleGroup(const TaskGroup& group) {
+  if (!group.members || (int32_t)(group.atMs - millis()) > (int32_t)TASK_GROUP_MAX_AHEAD_MS) return false;
+  for (auto& slot : groups_) {
+    if (slot.pending) continue;
+    slot.group = group;
+    slot.pending = true;
+    return true;
+  }
+  return false;
+}
+
+bool TaskRunner::takeGroupReport(GroupReport& out) {
+  if (!groupReportReady_) return false;
+  out = groupReport_;
+  groupReportReady_ = false;
+  return true;
+}
+
+// Groups due in the same pass are started together; the report covers the last one
+bool TaskRunner::releaseGroups(uint32_t now, uint32_t& releaseUs) {
+  bool released = false;
+  for (auto& slot : groups_) {
+    if (!slot.pending || (int32_t)(now - slot.group.atMs) < 0) continue;
+    slot.pending = false;
+    if (!released) releaseUs = micros();
+    released = true;
+    startGroup(slot.group, now);
+  }
+  return released;
+}
+
+void TaskRunner::startGroup(const TaskGroup& g, uint32_t now) {
+  uint32_t firstUs = 0;
+  uint32_t lastUs = 0;
+  auto mark = [&]() {
+    lastUs = micros();
+    if (!firstUs) firstUs = lastUs;
+  };
+
+  if (g.members & TaskGroup::WHEELS) {
+    // Same pre-emption as live drive, minus the coalescing delay
+    clearTaskQueue();
+    stopMacro();
+    pendingDrive_.hasPending = false;
+    arb_.submit(DriveArbiter::GROUP, g.left, g.right, g.wheelsMs, now);
+    groupWheelsEndMs_ = g.wheelsMs ? now + g.wheelsMs : 0;
+    applyDrive(now);
+    mark();
+  }
+  if (g.members & (TaskGroup::ARM | TaskGroup::NECK)) {
+    TaskEnvelope task;
+    task.taskId = String("group-") + g.id;
+    if (g.members & TaskGroup::ARM) {
+      task.angle = g.armAngle;
+      task.durationMs = g.armMs;
+      devices_.get<ArmDevice>().startTask(task, now);
+      mark();
+    }
+    if (g.members & TaskGroup::NECK) {
+      task.angle = g.neckAngle;
+      task.durationMs = g.neckMs;
+      devices_.get<NeckDevice>().startTask(task, now);
+      mark();
+    }
+  }
+
+  groupReport_ = {g.id, g.members, (int32_t)(now - g.atMs), lastUs - firstUs, 0};
+  groupReportReady_ = true;
+}
+
+bool TaskRunner::runMacro(uint8_t id, uint8_t scalePct, bool mirror) {
+  const uint32_t hash = macros_.hashOf(id);
+  if (!hash) return false;
+  // Reuse the loaded copy when the same macro is re-run (no flash read)
+  if (macroId_ != (int8_t)id || macro_.hash != hash) {
+    if (!macros_.load(id, macro_)) {
+      macroId_ = -1;
+      return false;
+    }
+    macroId_ = id;
+  }
+
+  clearTaskQueue();
+  stopBehavior();
+  pendingDrive_.hasPending = false;
+  co_.kill(macroCo_);
+  macroScalePct_ = scalePct;
+  macroMirror_ = mirror;
+  macroCo_ = co_.spawn(&TaskRunner::macroSequenceThunk, this);
+  return macroCo_ >= 0;
+}
+
+void TaskRunner::stopMacro() {
+  if (!co_.alive(macroCo_)) return;
+  co_.kill(macroCo_);
+  macroCo_ = -1;
+  arb_.release(DriveArbiter::MACRO);
+}
+
+bool TaskRunner::macroSequenceThunk(CoState& co, void* ctx, uint32_t now) {
+  return static_cast<TaskRunner*>(ctx)->macroSequence(co, now);
+}
+
+// Steps are scheduled back-to-back on the step deadlines, not on `now`, so loop
+// jitter does not accumulate and repeated runs are identical.
+bool TaskRunner::macroSequence(CoState& co, uint32_t now) {
+  CO_BEGIN(co);
+  macroStepEndMs_ = now;
+  for (macroIndex_ = 0; macroIndex_ < macro_.count; ++macroIndex_) {
+    startMacroStep(macro_.steps[macroIndex_], macroStepEndMs_);
+    macroStepEndMs_ += macro_.steps[macroIndex_].durationMs;
+    while ((int32_t)(now - macroStepEndMs_) < 0) {
+      if (arb_.owns(DriveArbiter::MACRO)) wheels().keepAlive(now);
+      CO_YIELD(co);
+    }
+  }
+  // Report done only once the last wheels step has left the bus queue
+  if (arb_.owns(DriveArbiter::MACRO)) CO_AWAIT_BUS_IDLE(co, wheels());
+  arb_.release(DriveArbiter::MACRO);
+  Serial.printf("[MACRO] id=%d done\n", macroId_);
+  CO_END(co);
+}
+
+void TaskRunner::startMacroStep(const MacroStep& step, uint32_t now) {
+  switch (static_cast<MacroDevice>(step.device)) {
+    case MacroDevice::WHEELS: {
+      int16_t l = (int16_t)step.left * macroScalePct_ / 100;
+      int16_t r = (int16_t)step.right * macroScalePct_ / 100;
+      if (macroMirror_) {
+        const int16_t t = l;
+        l = r;
+        r = t;
+      }
+      // Macro owns the timeline; deadline is enforced by macroSequence()
+      arb_.submit(DriveArbiter::MACRO, (int8_t)constrain(l, -100, 100), (int8_t)constrain(r, -100, 100), 0, now);
+      break;
+    }
+    case MacroDevice::ARM:
+    case MacroDevice::NECK: {
+      TaskEnvelope task;
+      task.taskId = "macro";
+      task.angle = macroMirror_ ? (uint16_t)(180 - min<uint8_t>(step.angle, 180)) : step.angle;
+      task.durationMs = step.durationMs;
+      if (static_cast<MacroDevice>(step.device) == MacroDevice::ARM) {
+        devices_.get<ArmDevice>().startTask(task, now);
+      } else {
+        devices_.get<NeckDevice>().startTask(task, now);
+      }
+      break;
+    }
+    case MacroDevice::WAIT:
+    default:
+      break;
+  }
+}
+
+void TaskRunner::fastStop() {
+  pendingDrive_.hasPending = false;
+  clearTaskQueue();
+  co_.kill(macroCo_);
+  macroCo_ = -1;
+  twist_.stop();
+  stopBehavior();
+  arb_.clear();
+  wheels().emergencyStop();
+}
+
+void TaskRunner::onDisconnected(bool holdLease) {
+  const uint32_t now = millis();
+  if (holdLease && arb_.owns(DriveArbiter::LIVE) && wheels().leaseRemaining(now)) {
+    // Everything the old server streamed goes; the joystick/twist in progress stays
+    wheels().capLease(now, EP_FAILOVER_HOLD_MS);
+    devices_.get<ArmDevice>().cancel(now);
+    devices_.get<NeckDevice>().cancel(now);
+    clearTaskQueue();
+    stopMacro();
+    stopBehavior();
+    return;
+  }
+  devices_.cancel(now);
   pendingDrive_.hasPending = false;
+  clearTaskQueue();
+  co_.kill(macroCo_);
+  macroCo_ = -1;
+  twist_.stop();
+  stopBehavior();
+  arb_.clear();
+}
+
+BehaviorVm::Error TaskRunner::loadBehavior(const uint8_t* code, size_t len, bool run, uint16_t& errPc) {
+  stopBehavior();
+  vmMaxTickUs_ = 0;
+  const BehaviorVm::Error err = vm_.load(code, len, errPc);
+  if (err == BehaviorVm::OK && run) {
+    clearTaskQueue();
+    stopMacro();
+    pendingDrive_.hasPending = false;
+    vm_.start(millis());
+  }
+  reportBehavior();
+  return err;
+}
+
+void TaskRunner::stopBehavior() {
+  if (!vm_.active()) return;
+  vm_.stop();
+  endBehavior();
+}
+
+bool TaskRunner::takeBehaviorReport(BehaviorReport& out) {
+  if (!behaviorReportReady_) return false;
+  out = behaviorReport_;
+  behaviorReportReady_ = false;
+  return true;
+}
+
+// One instruction budget per device tick; the setpoint it leaves is applied in the
+// same tick, so a sensor-to-wheels decision costs no more than one tick period
+void TaskRunner::tickBehavior(uint32_t now) {
+  if (!vm_.active()) return;
+  const BehaviorVm::Io io{this, &TaskRunner::behaviorSense, &TaskRunner::behaviorDrive, &TaskRunner::behaviorServo};
+  const uint32_t startUs = micros();
+  if (vm_.tick(now, io)) {
+    const uint32_t us = micros() - startUs;
+    if (us > vmMaxTickUs_) vmMaxTickUs_ = us;
+  }
+  if (!vm_.active()) {
+    endBehavior();
+    return;
+  }
+  if (arb_.owns(DriveArbiter::BEHAVIOR)) wheels().keepAlive(now);
+}
+
+void TaskRunner::endBehavior() {
+  arb_.release(DriveArbiter::BEHAVIOR);
+  if (vm_.state() == BehaviorVm::FAULT) {
+    Serial.printf("[BEH] fault %s at pc=%u\n", BehaviorVm::errorName(vm_.error()), vm_.pc());
+  }
+  reportBehavior();
+}
+
+void TaskRunner::reportBehavior() {
+  const BehaviorVm::Stats& st = vm_.stats();
+  behaviorReport_ = {vm_.state(), vm_.error(), vm_.pc(), vm_.size(), st.ticks, st.insns, st.maxInsns, vmMaxTickUs_};
+  behaviorReportReady_ = true;
+}
+
+int32_t TaskRunner::behaviorSense(void* ctx, uint8_t sensor) {
+  TaskRunner& self = *static_cast<TaskRunner*>(ctx);
+  WheelsDevice& w = self.wheels();
+  const Odometry& odom = w.odometry();
+  switch (sensor) {
+    case BehaviorVm::X_MM: return odom.xMm();
+    case BehaviorVm::Y_MM: return odom.yMm();
+    case BehaviorVm::HEADING_CDEG: return odom.headingCdeg();
+    case BehaviorVm::V_MMS: return odom.vMmS();
+    case BehaviorVm::W_MRADS: return odom.wMradS();
+    case BehaviorVm::WHEEL_L: return w.appliedPctL();
+    case BehaviorVm::WHEEL_R: return w.appliedPctR();
+    case BehaviorVm::ARM_BUSY: return self.devices_.get<ArmDevice>().isRunning();
+    case BehaviorVm::NECK_BUSY: return self.devices_.get<NeckDevice>().isRunning();
+    default: return 0;
+  }
+}
+
+// Open-ended BEHAVIOR setpoint, resubmitted only when it changes
+void TaskRunner::behaviorDrive(void* ctx, int8_t left, int8_t right) {
+  TaskRunner& self = *static_cast<TaskRunner*>(ctx);
+  if (self.arb_.active(DriveArbiter::BEHAVIOR) && left == self.vmLeft_ && right == self.vmRight_) return;
+  self.vmLeft_ = left;
+  self.vmRight_ = right;
+  self.arb_.submit(DriveArbiter::BEHAVIOR, left, right, 0, millis());
+}
+
+void TaskRunner::behaviorServo(void* ctx, uint8_t op, uint8_t angle) {
+  TaskRunner& self = *static_cast<TaskRunner*>(ctx);
+  TaskEnvelope task;
+  task.taskId = "behavior";
+  task.angle = angle;
+  task.durationMs = 0;  // device default move time
+  if (op == BehaviorVm::ARM) {
+    self.devices_.get<ArmDevice>().startTask(task, millis());
+  } else {
+    self.devices_.get<NeckDevice>().startTask(task, millis());
+  }
 }
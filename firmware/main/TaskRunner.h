@@ -1,24 +1,99 @@
 // firmware/src/TaskRunner.h
 #pragma once
 #include <Arduino.h>
-#include "Devices/WheelsDevice.h"
+#include "DeviceTopology.h"
+#include "Coroutine.h"
+#include "MacroStore.h"
+#include "BehaviorVm.h"
+#include "RateGovernor.h"
+#include "IdleGovernor.h"
+#include "DriveArbiter.h"
+#include "TwistMixer.h"
+#include "TaskTypes.h"
 
 class TaskRunner {
 public:
   void begin();
   void loop(); // gọi trong Arduino loop()
 
+  // Power-aware idle: sleeps until the next scheduled job while parked. netBusy = the
+  // network side still has a short deadline (e.g. a pending flow ack).
+  void idle(bool netBusy);
+  bool powerIdle() const { return power_.idle(); }
+  IdleGovernor::Report takePowerReport() { return power_.takeReport(millis()); }
+
   // Hooks từ NetClient
   void handleDriveTask(int8_t leftPct, int8_t rightPct, uint32_t durationMs);
+  // Live twist (v mm/s, w mrad/s): mixed and ramped here, same priority as drive
+  void handleTwist(int16_t vMmS, int16_t wMradS, uint32_t durationMs);
+
+  // Server motion lease for live drive (ttlMs == 0 releases it)
+  void grantLease(uint32_t ttlMs);
+
+  // Queued wheels tasks (task.replace / task.enqueue). Returns false when full.
+  bool enqueueDriveTask(int8_t leftPct, int8_t rightPct, uint32_t durationMs);
+  void clearTaskQueue();
+  uint8_t freeTaskSlots() const { return TASK_QUEUE_CAPACITY - queueCount_; }
+
+  // Synchronised start: members are held until the device clock reaches atMs, then
+  // started back-to-back and ticked in the same pass. Returns false when all slots
+  // are taken or atMs is further out than TASK_GROUP_MAX_AHEAD_MS.
+  bool scheduleGroup(const TaskGroup& group);
+  bool takeGroupReport(GroupReport& out);
+
+  // Flash-resident macros: scalePct scales wheel speeds, mirror swaps left/right
+  // (and reflects arm/neck angles). Returns false if the macro is not stored.
+  bool runMacro(uint8_t id, uint8_t scalePct, bool mirror);
+  void stopMacro();
+  MacroStore& macros() { return macros_; }
+
+  // Onboard behaviour program (verified bytecode, see BehaviorVm.h). Replaces the
+  // loaded one; run = start it now (pre-empts the task queue and macros like a macro
+  // run). Live drive, twist, stop and disconnect stop it.
+  BehaviorVm::Error loadBehavior(const uint8_t* code, size_t len, bool run, uint16_t& errPc);
+  void stopBehavior();
+  bool takeBehaviorReport(BehaviorReport& out);
+
+  // Device sequences run as stackless coroutines, resumed once per loop()
+  using Scheduler = CoScheduler<TASK_COROUTINE_SLOTS>;
+  Scheduler& coroutines() { return co_; }
 
-  // Khi WS rớt
-  void onDisconnected();
+  const WheelsDevice& wheelsState() { return wheels(); }
+
+  // Dead-reckoning pose (pose.reset zeroes it)
+  const Odometry& odometry() { return wheels().odometry(); }
+  void resetPose() { wheels().resetPose(); }
+
+  // Achieved device tick rate / MAX bus duty cycle
+  const RateGovernor& rate() const { return rate_; }
+
+  // Khi WS rớt. holdLease = failing over to another server: live motion under a
+  // server lease runs on (EP_FAILOVER_HOLD_MS at most) for the next server to renew
+  void onDisconnected(bool holdLease = false);
+
+  // Stop fast path (pre-parse): wheels stop now, drop pending/queued wheels work
+  void fastStop();
 
 private:
-  WheelsDevice wheels_;
-  uint32_t lastWheelsTick_ = 0;
+  RobotDevices devices_;  // static-dispatch registry (see DeviceTopology.h)
+  WheelsDevice& wheels() { return devices_.get<WheelsDevice>(); }
+  RateGovernor rate_;
+
+  // Device tick = fixed-rate job on the PeriodicScheduler (period from rate_)
+  int8_t tickJob_ = -1;
+  static void tickThunk(void* ctx, uint32_t now);
+  void tickDevices(uint32_t now);
+  IdleGovernor power_;
+  bool devicesParked(uint32_t now);
+
+  // Wheels setpoint arbitration: sources submit here, applyDrive() forwards the winner
+  DriveArbiter arb_;
+  void applyDrive(uint32_t now);
+
+  // Twist mixer: plays the live source out while its ramp runs
+  TwistMixer twist_;
   
-  // Drive command coalescing - only process latest command every ~33ms
+  // Drive command coalescing: only the latest command is applied, at the next tick
   struct PendingDrive {
     int8_t left;
     int8_t right;
@@ -26,7 +101,63 @@ private:
     bool hasPending;
   };
   PendingDrive pendingDrive_{0, 0, 0, false};
-  uint32_t lastDriveProcessMs_ = 0;
-  
+
+  // Bounded FIFO of timed wheels tasks; free slots are the flow-control window
+  struct QueuedDrive {
+    int8_t left;
+    int8_t right;
+    uint32_t durationMs;
+  };
+  QueuedDrive queue_[TASK_QUEUE_CAPACITY];
+  uint8_t queueHead_ = 0;
+  uint8_t queueCount_ = 0;
+  bool queuedTaskActive_ = false;   // a dequeued task currently owns the wheels
+  uint32_t queuedTaskEndMs_ = 0;    // 0 = open-ended (runs until next task)
+
+  Scheduler co_;
+
+  // Held task.group slots and the report of the last released one
+  struct PendingGroup {
+    TaskGroup group;
+    bool pending;
+  };
+  PendingGroup groups_[TASK_GROUP_SLOTS] = {};
+  GroupReport groupReport_{};
+  uint32_t groupWheelsEndMs_ = 0;  // end of a released timed wheels member (0 = none)
+  bool groupReportReady_ = false;
+
+  bool releaseGroups(uint32_t now, uint32_t& releaseUs);
+  void startGroup(const TaskGroup& g, uint32_t now);
+  bool groupsPending() const;
+
+  // Macro playback (coroutine): steps are scheduled back-to-back on the device clock
+  MacroStore macros_;
+  Macro macro_;                 // loaded steps (cached by id + hash)
+  int8_t macroId_ = -1;
+  int8_t macroCo_ = -1;         // scheduler slot of the running macro
+  uint8_t macroIndex_ = 0;
+  uint32_t macroStepEndMs_ = 0;
+  uint8_t macroScalePct_ = 100;
+  bool macroMirror_ = false;
+
   void processPendingDrive();
+  void processTaskQueue(uint32_t now);
+  static bool macroSequenceThunk(CoState& co, void* ctx, uint32_t now);
+  bool macroSequence(CoState& co, uint32_t now);
+  void startMacroStep(const MacroStep& step, uint32_t now);
+
+  // Behaviour VM: ticked right before applyDrive(), wheels through the BEHAVIOR slot
+  BehaviorVm vm_;
+  int8_t vmLeft_ = 0;
+  int8_t vmRight_ = 0;
+  uint32_t vmMaxTickUs_ = 0;
+  BehaviorReport behaviorReport_{};
+  bool behaviorReportReady_ = false;
+
+  void tickBehavior(uint32_t now);
+  void endBehavior();
+  void reportBehavior();
+  static int32_t behaviorSense(void* ctx, uint8_t sensor);
+  static void behaviorDrive(void* ctx, int8_t left, int8_t right);
+  static void behaviorServo(void* ctx, uint8_t op, uint8_t angle);
 };
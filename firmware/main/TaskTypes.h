@@ -34,3 +34,44 @@ struct TaskEnvelope {
   uint8_t leftCmd;
   uint8_t rightCmd;
 };
+
+// Synchronised start (task.group): member devices are started in the same control
+// tick once the device clock reaches atMs. One task per member device.
+struct TaskGroup {
+  static constexpr uint8_t WHEELS = 0x01;
+  static constexpr uint8_t ARM = 0x02;
+  static constexpr uint8_t NECK = 0x04;
+
+  uint16_t id;
+  uint32_t atMs;      // device millis()
+  uint8_t members;    // WHEELS | ARM | NECK
+  int8_t left;
+  int8_t right;
+  uint32_t wheelsMs;
+  uint16_t armAngle;
+  uint32_t armMs;
+  uint16_t neckAngle;
+  uint32_t neckMs;
+};
+
+// Achieved start of a released group: lateMs = release - atMs (loop latency),
+// skewUs = first to last member start, spanUs = release to the end of the bus kick
+struct GroupReport {
+  uint16_t id;
+  uint8_t members;
+  int32_t lateMs;
+  uint32_t skewUs;
+  uint32_t spanUs;
+};
+
+// Behaviour VM state change (load, start, end): counters of the run so far
+struct BehaviorReport {
+  uint8_t state;      // BehaviorVm::State
+  uint8_t error;      // BehaviorVm::Error
+  uint16_t pc;
+  uint16_t size;
+  uint32_t ticks;
+  uint32_t insns;
+  uint16_t maxInsns;  // most instructions in one tick
+  uint32_t maxTickUs; // slowest tick
+};
@@ -0,0 +1,88 @@
+// firmware/src/TelemetryEncoder.cpp
+#include "TelemetryEncoder.h"
+#include "Protocol.h"
+
+static uint32_t fnv1a(const char* s) {
+  uint32_t h = 0x811C9DC5u;
+  while (*s) {
+    h ^= (uint8_t)*s++;
+    h *= 0x01000193u;
+  }
+  return h;
+}
+
+void TelemetryEncoder::reset() {
+  memset(sinceKey_, 0, sizeof(sinceKey_));
+  textHash_ = 0;
+}
+
+uint8_t TelemetryEncoder::fieldCount(Type type) {
+  switch (type) {
+    case PROGRESS: return PROGRESS_FIELDS;
+    case WHEELS: return WHEELS_FIELDS;
+    case POSE: return POSE_FIELDS;
+    case STATS: return STATS_FIELDS;
+    default: return 0;
+  }
+}
+
+uint8_t TelemetryEncoder::fieldOffset(Type type) {
+  uint8_t off = 0;
+  for (uint8_t t = PROGRESS; t < type; ++t) off += fieldCount((Type)t);
+  return off;
+}
+
+size_t TelemetryEncoder::putVarint(uint8_t* out, uint32_t v) {
+  size_t n = 0;
+  while (v >= 0x80) {
+    out[n++] = (uint8_t)(v | 0x80);
+    v >>= 7;
+  }
+  out[n++] = (uint8_t)v;
+  return n;
+}
+
+void TelemetryEncoder::beginFrame(uint8_t* buf, size_t cap) {
+  buf_ = buf;
+  cap_ = cap;
+  len_ = 0;
+  overflow_ = cap == 0;
+  if (!overflow_) buf_[len_++] = Protocol::BIN_TELEMETRY;
+}
+
+bool TelemetryEncoder::add(Type type, const int32_t* fields, const char* text) {
+  const uint8_t n = fieldCount(type);
+  if (overflow_ || !n) return false;
+
+  bool key = sinceKey_[type] == 0;
+  uint32_t hash = 0;
+  if (text) {
+    hash = fnv1a(text);
+    key = key || hash != textHash_;
+  }
+  const size_t textLen = (key && text) ? strlen(text) : 0;
+
+  // Worst case: tag + 5 bytes per varint + text
+  if (len_ + 1 + n * 5u + (text ? 5 + textLen : 0) > cap_) {
+    overflow_ = true;
+    reset();  // records already in this frame are lost with it
+    return false;
+  }
+
+  buf_[len_++] = (uint8_t)(type << 1 | (key ? 1 : 0));
+  int32_t* prev = prev_ + fieldOffset(type);
+  for (uint8_t i = 0; i < n; ++i) {
+    const int32_t v = key ? fields[i] : (int32_t)((uint32_t)fields[i] - (uint32_t)prev[i]);
+    len_ += putVarint(buf_ + len_, zigzag(v));
+    prev[i] = fields[i];
+  }
+  if (key && text) {
+    len_ += putVarint(buf_ + len_, textLen);
+    memcpy(buf_ + len_, text, textLen);
+    len_ += textLen;
+    textHash_ = hash;
+  }
+
+  sinceKey_[type] = key ? 1 : (uint8_t)((sinceKey_[type] + 1) % TLM_KEYFRAME_EVERY);
+  return true;
+}
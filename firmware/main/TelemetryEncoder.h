@@ -0,0 +1,54 @@
+// firmware/src/TelemetryEncoder.h
+#pragma once
+#include <Arduino.h>
+#include "Config.h"
+
+// Binary telemetry (ESP -> server), used once the server hello carries tlm >= 1.
+//
+//   frame  := BIN_TELEMETRY record+
+//   record := tag field* [text]
+//   tag    := type << 1 | key
+//   field  := zig-zag LEB128 varint; absolute in a keyframe, otherwise the
+//             wrapping difference to the same field of the previous record of
+//             that type (fixed field count per type)
+//   text   := varint length + bytes (PROGRESS keyframes only: the task id)
+//
+// Each type restarts with a keyframe after reset() (new connection), when the
+// task id changes, and every TLM_KEYFRAME_EVERY records. Field layouts must
+// match the decoder in server/src/telemetry.ts.
+class TelemetryEncoder {
+public:
+  enum Type : uint8_t { PROGRESS = 1, WHEELS, POSE, STATS, TYPE_COUNT };
+
+  static constexpr uint8_t PROGRESS_FIELDS = 2;  // state (0 ack, 1 progress, 2 done), pct
+  static constexpr uint8_t WHEELS_FIELDS = 4;    // target L/R, applied L/R (pct)
+  static constexpr uint8_t POSE_FIELDS = 7;      // x, y, th, v, w, ep, t
+  static constexpr uint8_t STATS_FIELDS = 28;    // heap..alert, fb[2], co[3], rate[3], stop[4], rx[4], pwr[4], up
+
+  // Next record of every type is a keyframe
+  void reset();
+
+  void beginFrame(uint8_t* buf, size_t cap);
+  // fields: fieldCount(type) values. Returns false if the record did not fit;
+  // the frame is then unusable (length() == 0) and every type re-keys.
+  bool add(Type type, const int32_t* fields, const char* text = nullptr);
+  size_t length() const { return overflow_ ? 0 : len_; }
+
+  static uint8_t fieldCount(Type type);
+  static uint32_t zigzag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+  static size_t putVarint(uint8_t* out, uint32_t v);
+
+private:
+  static constexpr uint8_t TOTAL_FIELDS = PROGRESS_FIELDS + WHEELS_FIELDS + POSE_FIELDS + STATS_FIELDS;
+
+  int32_t prev_[TOTAL_FIELDS] = {0};
+  uint8_t sinceKey_[TYPE_COUNT] = {0};  // 0 = keyframe due
+  uint32_t textHash_ = 0;
+
+  uint8_t* buf_ = nullptr;
+  size_t cap_ = 0;
+  size_t len_ = 0;
+  bool overflow_ = false;
+
+  static uint8_t fieldOffset(Type type);
+};
@@ -0,0 +1,109 @@
+// firmware/src/TwistMixer.h
+#pragma once
+#include <Arduino.h>
+#include "Config.h"
+
+// Twist (v mm/s forward, w mrad/s CCW) -> wheel percentages, mixed on the device with
+// the odometry's track width and per-wheel trim. A target the wheels cannot reach is
+// scaled down as a whole (v and w by the same factor), so the turn radius is kept and
+// only the speed along the arc drops. The output then moves towards the target along
+// a straight line in (v, w), limited by TWIST_ACCEL_MM_S2 and TWIST_ALPHA_MRAD_S2:
+// both axes arrive together, so an arc keeps its curvature while it ramps up.
+// Internal state is x1000 (um/s, urad/s) so slow ramps at short loop periods still move.
+class TwistMixer {
+public:
+  // from = current body motion (odometry) when the mixer is not running yet
+  void setTarget(int16_t vMmS, int16_t wMradS, int16_t fromV, int16_t fromW, uint32_t now) {
+    if (!running_) {
+      v_ = (int32_t)fromV * 1000;
+      w_ = (int32_t)fromW * 1000;
+      lastMs_ = now;
+      left_ = right_ = 127;  // first step always reports
+      running_ = true;
+    }
+    saturate(vMmS, wMradS);
+    targetV_ = (int32_t)vMmS * 1000;
+    targetW_ = (int32_t)wMradS * 1000;
+  }
+
+  void stop() { running_ = false; }
+  bool running() const { return running_; }
+  int8_t left() const { return left_; }
+  int8_t right() const { return right_; }
+
+  // Advance the ramp; true when the wheel percentages changed
+  bool step(uint32_t now, int8_t& left, int8_t& right) {
+    const uint32_t dtMs = now - lastMs_;
+    lastMs_ = now;
+    if (dtMs) ramp(min<uint32_t>(dtMs, 1000));
+
+    const int8_t l = pct(v_ - w_ * ODOM_TRACK_MM / 2000, ODOM_SCALE_L_PERMILLE);
+    const int8_t r = pct(v_ + w_ * ODOM_TRACK_MM / 2000, ODOM_SCALE_R_PERMILLE);
+    if (l == left_ && r == right_) return false;
+    left = left_ = l;
+    right = right_ = r;
+    return true;
+  }
+
+private:
+  void ramp(uint32_t dtMs) {
+    const int32_t maxDv = (int32_t)dtMs * TWIST_ACCEL_MM_S2;
+    const int32_t maxDw = (int32_t)dtMs * TWIST_ALPHA_MRAD_S2;
+    const int32_t dv = targetV_ - v_;
+    const int32_t dw = targetW_ - w_;
+    const int64_t adv = abs(dv);
+    const int64_t adw = abs(dw);
+    if (adv <= maxDv && adw <= maxDw) {
+      v_ = targetV_;
+      w_ = targetW_;
+    } else if (adv * maxDw >= adw * maxDv) {
+      // Forward speed is the limiting axis: w follows proportionally
+      v_ += dv > 0 ? maxDv : -maxDv;
+      w_ += (int32_t)((int64_t)dw * maxDv / adv);
+    } else {
+      w_ += dw > 0 ? maxDw : -maxDw;
+      v_ += (int32_t)((int64_t)dv * maxDw / adw);
+    }
+  }
+
+  // Wheel rim speed at 100 % for one wheel (mm/s)
+  static int32_t wheelMax(uint16_t scalePermille) { return (int32_t)ODOM_WHEEL_MM_S_MAX * scalePermille / 1000; }
+
+  // um/s -> -100..100 (rounded)
+  static int8_t pct(int32_t wheelUmS, uint16_t scalePermille) {
+    const int32_t den = wheelMax(scalePermille) * 10;
+    const int32_t p = (wheelUmS + (wheelUmS >= 0 ? den / 2 : -den / 2)) / den;
+    return (int8_t)constrain(p, -100, 100);
+  }
+
+  // Scale (v, w) so neither wheel exceeds its maximum; keeps v/w (the curvature)
+  static void saturate(int16_t& v, int16_t& w) {
+    const int32_t half = (int32_t)w * ODOM_TRACK_MM / 2000;
+    const int32_t l = abs((int32_t)v - half);
+    const int32_t r = abs((int32_t)v + half);
+    const int32_t maxL = wheelMax(ODOM_SCALE_L_PERMILLE);
+    const int32_t maxR = wheelMax(ODOM_SCALE_R_PERMILLE);
+    // Binding wheel = larger share of its own maximum
+    int32_t over = 0;
+    int32_t limit = 0;
+    if ((int64_t)l * maxR >= (int64_t)r * maxL) {
+      over = l;
+      limit = maxL;
+    } else {
+      over = r;
+      limit = maxR;
+    }
+    if (over <= limit) return;
+    v = (int16_t)((int32_t)v * limit / over);
+    w = (int16_t)((int32_t)w * limit / over);
+  }
+
+  int32_t v_ = 0;
+  int32_t w_ = 0;
+  int32_t targetV_ = 0;
+  int32_t targetW_ = 0;
+  uint32_t lastMs_ = 0;
+  int8_t left_ = 0;
+  int8_t right_ = 0;
+  bool running_ = false;
+};
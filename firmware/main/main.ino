@@ -3,13 +3,15 @@
 #include "Config.h"
 #include "TaskRunner.h"
 #include "NetClient.h"
+#include "RtcSnapshot.h"
 
 TaskRunner RUNNER;
 NetClient   NET;
 
 void setup() {
   Serial.begin(115200);
-  delay(50);
+  RtcSnapshot::instance().begin();  // warm path after a watchdog/exception reset
+  if (!RtcSnapshot::instance().warm()) delay(50);
   Serial.println("\n[BOOT] robot-max-controller (optimized)");
 
   RUNNER.begin();
@@ -19,4 +21,5 @@ void setup() {
 void loop() {
   NET.loop();
   RUNNER.loop();
+  RUNNER.idle(NET.idleBlocked());  // parked: sleep to the next device tick
 }
@@ -1,7 +1,18 @@
 // server/src/api.ts
 import express from 'express';
 import { z } from 'zod';
+import { GROUP_DEFAULT_LEAD_MS } from './config';
 import { AnyTask, deviceIdSchema, taskUnionSchema } from './models';
+import {
+  BUILTIN_MACROS,
+  MACRO_MAX_STEPS,
+  MACRO_SLOTS,
+  encodeMacro,
+  findMacro,
+  fnv1a,
+  macroStepSchema,
+} from './macros';
+import { BUILTIN_BEHAVIORS, BehaviorAsmError, assembleBehavior, findBehavior } from './behaviors';
 import { WsHub } from './wsHub';
 import { httpLog } from './logger';
 
@@ -10,10 +21,54 @@ const tasksPayloadSchema = z.object({
   tasks: z.array(taskUnionSchema).min(1),
 });
 
+// Synchronised start: one task per device; at = server epoch ms (default: now + lead)
+const groupPayloadSchema = z.object({
+  tasks: z
+    .array(taskUnionSchema)
+    .min(1)
+    .max(3)
+    .refine((tasks) => new Set(tasks.map((t) => t.device)).size === tasks.length, {
+      message: 'one task per device',
+    }),
+  at: z.number().int().positive().optional(),
+  delayMs: z.number().int().min(0).max(10_000).optional(),
+});
+
 const cancelPayloadSchema = z.object({
   device: deviceIdSchema,
 });
 
+const macroRunSchema = z.object({
+  macro: z.union([z.string().min(1), z.number().int().min(0).max(MACRO_SLOTS - 1)]),
+  scale: z.number().int().min(0).max(200).optional(),
+  mirror: z.boolean().optional(),
+});
+
+const macroDefSchema = z.object({
+  id: z.number().int().min(0).max(MACRO_SLOTS - 1),
+  name: z.string().min(1),
+  steps: z.array(macroStepSchema).min(1).max(MACRO_MAX_STEPS),
+});
+
+// Behaviour program: a built-in by name, or assembly source (behaviors.ts syntax)
+const behaviorRunSchema = z
+  .object({
+    behavior: z.string().min(1).optional(),
+    source: z.string().min(1).max(8_000).optional(),
+    run: z.boolean().optional(),
+  })
+  .refine((b) => (b.behavior === undefined) !== (b.source === undefined), {
+    message: 'expected behavior or source',
+  });
+
+// ESP server list (firmware EndpointList: EP_MAX entries, host < 32 chars, port required
+// so the hash in the ESP hello matches); [] = stop managing it
+const endpointsSchema = z.object({
+  endpoints: z
+    .array(z.string().regex(/^[^\s:,]{1,31}:\d{1,5}$/, 'expected host:port'))
+    .max(4),
+});
+
 // ---- Helpers ----
 function normalizeTasks(tasks: z.infer<typeof taskUnionSchema>[]) {
   // Ensure enqueue flag always present (default false)
@@ -95,6 +150,27 @@ export function buildRouter(wsHub: WsHub): express.Router {
     }
   });
 
+  // Group = start tasks of several devices in the same ESP control tick
+  router.post('/robot/tasks/group', (req, res, next) => {
+    try {
+      const parsed = groupPayloadSchema.parse(req.body);
+      const tasks = withUniqueIds(
+        normalizeTasks(parsed.tasks).map((t) => clampLR(t)),
+        'replace'
+      );
+      const at = parsed.at ?? Date.now() + (parsed.delayMs ?? GROUP_DEFAULT_LEAD_MS);
+      const sent = wsHub.sendTaskGroup(tasks, at);
+      if (!sent) {
+        res.status(503).json({ error: 'esp_offline' });
+        return;
+      }
+      httpLog(`POST /robot/tasks/group grp=${sent.grp} (${tasks.length} tasks) at=${at}`);
+      res.status(202).json({ status: 'scheduled', ...sent, count: tasks.length });
+    } catch (err) {
+      next(err);
+    }
+  });
+
   // Cancel device's current task/queue
   router.post('/robot/tasks/cancel', (req, res, next) => {
     try {
@@ -107,6 +183,120 @@ export function buildRouter(wsHub: WsHub): express.Router {
     }
   });
 
+  // Macros: list (with upload state on the ESP), define/override, run by name or id
+  router.get('/robot/macros', (_req, res) => {
+    const espHashes = wsHub.getMacroHashes();
+    res.json(
+      BUILTIN_MACROS.map((m) => {
+        const hash = fnv1a(encodeMacro(m.steps));
+        return { id: m.id, name: m.name, steps: m.steps.length, hash, onDevice: espHashes[m.id] === hash };
+      })
+    );
+  });
+
+  router.post('/robot/macros', (req, res, next) => {
+    try {
+      const def = macroDefSchema.parse(req.body);
+      const existing = BUILTIN_MACROS.findIndex((m) => m.id === def.id);
+      if (existing >= 0) BUILTIN_MACROS.splice(existing, 1);
+      BUILTIN_MACROS.push(def);
+      httpLog(`POST /robot/macros id=${def.id} name=${def.name} steps=${def.steps.length}`);
+      res.status(201).json({ status: 'defined', id: def.id, name: def.name });
+    } catch (err) {
+      next(err);
+    }
+  });
+
+  router.post('/robot/macros/run', (req, res, next) => {
+    try {
+      const parsed = macroRunSchema.parse(req.body);
+      const macro = findMacro(parsed.macro);
+      if (!macro) {
+        res.status(404).json({ error: 'unknown_macro', macro: parsed.macro });
+        return;
+      }
+      const { uploaded } = wsHub.runMacro(macro, parsed.scale ?? 100, parsed.mirror ?? false);
+      httpLog(`POST /robot/macros/run ${macro.name} (id=${macro.id}) uploaded=${uploaded}`);
+      res.status(202).json({ status: 'queued', id: macro.id, name: macro.name, uploaded });
+    } catch (err) {
+      next(err);
+    }
+  });
+
+  // Behaviour programs for the onboard VM: list built-ins, load (and run), stop
+  router.get('/robot/behaviors', (_req, res) => {
+    res.json(
+      BUILTIN_BEHAVIORS.map((b) => {
+        const code = assembleBehavior(b.source);
+        return { name: b.name, size: code.length, hash: fnv1a(code), code: code.toString('hex') };
+      })
+    );
+  });
+
+  router.post('/robot/behaviors/run', (req, res, next) => {
+    try {
+      const parsed = behaviorRunSchema.parse(req.body);
+      const def = parsed.behavior !== undefined ? findBehavior(parsed.behavior) : undefined;
+      if (parsed.behavior !== undefined && !def) {
+        res.status(404).json({ error: 'unknown_behavior', behavior: parsed.behavior });
+        return;
+      }
+      const name = def ? def.name : 'custom';
+      let code: Buffer;
+      try {
+        code = assembleBehavior(def ? def.source : parsed.source!);
+      } catch (err) {
+        if (!(err instanceof BehaviorAsmError)) throw err;
+        res.status(400).json({ error: 'assembly_failed', line: err.line, message: err.message });
+        return;
+      }
+      if (!wsHub.loadBehavior(name, code, parsed.run ?? true)) {
+        res.status(503).json({ error: 'esp_offline' });
+        return;
+      }
+      httpLog(`POST /robot/behaviors/run ${name} (${code.length} bytes)`);
+      res.status(202).json({ status: 'sent', name, size: code.length, hash: fnv1a(code) });
+    } catch (err) {
+      next(err);
+    }
+  });
+
+  router.post('/robot/behaviors/stop', (_req, res) => {
+    if (!wsHub.stopBehavior()) {
+      res.status(503).json({ error: 'esp_offline' });
+      return;
+    }
+    httpLog('POST /robot/behaviors/stop');
+    res.status(202).json({ status: 'sent' });
+  });
+
+  // Zero the on-board odometry pose
+  router.post('/robot/pose/reset', (_req, res) => {
+    if (!wsHub.sendPoseReset()) {
+      res.status(503).json({ error: 'esp_offline' });
+      return;
+    }
+    httpLog('POST /robot/pose/reset');
+    res.status(202).json({ status: 'sent' });
+  });
+
+  // Server list of the ESP (priority order) for failover; stored in ESP flash
+  router.get('/robot/endpoints', (_req, res) => {
+    res.json({ endpoints: wsHub.getEndpoints() });
+  });
+
+  router.post('/robot/endpoints', (req, res, next) => {
+    try {
+      const parsed = endpointsSchema.parse(req.body);
+      const sent = wsHub.setEndpoints(parsed.endpoints);
+      httpLog(`POST /robot/endpoints ${parsed.endpoints.join(',') || '(unmanaged)'} sent=${sent}`);
+      const status = !parsed.endpoints.length ? 'unmanaged' : sent ? 'sent' : 'pending';
+      res.status(202).json({ status, endpoints: parsed.endpoints });
+    } catch (err) {
+      next(err);
+    }
+  });
+
   // Status
   router.get('/robot/status', (_req, res) => {
     const status = wsHub.getStatus();
@@ -0,0 +1,256 @@
+/**
+ * Behaviour programs - small bytecode programs run by the ESP's onboard VM
+ * (behavior.load), so "drive until X, then turn" is decided on the device tick
+ * instead of one Wi-Fi round-trip per decision.
+ * Encoding must match firmware/main/BehaviorVm.h; the ESP verifies every program
+ * (stack depth, jump targets, operands) before it runs.
+ *
+ * Assembly: one instruction per line, `label:` lines, `;` comments.
+ *   push <int>          (PUSH8/16/32 chosen by range)
+ *   load <n> / store <n> (locals 0..BEH_LOCALS-1)
+ *   in <sensor>          (name from SENSORS or index)
+ *   jmp|jz|jnz <label>
+ */
+
+export const BEH_CODE_MAX = 160;
+export const BEH_LOCALS = 8;
+
+const OPS: Record<string, number> = {
+  halt: 0x00,
+  yield: 0x01,
+  sleep: 0x02,
+  dup: 0x15,
+  drop: 0x16,
+  swap: 0x17,
+  over: 0x18,
+  add: 0x20,
+  sub: 0x21,
+  mul: 0x22,
+  div: 0x23,
+  mod: 0x24,
+  neg: 0x25,
+  abs: 0x26,
+  min: 0x27,
+  max: 0x28,
+  eq: 0x30,
+  lt: 0x31,
+  gt: 0x32,
+  not: 0x33,
+  and: 0x34,
+  or: 0x35,
+  angdiff: 0x38,
+  drive: 0x60,
+  stop: 0x61,
+  arm: 0x62,
+  neck: 0x63,
+};
+
+const PUSH8 = 0x10;
+const PUSH16 = 0x11;
+const PUSH32 = 0x12;
+const LOAD = 0x13;
+const STORE = 0x14;
+const JUMPS: Record<string, number> = { jmp: 0x40, jz: 0x41, jnz: 0x42 };
+const IN = 0x50;
+
+const has = (table: Record<string, number>, key: string) => Object.prototype.hasOwnProperty.call(table, key);
+
+export const SENSORS = [
+  't_ms',
+  'x_mm',
+  'y_mm',
+  'heading_cdeg',
+  'v_mms',
+  'w_mrads',
+  'wheel_l',
+  'wheel_r',
+  'arm_busy',
+  'neck_busy',
+] as const;
+
+export interface BehaviorDef {
+  name: string;
+  source: string;
+}
+
+export class BehaviorAsmError extends Error {
+  constructor(
+    message: string,
+    readonly line: number
+  ) {
+    super(`line ${line}: ${message}`);
+  }
+}
+
+export const BUILTIN_BEHAVIORS: BehaviorDef[] = [
+  {
+    // 500 mm straight, then 90 deg left (odometry pose)
+    name: 'leg',
+    source: `
+      in x_mm
+      store 0
+      in y_mm
+      store 1
+      in heading_cdeg
+      store 2
+      push 50
+      push 50
+      drive
+    fwd:                  ; until dx^2 + dy^2 >= 500^2
+      in x_mm
+      load 0
+      sub
+      dup
+      mul
+      in y_mm
+      load 1
+      sub
+      dup
+      mul
+      add
+      push 250000
+      lt
+      jz turn
+      yield
+      jmp fwd
+    turn:
+      push -40
+      push 40
+      drive
+    spin:                 ; until 90 deg CCW from the start heading
+      in heading_cdeg
+      load 2
+      angdiff
+      push 9000
+      lt
+      jz done
+      yield
+      jmp spin
+    done:
+      stop
+      halt
+    `,
+  },
+  {
+    // Neck sweep, waiting for each move to finish
+    name: 'scan',
+    source: `
+      push 30
+      neck
+      push 150
+      store 0
+    wait:
+      in neck_busy
+      jz next
+      yield
+      jmp wait
+    next:
+      load 0
+      jz home
+      load 0
+      neck
+      push 0
+      store 0
+      jmp wait
+    home:
+      push 90
+      neck
+      halt
+    `,
+  },
+];
+
+interface Line {
+  op: string;
+  arg?: string;
+  line: number;
+  offset: number;
+}
+
+function parseInteger(text: string | undefined, line: number): number {
+  if (text === undefined || !/^-?(0x[0-9a-f]+|\d+)$/i.test(text)) {
+    throw new BehaviorAsmError(`expected an integer, got '${text ?? ''}'`, line);
+  }
+  const value = text.startsWith('-') ? -Number(text.slice(1)) : Number(text);
+  if (value < -0x8000_0000 || value > 0x7fff_ffff) throw new BehaviorAsmError(`${text} out of int32 range`, line);
+  return value;
+}
+
+function pushOpcode(value: number): number {
+  if (value >= -128 && value <= 127) return PUSH8;
+  if (value >= -32768 && value <= 32767) return PUSH16;
+  return PUSH32;
+}
+
+function sizeOf(op: string, arg: string | undefined, line: number): number {
+  if (op === 'push') {
+    const code = pushOpcode(parseInteger(arg, line));
+    return code === PUSH8 ? 2 : code === PUSH16 ? 3 : 5;
+  }
+  if (op === 'load' || op === 'store' || op === 'in') return 2;
+  if (has(JUMPS, op)) return 3;
+  if (has(OPS, op)) return 1;
+  throw new BehaviorAsmError(`unknown instruction '${op}'`, line);
+}
+
+/** Two passes: sizes + labels, then bytes. Throws BehaviorAsmError. */
+export function assembleBehavior(source: string): Buffer {
+  const labels = new Map<string, number>();
+  const lines: Line[] = [];
+  let offset = 0;
+  source.split('\n').forEach((raw, i) => {
+    const line = i + 1;
+    let text = raw.replace(/;.*$/, '').trim().toLowerCase();
+    const label = /^([a-z_][a-z0-9_]*):/.exec(text);
+    if (label) {
+      if (labels.has(label[1])) throw new BehaviorAsmError(`duplicate label '${label[1]}'`, line);
+      labels.set(label[1], offset);
+      text = text.slice(label[0].length).trim();
+    }
+    if (!text) return;
+    const [op, arg, extra] = text.split(/\s+/);
+    if (extra !== undefined) throw new BehaviorAsmError(`unexpected '${extra}'`, line);
+    lines.push({ op, arg, line, offset });
+    offset += sizeOf(op, arg, line);
+  });
+  if (offset === 0 || offset > BEH_CODE_MAX) {
+    const last = lines.length ? lines[lines.length - 1].line : 1;
+    throw new BehaviorAsmError(`program is ${offset} bytes (1..${BEH_CODE_MAX})`, last);
+  }
+
+  const buf = Buffer.alloc(offset);
+  for (const { op, arg, line, offset: o } of lines) {
+    if (op === 'push') {
+      const value = parseInteger(arg, line);
+      const code = pushOpcode(value);
+      buf.writeUInt8(code, o);
+      if (code === PUSH8) buf.writeInt8(value, o + 1);
+      else if (code === PUSH16) buf.writeInt16LE(value, o + 1);
+      else buf.writeInt32LE(value, o + 1);
+    } else if (op === 'load' || op === 'store') {
+      const index = parseInteger(arg, line);
+      if (index < 0 || index >= BEH_LOCALS) throw new BehaviorAsmError(`local ${index} out of range`, line);
+      buf.writeUInt8(op === 'load' ? LOAD : STORE, o);
+      buf.writeUInt8(index, o + 1);
+    } else if (op === 'in') {
+      const named = SENSORS.indexOf(arg as (typeof SENSORS)[number]);
+      const sensor = named >= 0 ? named : /^\d+$/.test(arg ?? '') ? Number(arg) : -1;
+      if (sensor < 0 || sensor >= SENSORS.length) throw new BehaviorAsmError(`unknown sensor '${arg}'`, line);
+      buf.writeUInt8(IN, o);
+      buf.writeUInt8(sensor, o + 1);
+    } else if (has(JUMPS, op)) {
+      const target = arg !== undefined ? labels.get(arg) : undefined;
+      if (target === undefined) throw new BehaviorAsmError(`unknown label '${arg ?? ''}'`, line);
+      buf.writeUInt8(JUMPS[op], o);
+      buf.writeUInt16LE(target, o + 1);
+    } else {
+      if (arg !== undefined) throw new BehaviorAsmError(`'${op}' takes no operand`, line);
+      buf.writeUInt8(OPS[op], o);
+    }
+  }
+  return buf;
+}
+
+export function findBehavior(name: string): BehaviorDef | undefined {
+  return BUILTIN_BEHAVIORS.find((b) => b.name === name);
+}
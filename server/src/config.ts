@@ -12,5 +12,65 @@ export const WS_PERMESSAGE_DEFLATE = false;// disable compression for low CPU/la
 // Queue & safety
 export const MAX_QUEUE_PER_DEVICE = 32;
 
+// Task stream flow control (credit window advertised by the ESP)
+export const FLOW_MAX_TASKS_PER_ENVELOPE = 3; // ESP parses into a 512-byte JSON document
+export const FLOW_ACK_STALL_MS = 2000;        // warn if in-flight tasks stay unacked this long
+
+// Motion lease: while the UI holds a non-zero drive, renew a short lease instead of
+// re-sending the drive command. ESP hard-stops when the lease runs out.
+export const LEASE_TTL_MS = 600;   // ~3 renewals may be lost before the ESP stops
+export const LEASE_RENEW_MS = 200; // also the drive refresh period for firmware without leases
+
+// Binary emergency-stop frame (firmware Protocol::BIN_STOP). Handled by the ESP before
+// any JSON parsing; older firmware ignores binary frames. With the UDP channel on it
+// carries the seq of the last stop datagram (LE32): drive datagrams sent before the stop
+// are then stale on the ESP even if they arrive after it.
+export const ESP_BIN_STOP = 0x01;
+
+// Binary telemetry (ESP -> server, firmware Protocol::BIN_TELEMETRY): offered in the
+// server hello as tlm = 1; the ESP then sends progress/wheels/pose/stats as delta records.
+export const TLM_BINARY = true;
+export const ESP_BIN_TELEMETRY = 0x10;
+
+// UDP drive channel: the ESP offers its port in hello (`udp`), the server answers with a
+// `udp` envelope carrying a session token, then sends drive/stop/lease as datagrams
+// (firmware Protocol::UDP_DRIVE). Newest seq wins on the ESP, so a lost datagram never
+// holds back later ones; WS still carries tasks, telemetry and session control.
+export const UDP_DRIVE = process.env.UDP_DRIVE !== '0';
+export const ESP_UDP_DRIVE = 0x20;
+export const UDP_STOP_REPEAT = 3; // stop datagrams per stop; the lease TTL is the backstop
+
+// Link quality: drive intents are forwarded at most at the rate the ESP advises in its
+// `link` envelope (newest wins, stops pass at once); a debounced task.replace is held
+// back (still coalescing) while the ESP socket has this much unsent data queued.
+export const LINK_DEFAULT_CMD_HZ = 20;
+export const WS_BACKLOG_MAX_BYTES = 4096;
+
+// Synchronised start (task.group): the ESP clock offset is the minimum of
+// (receive time - ESP t) over the last probes, so it includes the smallest one-way
+// delay seen. Groups without a start time start this long after the request.
+export const CLOCK_OFFSET_SAMPLES = 16;
+export const GROUP_DEFAULT_LEAD_MS = 200;
+export const GROUP_LATE_WARN_MS = 50; // ESP released the group this much after `at`
+
+// Twist drive (UI `twist` intent: v m/s, w rad/s, CCW positive). Mixed into wheel
+// speeds on the ESP, which also limits acceleration and keeps the curvature when a
+// wheel saturates; the server only clamps obviously bad input.
+export const TWIST_MAX_V = 2; // m/s
+export const TWIST_MAX_W = 10; // rad/s
+
+// Server list managed on the ESP (firmware EndpointList): "host:port,host:port" by
+// priority. Pushed when the list hash in the ESP hello differs; empty = the ESP keeps
+// its own list. For two local instances: PORT=8080 and PORT=8081, both with
+// ESP_ENDPOINTS=<pc-ip>:8080,<pc-ip>:8081.
+export const ESP_ENDPOINTS = (process.env.ESP_ENDPOINTS || '')
+  .split(',')
+  .map((e) => e.trim())
+  .filter((e) => e.length > 0);
+
+// Optional drive trace for the firmware control-loop bench (firmware/bench):
+// appends "t_ms,left,right" per applied drive command. Disabled when unset.
+export const DRIVE_TRACE_FILE = process.env.DRIVE_TRACE_FILE || '';
+
 export const JWT_DISABLED = true;
 export const LOCAL_SIMULATION = false;
@@ -3,7 +3,10 @@
  * Acts as a bridge between DriveRelay and existing WsHub
  */
 
-import { DriveIntent } from './driveRelay';
+import fs from 'fs';
+import { DRIVE_TRACE_FILE, LEASE_RENEW_MS, LEASE_TTL_MS } from './config';
+import { MotionIntent, TwistIntent } from './driveRelay';
+import { WheelsTask } from './models';
 import { WsHub } from './wsHub';
 import { taskLog } from './logger';
 
@@ -12,6 +15,12 @@ export class DeviceAdapter {
   private lastSeq = 0;
   private lastAppliedLeft = 0;
   private lastAppliedRight = 0;
+  // Twist held on the ESP (it mixes and ramps it); a drive afterwards is never deduped
+  private twistActive = false;
+  private lastTwistV = 0;
+  private lastTwistW = 0;
+  private leaseTimer?: NodeJS.Timeout;
+  private traceStartMs = 0;
 
   constructor(wsHub: WsHub) {
     this.wsHub = wsHub;
@@ -19,9 +28,9 @@ export class DeviceAdapter {
 
   /**
    * Handle drive intent from DriveRelay
-   * Convert to legacy task format for ESP
+   * Convert to legacy task format for ESP (twist goes out as-is, see applyTwist)
    */
-  handleDriveIntent(intent: DriveIntent): void {
+  handleDriveIntent(intent: MotionIntent): void {
     // Seq monotonicity check
     if (intent.seq <= this.lastSeq) {
       taskLog(`Dropping out-of-order packet: seq=${intent.seq} <= ${this.lastSeq}`);
@@ -29,30 +38,147 @@ export class DeviceAdapter {
     }
     this.lastSeq = intent.seq;
 
-    // Convert normalized [-1..1] to percentage [-100..100]
-    const leftPct = Math.round(intent.left * 100);
-    const rightPct = Math.round(intent.right * 100);
+    if (intent.type === 'twist' && (intent.v !== 0 || intent.w !== 0)) {
+      this.applyTwist(intent);
+      return;
+    }
+
+    // Convert normalized [-1..1] to percentage [-100..100] (a zero twist stops like drive 0)
+    const leftPct = intent.type === 'drive' ? Math.round(intent.left * 100) : 0;
+    const rightPct = intent.type === 'drive' ? Math.round(intent.right * 100) : 0;
+    const wasTwist = this.twistActive;
+    this.twistActive = false;
 
-    // Dedupe: skip if same as last applied
-    if (leftPct === this.lastAppliedLeft && rightPct === this.lastAppliedRight) {
+    // Motion lease covers a held joystick; released (left to expire) at rest
+    if (leftPct !== 0 || rightPct !== 0) {
+      this.startLease();
+    } else {
+      this.stopLease();
+      // Stop skips the replace debounce; the drive 0 below keeps task state in sync
+      if (this.lastAppliedLeft !== 0 || this.lastAppliedRight !== 0 || wasTwist) {
+        this.wsHub.sendEmergencyStop();
+      }
+    }
+
+    // Dedupe: skip if same as last applied (the lease keeps the ESP moving)
+    if (!wasTwist && leftPct === this.lastAppliedLeft && rightPct === this.lastAppliedRight) {
       return;
     }
 
     this.lastAppliedLeft = leftPct;
     this.lastAppliedRight = rightPct;
+    this.traceDrive();
+
+    // UDP channel: newest-wins datagram (carries the lease), no TCP head-of-line blocking
+    if (this.wsHub.sendUdpDrive(leftPct, rightPct, LEASE_TTL_MS)) return;
 
-    // Convert to legacy task format
-    const task = {
-      device: 'wheels' as const,
-      type: 'drive' as const,
-      left: leftPct,
-      right: rightPct,
-      taskId: `drive-seq${intent.seq}`,
+    // Send via legacy replace (clears queue, applies immediately)
+    this.wsHub.sendReplaceTasks([this.driveTask()]);
+  }
+
+  /**
+   * Twist (m/s, rad/s -> mm/s, mrad/s): the ESP mixes it with its own track geometry and
+   * acceleration limits, so only changes are sent and the lease keeps it alive
+   */
+  private applyTwist(intent: TwistIntent): void {
+    if (!this.wsHub.supportsTwist()) {
+      taskLog('Twist ignored: ESP firmware does not support twist');
+      return;
+    }
+    const v = Math.round(intent.v * 1000);
+    const w = Math.round(intent.w * 1000);
+    this.startLease();
+    if (this.twistActive && v === this.lastTwistV && w === this.lastTwistW) return;
+    this.twistActive = true;
+    this.lastTwistV = v;
+    this.lastTwistW = w;
+    this.wsHub.sendTwist(v, w);
+  }
+
+  /**
+   * Convert to legacy task format
+   */
+  private driveTask(): WheelsTask {
+    return {
+      device: 'wheels',
+      type: 'drive',
+      left: this.lastAppliedLeft,
+      right: this.lastAppliedRight,
+      taskId: `drive-seq${this.lastSeq}`,
       durationMs: 0, // Continuous until next command
     };
+  }
 
-    // Send via legacy replace (clears queue, applies immediately)
-    this.wsHub.sendReplaceTasks([task]);
+  /**
+   * Record applied drive commands for replay in firmware/bench (DRIVE_TRACE_FILE)
+   */
+  private traceDrive(): void {
+    if (!DRIVE_TRACE_FILE) return;
+    const now = Date.now();
+    if (!this.traceStartMs) {
+      this.traceStartMs = now;
+      fs.appendFile(DRIVE_TRACE_FILE, `# drive trace ${new Date(now).toISOString()}\n`, () => {});
+    }
+    const line = `${now - this.traceStartMs},${this.lastAppliedLeft},${this.lastAppliedRight}\n`;
+    fs.appendFile(DRIVE_TRACE_FILE, line, (err) => {
+      if (err) taskLog(`Drive trace write failed: ${err.message}`);
+    });
+  }
+
+  private startLease(): void {
+    if (this.leaseTimer) return;
+    this.renewLease();
+    this.leaseTimer = setInterval(() => this.renewLease(), LEASE_RENEW_MS);
+  }
+
+  private stopLease(): void {
+    if (!this.leaseTimer) return;
+    clearInterval(this.leaseTimer);
+    this.leaseTimer = undefined;
+  }
+
+  private renewLease(): void {
+    if (!this.wsHub.isEspConnected()) return;
+    // Twist-capable firmware always has leases; never re-send a stale drive over it
+    if (this.twistActive) {
+      this.wsHub.sendLease(LEASE_TTL_MS);
+      return;
+    }
+    if (this.wsHub.supportsUdpDrive()) {
+      // Re-send the held value: renews the lease and repairs a lost datagram
+      if (this.lastAppliedLeft !== 0 || this.lastAppliedRight !== 0) {
+        this.wsHub.sendUdpDrive(this.lastAppliedLeft, this.lastAppliedRight, LEASE_TTL_MS);
+      }
+      return;
+    }
+    if (this.wsHub.sendLease(LEASE_TTL_MS)) return;
+    // Firmware without leases hard-stops 400ms after the last drive command:
+    // re-send the held value instead of letting dedupe starve it
+    if (this.lastAppliedLeft !== 0 || this.lastAppliedRight !== 0) {
+      this.wsHub.sendReplaceTasks([this.driveTask()]);
+    }
+  }
+
+  /**
+   * ESP came back (failover or reconnect) still moving on the lease of its last session.
+   * A drive/twist held here takes over: re-sent in full, since the ESP may have been
+   * driven by another server. Nothing held: revoke the lease so it stops now.
+   */
+  resume(leaseMs: number): void {
+    if (!this.leaseTimer) {
+      taskLog(`Resume: no drive held here, revoking the ESP's ${leaseMs}ms lease`);
+      this.wsHub.sendLease(0);
+      return;
+    }
+    taskLog(`Resume: re-sending the held drive (ESP lease ${leaseMs}ms left)`);
+    if (this.twistActive) {
+      this.wsHub.sendTwist(this.lastTwistV, this.lastTwistW);
+      this.wsHub.sendLease(LEASE_TTL_MS);
+      return;
+    }
+    if (this.wsHub.sendUdpDrive(this.lastAppliedLeft, this.lastAppliedRight, LEASE_TTL_MS)) return;
+    this.wsHub.sendReplaceTasks([this.driveTask()]);
+    this.wsHub.sendLease(LEASE_TTL_MS);
   }
 
   /**
@@ -62,6 +188,9 @@ export class DeviceAdapter {
     this.lastSeq = 0;
     this.lastAppliedLeft = 0;
     this.lastAppliedRight = 0;
+    this.twistActive = false;
+    this.traceStartMs = 0;
+    this.stopLease();
   }
 }
 
@@ -4,7 +4,9 @@
  */
 
 import WebSocket from 'ws';
+import { LINK_DEFAULT_CMD_HZ, TWIST_MAX_V, TWIST_MAX_W } from './config';
 import { wsLog, taskLog } from './logger';
+import { LinkStats, OdomSample } from './models';
 
 export interface DriveIntent {
   type: 'drive';
@@ -14,13 +16,24 @@ export interface DriveIntent {
   ts: number;     // uint32 ms since UI load
 }
 
+// Higher-level alternative to tank drive: body velocity, mixed into wheel speeds on the ESP
+export interface TwistIntent {
+  type: 'twist';
+  v: number;    // forward speed, m/s
+  w: number;    // yaw rate, rad/s, CCW positive
+  seq: number;  // uint32 (same sequence as drive)
+  ts: number;   // uint32 ms since UI load
+}
+
+export type MotionIntent = DriveIntent | TwistIntent;
+
 interface HelloMessage {
   type: 'hello';
   role: 'ui' | 'device';
   version: string;
 }
 
-type ClientMessage = DriveIntent | HelloMessage;
+type ClientMessage = MotionIntent | HelloMessage;
 
 interface Client {
   socket: WebSocket;
@@ -34,7 +47,13 @@ export class DriveRelay {
   private lastUIPacketAt = 0;
   private synthSeq = 0;
   private watchdogTimer?: NodeJS.Timeout;
-  private onDriveIntentCallback?: (intent: DriveIntent) => void;
+  private onDriveIntentCallback?: (intent: MotionIntent) => void;
+
+  // Link-adaptive forwarding: at most cmdHz intents/s to the robot, newest wins
+  private cmdHz = LINK_DEFAULT_CMD_HZ;
+  private lastForwardAt = 0;
+  private heldIntent?: MotionIntent;
+  private heldTimer?: NodeJS.Timeout;
 
   private readonly UI_TIMEOUT_MS = 300;
   private readonly WATCHDOG_INTERVAL_MS = 50;
@@ -44,9 +63,9 @@ export class DriveRelay {
   }
 
   /**
-   * Set callback for when drive intent is received
+   * Set callback for when drive (or twist) intent is received
    */
-  onDriveIntent(callback: (intent: DriveIntent) => void): void {
+  onDriveIntent(callback: (intent: MotionIntent) => void): void {
     this.onDriveIntentCallback = callback;
   }
 
@@ -70,7 +89,7 @@ export class DriveRelay {
 
       if (msg.type === 'hello') {
         this.handleHello(socket, msg);
-      } else if (msg.type === 'drive') {
+      } else if (msg.type === 'drive' || msg.type === 'twist') {
         this.handleDriveIntent(socket, msg);
       }
     } catch (err) {
@@ -96,6 +115,15 @@ export class DriveRelay {
       );
     }
 
+    if (msg.type === 'twist') {
+      return (
+        Number.isFinite(msg.v) &&
+        Number.isFinite(msg.w) &&
+        typeof msg.seq === 'number' &&
+        typeof msg.ts === 'number'
+      );
+    }
+
     return false;
   }
 
@@ -118,7 +146,7 @@ export class DriveRelay {
     });
   }
 
-  private handleDriveIntent(socket: WebSocket, intent: DriveIntent): void {
+  private handleDriveIntent(socket: WebSocket, intent: MotionIntent): void {
     const client = this.clients.get(socket);
     if (!client || client.role !== 'ui') {
       wsLog('Drive intent from non-UI client, ignored');
@@ -130,9 +158,6 @@ export class DriveRelay {
       return;
     }
 
-    // Validate and clamp
-    const left = this.clamp(intent.left, -1, 1);
-    const right = this.clamp(intent.right, -1, 1);
 
     // Check staleness
     const age = Date.now() - intent.ts;
@@ -144,23 +169,85 @@ export class DriveRelay {
     this.lastUIPacketAt = Date.now();
     client.lastSeenAt = Date.now();
 
+    // Validate and clamp
+    const forwarded: MotionIntent =
+      intent.type === 'twist'
+        ? {
+            type: 'twist',
+            v: this.clamp(intent.v, -TWIST_MAX_V, TWIST_MAX_V),
+            w: this.clamp(intent.w, -TWIST_MAX_W, TWIST_MAX_W),
+            seq: intent.seq,
+            ts: intent.ts,
+          }
+        : {
+            type: 'drive',
+            left: this.clamp(intent.left, -1, 1),
+            right: this.clamp(intent.right, -1, 1),
+            seq: intent.seq,
+            ts: intent.ts,
+          };
+
+    // Weak link: hold the newest intent until the advised interval has passed
+    // (a stop is never held)
+    const wait = this.lastForwardAt + 1000 / this.cmdHz - Date.now();
+    if (wait > 0 && !this.isStop(forwarded)) {
+      this.heldIntent = forwarded;
+      if (!this.heldTimer) {
+        this.heldTimer = setTimeout(() => this.forwardHeld(), wait);
+      }
+      return;
+    }
+    this.forward(forwarded);
+  }
+
+  private forward(intent: MotionIntent): void {
+    this.heldIntent = undefined;
+    if (this.heldTimer) {
+      clearTimeout(this.heldTimer);
+      this.heldTimer = undefined;
+    }
+    this.lastForwardAt = Date.now();
+
     // Forward to all devices
-    const forwarded: DriveIntent = {
-      type: 'drive',
-      left,
-      right,
-      seq: intent.seq,
-      ts: intent.ts,
-    };
+    this.broadcastToDevices(intent);
 
-    this.broadcastToDevices(forwarded);
-    
     // Call callback for device adapter
     if (this.onDriveIntentCallback) {
-      this.onDriveIntentCallback(forwarded);
+      this.onDriveIntentCallback(intent);
+    }
+
+    if (intent.type === 'twist') {
+      taskLog(`Twist: v=${intent.v.toFixed(2)} w=${intent.w.toFixed(2)} seq=${intent.seq}`);
+    } else {
+      taskLog(`Drive: L=${intent.left.toFixed(2)} R=${intent.right.toFixed(2)} seq=${intent.seq}`);
+    }
+  }
+
+  private isStop(intent: MotionIntent): boolean {
+    return intent.type === 'twist' ? intent.v === 0 && intent.w === 0 : intent.left === 0 && intent.right === 0;
+  }
+
+  private forwardHeld(): void {
+    this.heldTimer = undefined;
+    if (this.heldIntent) this.forward(this.heldIntent);
+  }
+
+  /**
+   * Link quality from the ESP: adopt its advised command rate and tell UI clients,
+   * so they can stream slower instead of piling up intents that get dropped here
+   */
+  setLinkAdvice(link: LinkStats): void {
+    const hz = Math.max(1, link.hz || LINK_DEFAULT_CMD_HZ);
+    if (hz !== this.cmdHz) {
+      wsLog(`Drive forwarding ${this.cmdHz} -> ${hz} cmd/s (link q=${link.q})`);
+      this.cmdHz = hz;
+    }
+    const msg = { type: 'link', q: link.q, hz, rssi: link.rssi, rtt: link.rtt, mode: link.mode };
+    for (const [socket, client] of this.clients) {
+      if (client.role === 'ui') {
+        this.send(socket, msg);
+      }
     }
-    
-    taskLog(`Drive: L=${left.toFixed(2)} R=${right.toFixed(2)} seq=${intent.seq}`);
   }
 
   private handleDisconnect(socket: WebSocket): void {
@@ -201,17 +288,23 @@ export class DriveRelay {
       seq: ++this.synthSeq + 1000000, // High seq to override
       ts: Date.now(),
     };
-    this.broadcastToDevices(stop);
-    
-    // Call callback for device adapter
-    if (this.onDriveIntentCallback) {
-      this.onDriveIntentCallback(stop);
-    }
-    
+    this.forward(stop);
     taskLog('Synthesized STOP');
   }
 
-  private broadcastToDevices(intent: DriveIntent): void {
+  /**
+   * Push the robot's odometry pose to every UI client (no polling needed)
+   */
+  broadcastPose(pose: OdomSample): void {
+    const msg = { type: 'pose', ...pose };
+    for (const [socket, client] of this.clients) {
+      if (client.role === 'ui') {
+        this.send(socket, msg);
+      }
+    }
+  }
+
+  private broadcastToDevices(intent: MotionIntent): void {
     for (const [socket, client] of this.clients) {
       if (client.role === 'device') {
         this.send(socket, intent);
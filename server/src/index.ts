@@ -37,6 +37,21 @@ wsHub.setBrowserConnectionHandler((socket) => {
   driveRelay.handleConnection(socket);
 });
 
+// Odometry pose từ ESP -> UI
+wsHub.setOdometryHandler((pose) => {
+  driveRelay.broadcastPose(pose);
+});
+
+// Link quality từ ESP -> tốc độ chuyển lệnh drive + UI
+wsHub.setLinkHandler((link) => {
+  driveRelay.setLinkAdvice(link);
+});
+
+// ESP resume với lease còn chạy (failover) -> drive đang giữ tiếp quản hoặc thu hồi
+wsHub.setResumeHandler((leaseMs) => {
+  deviceAdapter.resume(leaseMs);
+});
+
 // API routes
 app.use(buildRouter(wsHub));
 
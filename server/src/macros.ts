@@ -0,0 +1,106 @@
+/**
+ * Motion macros - named manoeuvres stored in the ESP's flash (LittleFS).
+ * Uploaded once per content hash (macro.put), then triggered by id (macro.run).
+ * Encoding must match firmware/main/MacroStore.h (6 bytes per step).
+ */
+
+import { z } from 'zod';
+
+export const macroStepSchema = z.discriminatedUnion('device', [
+  z.object({
+    device: z.literal('wheels'),
+    left: z.number().int().min(-100).max(100),
+    right: z.number().int().min(-100).max(100),
+    durationMs: z.number().int().min(0).max(65_535),
+  }),
+  z.object({
+    device: z.enum(['arm', 'neck']),
+    angle: z.number().int().min(0).max(180),
+    durationMs: z.number().int().min(0).max(65_535),
+  }),
+  z.object({
+    device: z.literal('wait'),
+    durationMs: z.number().int().min(0).max(65_535),
+  }),
+]);
+export type MacroStep = z.infer<typeof macroStepSchema>;
+
+export interface MacroDef {
+  id: number; // slot on the ESP (0..MACRO_SLOTS-1)
+  name: string;
+  steps: MacroStep[];
+}
+
+export const MACRO_SLOTS = 8;
+export const MACRO_MAX_STEPS = 24;
+
+const DEVICE_CODES = { wheels: 0, arm: 1, neck: 2, wait: 3 } as const;
+
+export const BUILTIN_MACROS: MacroDef[] = [
+  {
+    id: 0,
+    name: 'spin',
+    steps: [{ device: 'wheels', left: 60, right: -60, durationMs: 1500 }],
+  },
+  {
+    id: 1,
+    name: 'wave',
+    steps: [
+      { device: 'arm', angle: 150, durationMs: 400 },
+      { device: 'arm', angle: 60, durationMs: 400 },
+      { device: 'arm', angle: 150, durationMs: 400 },
+      { device: 'arm', angle: 90, durationMs: 400 },
+    ],
+  },
+  {
+    id: 2,
+    name: 'nod',
+    steps: [
+      { device: 'neck', angle: 60, durationMs: 300 },
+      { device: 'neck', angle: 120, durationMs: 300 },
+      { device: 'neck', angle: 60, durationMs: 300 },
+      { device: 'neck', angle: 90, durationMs: 300 },
+    ],
+  },
+  {
+    id: 3,
+    name: 'wiggle',
+    steps: [
+      { device: 'wheels', left: 40, right: -40, durationMs: 300 },
+      { device: 'wheels', left: -40, right: 40, durationMs: 300 },
+      { device: 'wheels', left: 40, right: -40, durationMs: 300 },
+      { device: 'wheels', left: -40, right: 40, durationMs: 300 },
+      { device: 'wait', durationMs: 100 },
+    ],
+  },
+];
+
+export function encodeMacro(steps: MacroStep[]): Buffer {
+  const buf = Buffer.alloc(steps.length * 6);
+  steps.forEach((step, i) => {
+    const o = i * 6;
+    buf.writeUInt8(DEVICE_CODES[step.device], o);
+    if (step.device === 'wheels') {
+      buf.writeInt8(step.left, o + 1);
+      buf.writeInt8(step.right, o + 2);
+    } else if (step.device === 'arm' || step.device === 'neck') {
+      buf.writeUInt8(step.angle, o + 3);
+    }
+    buf.writeUInt16LE(step.durationMs, o + 4);
+  });
+  return buf;
+}
+
+/** FNV-1a 32-bit (same as MacroStore::fnv1a) */
+export function fnv1a(buf: Buffer): number {
+  let h = 0x811c9dc5;
+  for (const byte of buf) {
+    h ^= byte;
+    h = Math.imul(h, 0x01000193) >>> 0;
+  }
+  return h >>> 0;
+}
+
+export function findMacro(ref: string | number): MacroDef | undefined {
+  return BUILTIN_MACROS.find((m) => (typeof ref === 'number' ? m.id === ref : m.name === ref));
+}
@@ -40,19 +40,155 @@ export const taskUnionSchema = z.union([armTaskSchema, neckTaskSchema, wheelsTas
 export type AnyTask = z.infer<typeof taskUnionSchema>;
 
 export type OutboundEnvelope =
-  | { kind: 'hello'; serverTime: number }
-  | { kind: 'task.replace'; tasks: AnyTask[] }
-  | { kind: 'task.enqueue'; tasks: AnyTask[] }
-  | { kind: 'task.cancel'; device: DeviceId }
-  | { kind: 'ping'; t: number };
+  | { kind: 'hello'; serverTime: number; tlm?: number }
+  | { kind: 'task.replace'; tasks: AnyTask[]; seq?: number }
+  | { kind: 'task.enqueue'; tasks: AnyTask[]; seq?: number }
+  | { kind: 'task.cancel'; device: DeviceId; seq?: number }
+  // start tasks (one per device) together: at = ESP millis(), in = ms after receipt
+  | { kind: 'task.group'; grp: number; tasks: AnyTask[]; at?: number; in?: number }
+  | { kind: 'ping'; t: number }
+  | { kind: 'lease'; ttl: number } // ttl = 0 releases the lease (ESP stops now)
+  | { kind: 'macro.put'; id: number; hash: number; data: string }
+  | { kind: 'macro.run'; id: number; scale?: number; mirror?: boolean }
+  | { kind: 'macro.del'; id: number }
+  | { kind: 'pose.reset' }
+  | { kind: 'udp'; tok: number } // UDP drive channel on; datagrams carry this token
+  | { kind: 'twist'; v: number; w: number; durationMs?: number } // v mm/s, w mrad/s (CCW), mixed on the ESP
+  | { kind: 'probe'; id: number } // echo of an ESP link probe
+  | { kind: 'endpoints'; eps: string[] } // ESP server list ("host:port", by priority), stored in its flash
+  // onboard behaviour VM: code = hex bytecode (behaviors.ts), hash = FNV-1a of the bytes
+  | { kind: 'behavior.load'; code: string; hash: number; run?: boolean }
+  | { kind: 'behavior.stop' };
 
 export type InboundEnvelope =
-  | { kind: 'hello'; espId: string; fw: string; seq?: number }
-  | { kind: 'ack'; taskId: string; seq?: number }
+  | {
+      kind: 'hello';
+      espId: string;
+      fw: string;
+      win?: number;
+      lease?: number;
+      tlm?: number;
+      udp?: number; // UDP drive port offered by the ESP
+      twist?: number; // twist supported: wheel rim speed (mm/s) at 100 %
+      // first hello after a reset: [rst_reason, warm, boots, hw wdt, exception, soft wdt]
+      rst?: [number, number, number, number, number, number];
+      boot?: number; // ESP millis() when that hello was sent (reset -> session downtime)
+      macros?: number[];
+      // session resumption: [last ESP seq, last task seq processed (previous session), live lease ms left]
+      resume?: [number, number, number];
+      ep?: number; // index of this server in the ESP endpoint list
+      eph?: number; // FNV-1a of the ESP endpoint list "host:port,host:port"
+      seq?: number;
+    }
+  // ack: per-task (taskId), cumulative flow-control ack (ack = last server seq, win = free slots)
+  // or macro stored (macro = id, hash)
+  | { kind: 'ack'; taskId?: string; ack?: number; win?: number; macro?: number; hash?: number; seq?: number }
   | { kind: 'progress'; taskId: string; pct: number; note?: string; seq?: number }
   | { kind: 'done'; taskId: string; seq?: number }
   | { kind: 'error'; taskId?: string; message: string; seq?: number }
-  | { kind: 'pong'; t: number; seq?: number };
+  | { kind: 'pong'; t: number; seq?: number }
+  | ({ kind: 'stats'; seq?: number } & HeapStats)
+  | ({ kind: 'odom'; seq?: number } & OdomSample)
+  | { kind: 'probe'; id: number; t?: number } // link RTT probe, echoed straight back (t = ESP millis)
+  | ({ kind: 'link'; seq?: number } & LinkStats)
+  | ({ kind: 'group'; seq?: number } & GroupReport)
+  | ({ kind: 'sched'; seq?: number } & SchedReport)
+  | ({ kind: 'behavior'; seq?: number } & BehaviorReport)
+  // wheel speeds (pct): requested vs. on the MAX bus (binary telemetry only)
+  | { kind: 'wheels'; target: [number, number]; applied: [number, number]; seq?: number };
+
+/**
+ * Heap telemetry from the ESP ("stats" envelope).
+ * fb = fallback-path counters (free-running uint32): [tx envelopes dropped, rx String copies]
+ */
+export interface HeapStats {
+  heap: number;
+  heapMin: number;
+  blk: number;
+  blkMin: number;
+  frag: number;
+  fragMax: number;
+  alert: number;
+  fb: [number, number];
+  co?: [number, number, number]; // coroutine resumes, avg us, max us
+  rate?: [number, number, number]; // device tick Hz x10, bus frames/s, bus duty permille
+  stop?: [number, number, number, number]; // fast stops, last us, max us, max receive-poll gap us
+  // frames received, superseded drive frames elided unparsed, UDP drive datagrams applied / dropped
+  rx?: [number, number] | [number, number, number, number];
+  // power-aware idle since last report: asleep permille, idle entries, max sleep us, max overrun us
+  pwr?: [number, number, number, number];
+  up: number;
+}
+
+/**
+ * Dead-reckoning pose from the ESP ("odom" envelope), integrated from the wheel
+ * speeds actually sent on the bus. Origin/heading 0 = pose at boot or last pose.reset.
+ */
+export interface OdomSample {
+  x: number; // mm
+  y: number; // mm
+  th: number; // heading, centidegrees 0..35999, CCW positive
+  v: number; // forward speed mm/s
+  w: number; // yaw rate mrad/s
+  ep: number; // reset epoch (bumped by pose.reset)
+  t: number; // ESP millis()
+}
+
+/**
+ * Link quality graded on the ESP ("link" envelope, on grade change + every 10s).
+ * hz = drive command rate the ESP advises; mode 'lean' = reduced telemetry.
+ */
+export interface LinkStats {
+  q: 0 | 1 | 2; // good, fair, poor
+  rssi: number; // dBm, smoothed
+  rtt: number; // ms, smoothed probe RTT
+  lost: number; // probes lost
+  txf: number; // failed sends (socket stalled)
+  hz: number;
+  tlm: number; // ESP telemetry budget, msgs/s
+  mode: 'full' | 'lean';
+}
+
+/**
+ * Achieved start of a task.group on the ESP ("group" envelope, once per group).
+ */
+export interface GroupReport {
+  id: number;
+  n: number; // member devices started
+  late: number; // ms between the requested start and the release tick
+  skew: number; // us, first to last member start
+  span: number; // us, release to the end of the bus kick
+}
+
+/**
+ * Periodic job timing on the ESP ("sched" envelope, one per job every report window).
+ * Histogram bucket i counts values below 250us << i; the last bucket is open-ended.
+ */
+export interface SchedReport {
+  job: string; // tick, wifi, rtc, report
+  p: number; // period ms
+  b: number; // run-time budget us
+  n: number; // runs in the window
+  skip: number; // releases missed entirely (loop blocked > 1 period)
+  lateMax: number; // us, release -> start
+  runMax: number; // us
+  late: number[];
+  over: number[]; // run time past the budget (over-budget runs only)
+}
+
+/**
+ * Behaviour VM on the ESP ("behavior" envelope on load, start and end of a program).
+ */
+export interface BehaviorReport {
+  st: 'empty' | 'ready' | 'running' | 'sleeping' | 'halted' | 'fault' | 'stopped';
+  err?: string; // verifier / run-time error (bad-jump, div-zero, ...)
+  pc: number;
+  size: number; // bytes
+  n: number; // ticks that ran instructions
+  insns: number;
+  ipt: number; // most instructions in one tick (budget: BEH_INSN_PER_TICK)
+  us: number; // slowest tick
+}
 
 export interface DeviceStatus {
   runningTaskId?: string;
@@ -65,4 +201,47 @@ export interface ServerStatus {
   lastHello?: string;
   devices: Record<DeviceId, DeviceStatus>;
   queueSizes: Record<DeviceId, number>;
+  heap?: HeapStats & { receivedAt: string };
+  flow?: FlowStatus;
+  pose?: OdomSample & { receivedAt: string };
+  wheels?: { target: [number, number]; applied: [number, number]; receivedAt: string };
+  link?: LinkStats & { receivedAt: string };
+  group?: GroupReport & { receivedAt: string };
+  sched?: Record<string, SchedReport & { receivedAt: string }>;
+  clockOffsetMs?: number; // server epoch ms - ESP millis(), from link probes
+  reset?: EspResetInfo;
+  endpoint?: EspEndpointInfo;
+  behavior?: BehaviorReport & { name?: string; receivedAt: string };
+}
+
+/**
+ * Last ESP reset as reported in its first hello (RTC snapshot counters survive
+ * everything but power loss).
+ */
+export interface EspResetInfo {
+  reason: string; // power-on, hw-wdt, exception, soft-wdt, restart, deep-sleep, external
+  warm: boolean; // crash recovery took the warm path (no Wi-Fi scan/DHCP, no backoff)
+  boots: number;
+  crashes: { wdt: number; exception: number; softWdt: number };
+  bootToHelloMs?: number;
+  receivedAt: string;
+}
+
+/**
+ * Where the ESP stands in its server list, and what it carried over from its last
+ * session (it may have been with another server: failover).
+ */
+export interface EspEndpointInfo {
+  index?: number; // this server's index in the ESP list (0 = preferred)
+  listHash?: number;
+  managed: string[]; // list pushed to the ESP (ESP_ENDPOINTS / POST /robot/endpoints), empty = not managed
+  resume?: { seq: number; ack: number; leaseMs: number };
+  receivedAt: string;
+}
+
+export interface FlowStatus {
+  window: number | null; // null = firmware without flow control
+  inFlightTasks: number;
+  pendingTasks: number;
+  lastAckSeq: number;
 }
@@ -0,0 +1,108 @@
+import type { InboundEnvelope } from './models';
+
+/**
+ * Binary telemetry decoder (firmware TelemetryEncoder.h).
+ *   frame  := 0x10 record+
+ *   record := tag (type << 1 | key) + zig-zag varint fields [+ text]
+ * Keyframe fields are absolute, others are wrapping int32 deltas to the previous
+ * record of the same type. Field counts/order must match the firmware.
+ */
+const TLM_PROGRESS = 1;
+const TLM_WHEELS = 2;
+const TLM_POSE = 3;
+const TLM_STATS = 4;
+const TLM_FIELDS: Record<number, number> = {
+  [TLM_PROGRESS]: 2, // state (0 ack, 1 progress, 2 done), pct
+  [TLM_WHEELS]: 4, // target L/R, applied L/R
+  [TLM_POSE]: 7, // x, y, th, v, w, ep, t
+  [TLM_STATS]: 28, // heap, heapMin, blk, blkMin, frag, fragMax, alert, fb[2], co[3], rate[3], stop[4], rx[4], pwr[4], up
+};
+
+export class TelemetryDecoder {
+  private prev = new Map<number, number[]>();
+  private taskId = '';
+
+  reset(): void {
+    this.prev.clear();
+    this.taskId = '';
+  }
+
+  decode(buf: Buffer): InboundEnvelope[] {
+    const out: InboundEnvelope[] = [];
+    let pos = 1;
+    const varint = (): number => {
+      let v = 0;
+      let shift = 0;
+      let b: number;
+      do {
+        if (pos >= buf.length || shift > 28) throw new Error('truncated varint');
+        b = buf[pos++];
+        v |= (b & 0x7f) << shift;
+        shift += 7;
+      } while (b & 0x80);
+      return v >>> 0;
+    };
+
+    while (pos < buf.length) {
+      const tag = buf[pos++];
+      const type = tag >> 1;
+      const key = (tag & 1) === 1;
+      const n = TLM_FIELDS[type];
+      if (!n) throw new Error(`unknown record type ${type}`);
+      const prev = this.prev.get(type);
+      if (!key && !prev) throw new Error(`delta before keyframe (type ${type})`);
+
+      const f: number[] = new Array(n);
+      for (let i = 0; i < n; i++) {
+        const u = varint();
+        const v = (u >>> 1) ^ -(u & 1);
+        f[i] = key ? v : (prev![i] + v) | 0;
+      }
+      this.prev.set(type, f);
+
+      if (type === TLM_PROGRESS && key) {
+        const len = varint();
+        if (pos + len > buf.length) throw new Error('truncated text');
+        this.taskId = buf.toString('utf8', pos, pos + len);
+        pos += len;
+      }
+      out.push(this.toEnvelope(type, f));
+    }
+    return out;
+  }
+
+  private toEnvelope(type: number, f: number[]): InboundEnvelope {
+    switch (type) {
+      case TLM_PROGRESS: {
+        const taskId = this.taskId;
+        if (f[0] === 0) return { kind: 'ack', taskId };
+        if (f[0] === 2) return { kind: 'done', taskId };
+        return { kind: 'progress', taskId, pct: f[1] };
+      }
+      case TLM_WHEELS:
+        return { kind: 'wheels', target: [f[0], f[1]], applied: [f[2], f[3]] };
+      case TLM_POSE:
+        return { kind: 'odom', x: f[0], y: f[1], th: f[2], v: f[3], w: f[4], ep: f[5], t: f[6] >>> 0 };
+      default: {
+        const u = f.map((v) => v >>> 0); // stats are all unsigned
+        return {
+          kind: 'stats',
+          heap: u[0],
+          heapMin: u[1],
+          blk: u[2],
+          blkMin: u[3],
+          frag: u[4],
+          fragMax: u[5],
+          alert: u[6],
+          fb: [u[7], u[8]],
+          co: [u[9], u[10], u[11]],
+          rate: [u[12], u[13], u[14]],
+          stop: [u[15], u[16], u[17], u[18]],
+          rx: [u[19], u[20], u[21], u[22]],
+          pwr: [u[23], u[24], u[25], u[26]],
+          up: u[27],
+        };
+      }
+    }
+  }
+}
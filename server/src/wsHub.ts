@@ -1,27 +1,56 @@
+import crypto from 'crypto';
+import dgram from 'dgram';
 import http from 'http';
+import net from 'net';
 import WebSocket, { WebSocketServer } from 'ws';
 import {
+  CLOCK_OFFSET_SAMPLES,
+  ESP_BIN_STOP,
+  ESP_BIN_TELEMETRY,
+  ESP_ENDPOINTS,
+  ESP_UDP_DRIVE,
+  FLOW_ACK_STALL_MS,
+  FLOW_MAX_TASKS_PER_ENVELOPE,
+  GROUP_LATE_WARN_MS,
   HTTP_PORT,
   WS_PATH,
   WS_HEARTBEAT_MS,
   WS_LIVENESS_GRACE_MS,
   WS_MAX_PAYLOAD,
   WS_PERMESSAGE_DEFLATE,
+  TLM_BINARY,
+  UDP_DRIVE,
+  UDP_STOP_REPEAT,
+  WS_BACKLOG_MAX_BYTES,
 } from './config';
-import { espLog, taskLog, wsLog } from './logger';
+import { espLog, logger, taskLog, wsLog } from './logger';
 import {
   AnyTask,
+  BehaviorReport,
   DeviceId,
+  EspEndpointInfo,
+  EspResetInfo,
+  FlowStatus,
+  GroupReport,
+  HeapStats,
   InboundEnvelope,
+  LinkStats,
+  OdomSample,
   OutboundEnvelope,
+  SchedReport,
   ServerStatus,
 } from './models';
+import { MACRO_SLOTS, MacroDef, encodeMacro, fnv1a } from './macros';
 import {
   applyEnqueueTasks,
   applyReplaceTasks,
   cancelDevice,
   serializeManagers,
 } from './taskQueue';
+import { TelemetryDecoder } from './telemetry';
+
+const UDP_DRIVE_LEN = 14;
+const UDP_FLAG_STOP = 0x01;
 
 /**
  * Tùy chỉnh nội bộ (fallback nếu bạn chưa có trong config)
@@ -45,10 +74,77 @@ export class WsHub {
 
   // Lưu hello gần nhất (ISO string)
   private lastHello?: string;
+
+  // Heap telemetry gần nhất từ ESP
+  private lastHeapStats?: HeapStats & { receivedAt: string };
+
+  // Pose odometry gần nhất từ ESP + callback đẩy cho UI
+  private lastPose?: OdomSample & { receivedAt: string };
+  private odometryHandler?: (pose: OdomSample) => void;
+  private lastWheels?: { target: [number, number]; applied: [number, number]; receivedAt: string };
+
+  // Link quality do ESP đánh giá + callback (DriveRelay điều chỉnh tốc độ lệnh)
+  private lastLink?: LinkStats & { receivedAt: string };
+  private linkHandler?: (link: LinkStats) => void;
+
+  // Synchronised start: offset đồng hồ ESP (server ms - ESP millis) từ probe, report gần nhất
+  private clockSamples: number[] = [];
+  private groupSeq = 0;
+  private lastGroup?: GroupReport & { receivedAt: string };
+
+  // Timing các job định kỳ trên ESP (report gần nhất theo tên job)
+  private lastSched: Record<string, SchedReport & { receivedAt: string }> = {};
+
+  // Reset gần nhất của ESP (từ hello đầu tiên sau reset)
+  private lastReset?: EspResetInfo;
+
+  // Danh sách server trên ESP (failover): list quản lý từ server + vị trí/resume từ hello.
+  // resumeHandler: ESP mang theo lease còn chạy từ phiên trước (có thể của server khác)
+  private managedEndpoints: string[] = [...ESP_ENDPOINTS];
+  private lastEndpoint?: EspEndpointInfo;
+  private resumeHandler?: (leaseMs: number) => void;
+
+  // Behaviour VM trên ESP: tên chương trình gửi gần nhất + report gần nhất
+  private behaviorName?: string;
+  private lastBehavior?: BehaviorReport & { name?: string; receivedAt: string };
+
+  // Binary telemetry: decoder state is per connection (deltas chain within one socket)
+  private readonly tlmDecoder = new TelemetryDecoder();
+  private tlmBytes = 0;
+  private tlmRecords = 0;
+  private tlmDesync = false; // đã log lỗi, chờ keyframe
   
   // Deduplication: track last seen seq per taskId
   private lastSeqMap = new Map<string, number>();
 
+  // Flow control cho task stream: ESP quảng bá số slot trống (win) và ack cộng dồn theo seq.
+  // Enqueue chỉ được gửi khi còn credit; replace/cancel luôn gửi ngay (chúng xoá queue trên ESP).
+  private txSeq = 0;
+  private flowHelloSeen = false;
+  private espCapacity: number | null = null; // null = firmware cũ, không giới hạn
+  private espWindow: number | null = null;
+  private flowResetSeq = 0; // ack < flowResetSeq là ack cũ (trước replace/cancel)
+  private lastAckSeq = 0;
+  private inFlight: { seq: number; wheels: number; sentAt: number }[] = [];
+  private pendingTasks: AnyTask[] = []; // enqueue chưa gửi vì hết credit
+  private stallWarned = false;
+
+  // Hash của macro đang lưu trong flash ESP theo id (0 = trống), cập nhật từ hello/ack
+  private espMacroHashes: number[] = new Array(MACRO_SLOTS).fill(0);
+
+  // Motion lease: max TTL advertised in hello (null = firmware without leases)
+  private espLeaseMaxMs: number | null = null;
+
+  // Twist drive: wheel rim speed at 100 % advertised in hello (null = not supported)
+  private espTwistMaxMmS: number | null = null;
+
+  // UDP drive channel (per phiên): token = 0 khi chưa bật / firmware không hỗ trợ
+  private udpSocket?: dgram.Socket;
+  private espAddress?: string;
+  private espUdpPort = 0;
+  private udpToken = 0;
+  private udpSeq = 0;
+
   // Debounce cho replace
   private replaceBuffer: AnyTask[] = [];
   private replaceTimer?: NodeJS.Timeout;
@@ -87,10 +183,47 @@ export class WsHub {
     this.browserConnectionHandler = handler;
   }
 
+  /**
+   * Đăng ký handler nhận pose odometry (mỗi envelope "odom" từ ESP)
+   */
+  setOdometryHandler(handler: (pose: OdomSample) => void): void {
+    this.odometryHandler = handler;
+  }
+
   // ======================
   // Public API
   // ======================
 
+  /**
+   * Đăng ký handler nhận link quality (mỗi envelope "link" từ ESP)
+   */
+  setLinkHandler(handler: (link: LinkStats) => void): void {
+    this.linkHandler = handler;
+  }
+
+  /**
+   * Phiên mới mang theo live lease của phiên trước (failover từ server khác hoặc
+   * reconnect): handler quyết định gia hạn (còn intent) hay thu hồi.
+   */
+  setResumeHandler(handler: (leaseMs: number) => void): void {
+    this.resumeHandler = handler;
+  }
+
+  getEndpoints(): string[] {
+    return [...this.managedEndpoints];
+  }
+
+  /**
+   * Đổi danh sách server của ESP (ưu tiên theo thứ tự). ESP lưu vào flash; rỗng = không
+   * quản lý nữa (ESP giữ list hiện có). false = ESP offline, list được gửi ở hello kế tiếp.
+   */
+  setEndpoints(endpoints: string[]): boolean {
+    this.managedEndpoints = [...endpoints];
+    if (!endpoints.length || !this.isEspConnected()) return false;
+    this.sendEnvelope({ kind: 'endpoints', eps: this.managedEndpoints });
+    return true;
+  }
+
   /**
    * Debounce replace: gom các lệnh replace trong REPLACE_DEBOUNCE_MS,
    * chỉ gửi "last-by-device" để tránh spam.
@@ -101,15 +234,25 @@ export class WsHub {
     this.replaceBuffer.push(...tasks);
     if (this.replaceTimer) return;
 
-    this.replaceTimer = setTimeout(() => {
+    const flush = () => {
       this.replaceTimer = undefined;
 
+      // Socket còn backlog (link yếu/TCP đang retransmit): giữ lại, tiếp tục gom —
+      // gửi lệnh cũ chỉ làm ESP nhận thêm lệnh đã lỗi thời
+      if (this.espBacklogged()) {
+        this.replaceTimer = setTimeout(flush, REPLACE_DEBOUNCE_MS);
+        return;
+      }
+
       // Lấy task cuối theo mỗi device
       const lastByDevice = new Map<DeviceId, AnyTask>();
       for (const t of this.replaceBuffer) lastByDevice.set(t.device, t);
       const coalesced = Array.from(lastByDevice.values());
       this.replaceBuffer = [];
 
+      // Replace huỷ các enqueue chưa gửi của cùng device
+      this.dropPendingTasks(new Set(coalesced.map((t) => t.device)));
+
       // Áp dụng vào queue trước khi gửi để giữ đồng bộ trạng thái server
       applyReplaceTasks(coalesced);
 
@@ -118,29 +261,207 @@ export class WsHub {
         envelope,
         `[WS->ESP] task.replace (debounced ${coalesced.length} task${coalesced.length === 1 ? '' : 's'})`
       );
-    }, REPLACE_DEBOUNCE_MS);
+    };
+    this.replaceTimer = setTimeout(flush, REPLACE_DEBOUNCE_MS);
+  }
+
+  /** Dữ liệu chưa lên dây của socket ESP vượt ngưỡng */
+  private espBacklogged(): boolean {
+    return !!this.espSocket && this.espSocket.readyState === WebSocket.OPEN &&
+      this.espSocket.bufferedAmount > WS_BACKLOG_MAX_BYTES;
   }
 
   sendEnqueueTasks(tasks: AnyTask[]): void {
     applyEnqueueTasks(tasks);
     if (!tasks?.length) return;
-    const envelope: OutboundEnvelope = { kind: 'task.enqueue', tasks };
-    this.enqueueEnvelope(
-      envelope,
-      `[WS->ESP] task.enqueue (${tasks.length} task${tasks.length === 1 ? '' : 's'})`
+    taskLog(
+      `[WS->ESP] task.enqueue (${tasks.length} task${tasks.length === 1 ? '' : 's'}, ` +
+        `${this.pendingTasks.length} already pending)`
     );
+    this.pendingTasks.push(...tasks);
+    this.pumpTasks();
   }
 
   sendCancel(device: DeviceId): void {
+    if (device === 'wheels') this.sendEmergencyStop();
     cancelDevice(device);
+    this.dropPendingTasks(new Set([device]));
     const envelope: OutboundEnvelope = { kind: 'task.cancel', device };
     this.enqueueEnvelope(envelope, `[WS->ESP] task.cancel (${device})`);
   }
 
+  /**
+   * Chạy macro trên ESP. Chỉ upload (macro.put) khi hash trong flash khác bản hiện tại;
+   * macro.put và macro.run đi cùng kết nối TCP nên ESP luôn lưu trước khi chạy.
+   */
+  runMacro(macro: MacroDef, scale = 100, mirror = false): { uploaded: boolean } {
+    const data = encodeMacro(macro.steps);
+    const hash = fnv1a(data);
+    let uploaded = false;
+    if (this.espMacroHashes[macro.id] !== hash) {
+      this.enqueueEnvelope(
+        { kind: 'macro.put', id: macro.id, hash, data: data.toString('hex') },
+        `[WS->ESP] macro.put id=${macro.id} (${macro.name}, ${data.length} bytes, hash=${hash.toString(16)})`
+      );
+      // Lạc quan: coi như đã lưu để các lần chạy liên tiếp không upload lại
+      this.espMacroHashes[macro.id] = hash;
+      uploaded = true;
+    }
+    const run: Extract<OutboundEnvelope, { kind: 'macro.run' }> = { kind: 'macro.run', id: macro.id };
+    if (scale !== 100) run.scale = scale;
+    if (mirror) run.mirror = true;
+    this.enqueueEnvelope(run, `[WS->ESP] macro.run id=${macro.id} (${macro.name}) scale=${scale} mirror=${mirror}`);
+    return { uploaded };
+  }
+
+  /**
+   * Dừng bánh xe ngay: frame nhị phân, không debounce/buffer, ESP xử lý trước khi parse JSON.
+   * Lệnh JSON tương ứng (cancel / drive 0) vẫn gửi sau để giữ sổ sách task.
+   */
+  sendEmergencyStop(): void {
+    if (!this.isEspConnected()) return;
+    // Kênh UDP: stop đi cả hai đường (UDP không bị kẹt sau segment TCP bị mất)
+    let udpStop = false;
+    for (let i = 0; i < UDP_STOP_REPEAT; i++) {
+      if (!this.sendDatagram(UDP_FLAG_STOP, 0, 0, 0)) break;
+      udpStop = true;
+    }
+    // Frame mang seq của datagram stop cuối: drive datagram gửi trước đó đến muộn vẫn bị ESP bỏ
+    const frame = Buffer.alloc(udpStop ? 5 : 1);
+    frame[0] = ESP_BIN_STOP;
+    if (udpStop) frame.writeUInt32LE(this.udpSeq, 1);
+    try {
+      this.espSocket!.send(frame);
+    } catch (e) {
+      wsLog('Failed to send binary stop', e);
+    }
+  }
+
+  isEspConnected(): boolean {
+    return !!this.espSocket && this.espSocket.readyState === WebSocket.OPEN;
+  }
+
+  /**
+   * Kênh UDP drive đã bật cho phiên hiện tại (ESP offer port + server gửi token)
+   */
+  supportsUdpDrive(): boolean {
+    return this.udpToken !== 0 && this.isEspConnected();
+  }
+
+  /**
+   * Drive qua UDP: datagram mang seq + lease ttl, ESP chỉ áp dụng seq mới nhất.
+   * false = kênh UDP chưa bật → caller gửi qua WS như cũ.
+   */
+  sendUdpDrive(left: number, right: number, ttl: number): boolean {
+    return this.sendDatagram(0, left, right, ttl);
+  }
+
+  supportsLease(): boolean {
+    return this.espLeaseMaxMs !== null;
+  }
+
+  /**
+   * Gia hạn motion lease (frame nhỏ, không qua buffer: lease cũ vô nghĩa khi ESP offline).
+   * ttl = 0 thu hồi lease, ESP dừng ngay.
+   */
+  sendLease(ttl: number): boolean {
+    if (!this.isEspConnected() || this.espLeaseMaxMs === null) return false;
+    this.sendEnvelope({ kind: 'lease', ttl: Math.min(ttl, this.espLeaseMaxMs) });
+    return true;
+  }
+
+  supportsTwist(): boolean {
+    return this.espTwistMaxMmS !== null && this.isEspConnected();
+  }
+
+  /**
+   * Twist (v mm/s, w mrad/s): ESP tự trộn ra tốc độ bánh + giới hạn gia tốc.
+   * Không buffer khi offline (lệnh live, cũ là vô nghĩa) -> false.
+   */
+  sendTwist(v: number, w: number): boolean {
+    if (!this.supportsTwist()) return false;
+    this.sendEnvelope({ kind: 'twist', v, w });
+    return true;
+  }
+
+  /**
+   * Nạp chương trình behaviour (bytecode đã assemble) vào VM trên ESP; run = chạy ngay.
+   * ESP verify trước khi thay chương trình cũ, lỗi trả về qua `error`. Không buffer khi
+   * offline: chương trình phản ứng theo cảm biến, chạy muộn sau khi reconnect là sai.
+   */
+  loadBehavior(name: string, code: Buffer, run = true): boolean {
+    if (!this.isEspConnected()) return false;
+    const hash = fnv1a(code);
+    const envelope: Extract<OutboundEnvelope, { kind: 'behavior.load' }> = {
+      kind: 'behavior.load',
+      code: code.toString('hex'),
+      hash,
+    };
+    if (!run) envelope.run = false;
+    this.sendEnvelope(envelope);
+    this.behaviorName = name;
+    taskLog(`[WS->ESP] behavior.load ${name} (${code.length} bytes, hash=${hash.toString(16)}) run=${run}`);
+    return true;
+  }
+
+  stopBehavior(): boolean {
+    if (!this.isEspConnected()) return false;
+    this.sendEnvelope({ kind: 'behavior.stop' });
+    taskLog('[WS->ESP] behavior.stop');
+    return true;
+  }
+
+  /**
+   * Đưa pose odometry trên ESP về gốc (x = y = 0, heading 0). Không buffer khi offline:
+   * ESP khởi động lại cũng bắt đầu từ gốc.
+   */
+  sendPoseReset(): boolean {
+    if (!this.isEspConnected()) return false;
+    this.sendEnvelope({ kind: 'pose.reset' });
+    taskLog('[WS->ESP] pose.reset');
+    return true;
+  }
+
+  /**
+   * Synchronised start: các task (mỗi device một task) bắt đầu cùng một tick trên ESP.
+   * atMs = server epoch ms, đổi sang đồng hồ ESP bằng offset ước lượng từ probe;
+   * chưa có offset thì gửi `in` (ms tính từ lúc ESP nhận). Không buffer khi ESP offline
+   * (thời điểm đã lỗi thời khi kết nối lại) -> trả null.
+   */
+  sendTaskGroup(tasks: AnyTask[], atMs: number): { grp: number; at?: number; in?: number } | null {
+    if (!this.isEspConnected() || !tasks.length) return null;
+    const grp = (this.groupSeq = (this.groupSeq + 1) & 0xffff);
+    const offset = this.clockOffsetMs();
+    const timing: { at?: number; in?: number } =
+      offset !== undefined
+        ? { at: (atMs - offset) >>> 0 }
+        : { in: Math.max(0, Math.round(atMs - Date.now())) };
+
+    // Group thay thế task hiện tại của các device thành viên, như replace
+    this.dropPendingTasks(new Set(tasks.map((t) => t.device)));
+    applyReplaceTasks(tasks);
+
+    this.sendEnvelope({ kind: 'task.group', grp, tasks, ...timing });
+    taskLog(
+      `[WS->ESP] task.group ${grp} (${tasks.map((t) => t.device).join('+')}) ` +
+        (timing.at !== undefined ? `at=${timing.at} (offset ${offset}ms)` : `in=${timing.in}ms (no clock offset yet)`)
+    );
+    return { grp, ...timing };
+  }
+
+  /** Offset đồng hồ ESP: min(thời điểm nhận - t) trên các probe gần nhất */
+  clockOffsetMs(): number | undefined {
+    return this.clockSamples.length ? Math.min(...this.clockSamples) : undefined;
+  }
+
+  getMacroHashes(): number[] {
+    return [...this.espMacroHashes];
+  }
+
   getStatus(): ServerStatus {
     const managers = serializeManagers();
     return {
-      connected: !!this.espSocket && this.espSocket.readyState === WebSocket.OPEN,
+      connected: this.isEspConnected(),
       lastHello: this.lastHello,
       devices: {
         arm: { ...managers.arm, lastUpdated: managers.arm.lastUpdated },
@@ -152,6 +473,26 @@ export class WsHub {
         neck: managers.neck.queueSize,
         wheels: managers.wheels.queueSize,
       },
+      heap: this.lastHeapStats,
+      flow: this.getFlowStatus(),
+      pose: this.lastPose,
+      wheels: this.lastWheels,
+      link: this.lastLink,
+      group: this.lastGroup,
+      sched: Object.keys(this.lastSched).length ? this.lastSched : undefined,
+      clockOffsetMs: this.clockOffsetMs(),
+      reset: this.lastReset,
+      endpoint: this.lastEndpoint ? { ...this.lastEndpoint, managed: this.getEndpoints() } : undefined,
+      behavior: this.lastBehavior,
+    };
+  }
+
+  getFlowStatus(): FlowStatus {
+    return {
+      window: this.espWindow,
+      inFlightTasks: this.inFlightWheels(),
+      pendingTasks: this.pendingTasks.length,
+      lastAckSeq: this.lastAckSeq,
     };
   }
 
@@ -201,12 +542,16 @@ export class WsHub {
 
     this.espSocket = socket;
     wsLog('ESP connected from', req.socket.remoteAddress);
+    this.espAddress = req.socket.remoteAddress?.replace(/^::ffff:/, '');
+    this.udpToken = 0;
 
     // IMPORTANT: enable TCP_NODELAY on underlying socket for low-latency
     try {
       (socket as any)._socket?.setNoDelay?.(true);
     } catch {}
 
+    this.resetFlow();
+
     // Grace period: mark ready after 500ms
     this.espReady = false;
     this.inboundBuffer = [];
@@ -236,13 +581,19 @@ export class WsHub {
       // ws lib sẽ tự động reply pong; không cần làm gì thêm
     });
 
-    socket.on('message', (data) => this.handleMessage(data));
+    socket.on('message', (data, isBinary) => {
+      if (isBinary) this.handleBinary(data as Buffer);
+      else this.handleMessage(data);
+    });
     socket.on('close', (code, reason) => this.handleClose(code, reason.toString()));
     socket.on('error', (err) => wsLog('Socket error', err));
 
     this.startHeartbeat();
     // Gửi hello (application-level) — giữ tương thích với firmware
-    this.sendEnvelope({ kind: 'hello', serverTime: Date.now() });
+    this.tlmDecoder.reset();
+    this.tlmBytes = this.tlmRecords = 0;
+    this.tlmDesync = false;
+    this.sendEnvelope({ kind: 'hello', serverTime: Date.now(), ...(TLM_BINARY ? { tlm: 1 } : {}) });
     this.flushBuffer();
   }
 
@@ -263,6 +614,34 @@ export class WsHub {
     }
   }
 
+  /**
+   * Frame nhị phân từ ESP: hiện chỉ có telemetry (delta records). Giải mã ngay để giữ
+   * đúng thứ tự delta, envelope kết quả đi qua cùng đường với JSON.
+   */
+  private handleBinary(data: Buffer): void {
+    if (data.length === 0 || data[0] !== ESP_BIN_TELEMETRY) {
+      wsLog(`Unknown binary frame from ESP (opcode 0x${(data[0] ?? 0).toString(16)}, ${data.length} bytes)`);
+      return;
+    }
+    let messages: InboundEnvelope[];
+    try {
+      messages = this.tlmDecoder.decode(data);
+    } catch (err) {
+      // Mất đồng bộ: bỏ qua tới keyframe kế tiếp của từng loại record
+      if (!this.tlmDesync) wsLog(`Telemetry decode error: ${(err as Error).message}`);
+      this.tlmDesync = true;
+      this.tlmDecoder.reset();
+      return;
+    }
+    this.tlmDesync = false;
+    this.tlmBytes += data.length;
+    this.tlmRecords += messages.length;
+    for (const msg of messages) {
+      if (!this.espReady) this.inboundBuffer.push(msg);
+      else this.routeInbound(msg);
+    }
+  }
+
   private routeInbound(message: InboundEnvelope): void {
     // Deduplication: check seq if present (taskId + seq for task-related messages)
     const msgSeq = message.seq;
@@ -285,11 +664,33 @@ export class WsHub {
     switch (message.kind) {
       case 'hello':
         this.lastHello = new Date().toISOString();
-        wsLog(`ESP hello id=${message.espId} fw=${message.fw}`);
+        wsLog(
+          `ESP hello id=${message.espId} fw=${message.fw} win=${message.win ?? 'n/a'} lease=${message.lease ?? 'n/a'} ` +
+            `tlm=${message.tlm ?? 0}`
+        );
+        if (message.rst) this.handleReset(message.rst, message.boot);
+        this.espLeaseMaxMs = message.lease ?? null;
+        this.espTwistMaxMmS = message.twist ?? null;
+        this.handleEndpointHello(message.ep, message.eph, message.resume);
+        this.setupUdpDrive(message.udp);
+        if (Array.isArray(message.macros)) {
+          this.espMacroHashes = message.macros.slice(0, MACRO_SLOTS);
+        }
+        this.flowHelloSeen = true;
+        this.espCapacity = message.win ?? null;
+        this.espWindow = this.espCapacity;
+        this.pumpTasks();
         break;
 
       case 'ack':
-        espLog(`ack taskId=${message.taskId}`);
+        if (message.ack !== undefined) {
+          this.handleFlowAck(message.ack, message.win);
+        } else if (message.macro !== undefined) {
+          espLog(`macro stored id=${message.macro} hash=${(message.hash ?? 0).toString(16)}`);
+          this.espMacroHashes[message.macro] = message.hash ?? 0;
+        } else {
+          espLog(`ack taskId=${message.taskId}`);
+        }
         break;
 
       case 'progress':
@@ -311,11 +712,164 @@ export class WsHub {
         this.lastPong = Date.now();
         break;
 
+      case 'stats':
+        this.handleHeapStats(message);
+        break;
+
+      case 'wheels':
+        this.lastWheels = { target: message.target, applied: message.applied, receivedAt: new Date().toISOString() };
+        break;
+
+      case 'odom': {
+        const { x, y, th, v, w, ep, t } = message;
+        const pose: OdomSample = { x, y, th, v, w, ep, t };
+        this.lastPose = { ...pose, receivedAt: new Date().toISOString() };
+        this.odometryHandler?.(pose);
+        break;
+      }
+
+      case 'probe':
+        // Echo ngay (không buffer): ESP đo RTT từ đây
+        this.sendEnvelope({ kind: 'probe', id: message.id });
+        if (message.t !== undefined) {
+          this.clockSamples.push(Date.now() - message.t);
+          if (this.clockSamples.length > CLOCK_OFFSET_SAMPLES) this.clockSamples.shift();
+        }
+        break;
+
+      case 'group': {
+        const { id, n, late, skew, span } = message;
+        const summary = `group ${id} started ${n} device(s) late=${late}ms skew=${skew}us span=${span}us`;
+        if (late > GROUP_LATE_WARN_MS) logger.warn('[ESP]', summary);
+        else espLog(summary);
+        this.lastGroup = { id, n, late, skew, span, receivedAt: new Date().toISOString() };
+        break;
+      }
+
+      case 'behavior': {
+        const { st, err, pc, size, n, insns, ipt, us } = message;
+        const report: BehaviorReport = { st, err, pc, size, n, insns, ipt, us };
+        const summary =
+          `behavior ${this.behaviorName ?? '?'} ${st}${err ? ` (${err} at pc ${pc})` : ''} ` +
+          `${size}B ticks=${n} insns=${insns} max/tick=${ipt} max=${us}us`;
+        if (st === 'fault') logger.warn('[ESP]', summary);
+        else espLog(summary);
+        this.lastBehavior = { ...report, name: this.behaviorName, receivedAt: new Date().toISOString() };
+        break;
+      }
+
+      case 'sched': {
+        const { job, p, b, n, skip, lateMax, runMax, late, over: overHist } = message;
+        const report: SchedReport = { job, p, b, n, skip, lateMax, runMax, late, over: overHist };
+        const over = report.over.reduce((a, c) => a + c, 0);
+        const summary =
+          `sched ${report.job} ${report.n}x/${report.p}ms late max=${report.lateMax}us ` +
+          `run max=${report.runMax}us over=${over} skip=${report.skip}`;
+        if (report.skip > 0 || over > 0) logger.warn('[ESP]', summary);
+        else espLog(summary);
+        this.lastSched[report.job] = { ...report, receivedAt: new Date().toISOString() };
+        break;
+      }
+
+      case 'link':
+        this.handleLink(message);
+        break;
+
       default:
         wsLog('Unknown message from ESP', message);
     }
   }
 
+  /**
+   * Heap telemetry: lưu snapshot cho /robot/status, cảnh báo khi ESP bật alert bit
+   * (0x01 low heap, 0x02 fragmented, 0x04 small largest block)
+   */
+  private handleHeapStats(stats: HeapStats): void {
+    const prevAlert = this.lastHeapStats?.alert ?? 0;
+    const { heap, heapMin, blk, blkMin, frag, fragMax, alert, fb, co, rate, stop, rx, pwr, up } = stats;
+    this.lastHeapStats = {
+      heap, heapMin, blk, blkMin, frag, fragMax, alert, fb, co, rate, stop, rx, pwr, up,
+      receivedAt: new Date().toISOString(),
+    };
+
+    const summary =
+      `heap=${heap} (min ${heapMin}) blk=${blk} (min ${blkMin}) frag=${frag}% (max ${fragMax}%) ` +
+      `fb=${fb?.join('/') ?? 'n/a'} co=${co?.join('/') ?? 'n/a'} ` +
+      `tick=${rate ? `${rate[0] / 10}Hz bus=${rate[1]}f/s ${rate[2] / 10}%` : 'n/a'} ` +
+      `stop=${stop ? `${stop[0]}x last ${stop[1]}us worst<=${((stop[3] + stop[2]) / 1000).toFixed(1)}ms` : 'n/a'} ` +
+      `rx=${rx ? `${rx[0]} (${rx[1]} elided)` : 'n/a'} ` +
+      `udp=${rx && rx.length === 4 && this.udpToken ? `${rx[2]} (${rx[3]} dropped)` : 'off'} ` +
+      `idle=${pwr ? `${pwr[0] / 10}% asleep wake<=${(pwr[2] / 1000).toFixed(0)}ms (+${pwr[3]}us)` : 'n/a'} ` +
+      `tlm=${this.tlmRecords ? `${this.tlmRecords} rec ${(this.tlmBytes / this.tlmRecords).toFixed(1)}B/rec` : 'json'} ` +
+      `up=${up}s`;
+    if (alert && alert !== prevAlert) {
+      logger.warn('[ESP]', `heap alert=0x${alert.toString(16)} ${summary}`);
+    } else if (!alert && prevAlert) {
+      espLog(`heap alert cleared ${summary}`);
+    } else {
+      espLog(`stats ${summary}`);
+    }
+  }
+
+  private handleLink(message: LinkStats): void {
+    const { q, rssi, rtt, lost, txf, hz, tlm, mode } = message;
+    const link: LinkStats = { q, rssi, rtt, lost, txf, hz, tlm, mode };
+    const summary = `rssi=${rssi}dBm rtt=${rtt}ms lost=${lost} txf=${txf} -> ${hz} cmd/s, tlm ${tlm}/s ${mode}`;
+    const grade = ['good', 'fair', 'poor'][q] ?? `q${q}`;
+    if (this.lastLink?.q !== q) {
+      if (q > 0) logger.warn('[ESP]', `link ${grade} ${summary}`);
+      else espLog(`link ${grade} ${summary}`);
+    }
+    this.lastLink = { ...link, receivedAt: new Date().toISOString() };
+    this.linkHandler?.(link);
+  }
+
+  /** Reset cause trong hello: crash (watchdog/exception) thì cảnh báo kèm downtime */
+  private handleReset(rst: [number, number, number, number, number, number], boot?: number): void {
+    const [code, warm, boots, wdt, exception, softWdt] = rst;
+    const reason =
+      ['power-on', 'hw-wdt', 'exception', 'soft-wdt', 'restart', 'deep-sleep', 'external'][code] ?? `reason${code}`;
+    this.lastReset = {
+      reason,
+      warm: warm === 1,
+      boots,
+      crashes: { wdt, exception, softWdt },
+      bootToHelloMs: boot,
+      receivedAt: new Date().toISOString(),
+    };
+    const summary =
+      `ESP reset ${reason} (${warm ? 'warm' : 'cold'} start, hello ${boot ?? '?'}ms after boot) ` +
+      `boots=${boots} crashes wdt=${wdt} exc=${exception} swdt=${softWdt}`;
+    if (code >= 1 && code <= 3) logger.warn('[ESP]', summary);
+    else espLog(summary);
+  }
+
+  /**
+   * Hello: vị trí của server này trong list ESP + phần resume. List khác hash thì gửi
+   * list quản lý; lease còn chạy thì để resumeHandler gia hạn hoặc thu hồi.
+   */
+  private handleEndpointHello(ep?: number, eph?: number, resume?: [number, number, number]): void {
+    const [seq, ack, leaseMs] = resume ?? [0, 0, 0];
+    this.lastEndpoint = {
+      index: ep,
+      listHash: eph,
+      managed: this.managedEndpoints,
+      resume: resume ? { seq, ack, leaseMs } : undefined,
+      receivedAt: new Date().toISOString(),
+    };
+    if (resume && (ack > 0 || leaseMs > 0)) {
+      wsLog(`ESP resumed on endpoint #${ep ?? '?'}: last seq=${seq} task ack=${ack} live lease ${leaseMs}ms`);
+    }
+    if (this.managedEndpoints.length && eph !== undefined) {
+      const hash = fnv1a(Buffer.from(this.managedEndpoints.join(',')));
+      if (hash !== eph) {
+        wsLog(`ESP endpoint list differs, sending ${this.managedEndpoints.join(',')}`);
+        this.sendEnvelope({ kind: 'endpoints', eps: this.managedEndpoints });
+      }
+    }
+    if (leaseMs > 0) this.resumeHandler?.(leaseMs);
+  }
+
   private handleClose(code: number, reason: string): void {
     wsLog(`ESP disconnected code=${code} reason=${reason}`);
     if (this.heartbeatTimer) {
@@ -330,6 +884,181 @@ export class WsHub {
     this.espReady = false;
     this.inboundBuffer = [];
     this.lastSeqMap.clear();
+    this.espLeaseMaxMs = null;
+    this.espTwistMaxMmS = null;
+    this.udpToken = 0;
+    this.lastLink = undefined;
+    this.clockSamples = []; // ESP có thể đã reboot (millis về 0)
+    // ESP huỷ mọi task khi mất kết nối; enqueue chưa gửi vẫn giữ lại như buffer
+    this.resetFlow();
+  }
+
+  // ======================
+  // UDP drive channel
+  // ======================
+
+  /**
+   * ESP hello có `udp` (port): cấp token mới cho phiên, báo ESP qua envelope `udp`.
+   * Datagram gửi trước khi ESP nhận token bị ESP bỏ qua; lease renew kế tiếp bù lại.
+   */
+  private setupUdpDrive(port?: number): void {
+    this.udpToken = 0;
+    this.udpSeq = 0;
+    this.espUdpPort = 0;
+    if (!UDP_DRIVE || !port || !this.espAddress || !net.isIPv4(this.espAddress)) return;
+    if (!this.udpSocket) {
+      this.udpSocket = dgram.createSocket('udp4');
+      this.udpSocket.on('error', (err) => wsLog(`UDP drive socket error: ${err.message}`));
+    }
+    this.espUdpPort = port;
+    this.udpToken = crypto.randomBytes(4).readUInt32LE(0) || 1;
+    this.sendEnvelope({ kind: 'udp', tok: this.udpToken });
+    wsLog(`UDP drive channel -> ${this.espAddress}:${port}`);
+  }
+
+  /**
+   * Datagram 14 byte (firmware Protocol.h): op, flags, token, seq, left, right, ttl (LE)
+   */
+  private sendDatagram(flags: number, left: number, right: number, ttl: number): boolean {
+    if (!this.supportsUdpDrive() || !this.udpSocket || !this.espAddress) return false;
+    this.udpSeq = (this.udpSeq + 1) >>> 0;
+    const buf = Buffer.alloc(UDP_DRIVE_LEN);
+    buf[0] = ESP_UDP_DRIVE;
+    buf[1] = flags;
+    buf.writeUInt32LE(this.udpToken, 2);
+    buf.writeUInt32LE(this.udpSeq, 6);
+    buf.writeInt8(left, 10);
+    buf.writeInt8(right, 11);
+    buf.writeUInt16LE(Math.min(ttl, this.espLeaseMaxMs ?? ttl, 0xffff), 12);
+    this.udpSocket.send(buf, this.espUdpPort, this.espAddress, (err) => {
+      if (err) wsLog(`UDP drive send failed: ${err.message}`);
+    });
+    return true;
+  }
+
+  // ======================
+  // Flow control
+  // ======================
+
+  private resetFlow(): void {
+    this.txSeq = 0;
+    this.flowHelloSeen = false;
+    this.espCapacity = null;
+    this.espWindow = null;
+    this.flowResetSeq = 0;
+    this.lastAckSeq = 0;
+    this.inFlight = [];
+    this.stallWarned = false;
+  }
+
+  private inFlightWheels(): number {
+    return this.inFlight.reduce((n, e) => n + e.wheels, 0);
+  }
+
+  private availableCredit(): number {
+    if (this.espWindow === null) return Number.POSITIVE_INFINITY; // firmware cũ
+    return Math.max(0, this.espWindow - this.inFlightWheels());
+  }
+
+  /**
+   * Gửi các enqueue đang chờ trong giới hạn credit. Chỉ task wheels chiếm slot trên ESP;
+   * mỗi envelope tối đa FLOW_MAX_TASKS_PER_ENVELOPE task để vừa document parse của ESP.
+   */
+  private pumpTasks(): void {
+    if (!this.espSocket || this.espSocket.readyState !== WebSocket.OPEN || !this.flowHelloSeen) {
+      return;
+    }
+    while (this.pendingTasks.length > 0) {
+      const credit = this.availableCredit();
+      let wheels = 0;
+      let count = 0;
+      while (count < FLOW_MAX_TASKS_PER_ENVELOPE && count < this.pendingTasks.length) {
+        if (this.pendingTasks[count].device === 'wheels') {
+          if (wheels >= credit) break;
+          wheels++;
+        }
+        count++;
+      }
+      if (count === 0) {
+        this.checkFlowStall();
+        return; // hết credit — chờ ack mở window
+      }
+      const tasks = this.pendingTasks.splice(0, count);
+      this.sendEnvelope({ kind: 'task.enqueue', tasks });
+    }
+  }
+
+  private handleFlowAck(ack: number, win?: number): void {
+    if (ack < this.flowResetSeq) return; // ack cho stream trước replace/cancel
+    this.lastAckSeq = Math.max(this.lastAckSeq, ack);
+    this.inFlight = this.inFlight.filter((e) => e.seq > ack);
+    if (win !== undefined) this.espWindow = win;
+    this.stallWarned = false;
+    this.pumpTasks();
+  }
+
+  private checkFlowStall(): void {
+    const oldest = this.inFlight[0];
+    if (!oldest || this.stallWarned) return;
+    const age = Date.now() - oldest.sentAt;
+    if (age > FLOW_ACK_STALL_MS) {
+      logger.warn(
+        '[WS]',
+        `flow stalled: seq=${oldest.seq} unacked for ${age}ms (window=${this.espWindow}, pending=${this.pendingTasks.length})`
+      );
+      this.stallWarned = true;
+    }
+  }
+
+  private dropPendingTasks(devices: Set<DeviceId>): void {
+    const before = this.pendingTasks.length;
+    this.pendingTasks = this.pendingTasks.filter((t) => !devices.has(t.device));
+    const dropped = before - this.pendingTasks.length;
+    if (dropped > 0) {
+      taskLog(`dropped ${dropped} pending enqueue task(s) superseded by replace/cancel`);
+    }
+  }
+
+  /** Gắn seq cho envelope thuộc task stream (chỉ khi gửi thật) */
+  private withFlowSeq(envelope: OutboundEnvelope): OutboundEnvelope {
+    switch (envelope.kind) {
+      case 'task.replace':
+      case 'task.enqueue':
+      case 'task.cancel':
+        return { ...envelope, seq: ++this.txSeq };
+      default:
+        return envelope;
+    }
+  }
+
+  /** Cập nhật sổ sách credit sau khi envelope đã lên dây */
+  private trackSent(envelope: OutboundEnvelope): void {
+    if (this.espWindow === null) return;
+    const now = Date.now();
+    switch (envelope.kind) {
+      case 'task.enqueue': {
+        const wheels = envelope.tasks.filter((t) => t.device === 'wheels').length;
+        this.inFlight.push({ seq: envelope.seq!, wheels, sentAt: now });
+        taskLog(`[WS->ESP] task.enqueue seq=${envelope.seq} (${envelope.tasks.length} task(s), credit left ${this.availableCredit()})`);
+        break;
+      }
+      case 'task.replace': {
+        const wheels = envelope.tasks.filter((t) => t.device === 'wheels').length;
+        if (wheels === 0) break; // ESP chỉ xoá queue wheels khi replace có task wheels
+        this.flowResetSeq = envelope.seq!;
+        this.espWindow = this.espCapacity;
+        this.inFlight = [{ seq: envelope.seq!, wheels, sentAt: now }];
+        break;
+      }
+      case 'task.cancel':
+        if (envelope.device !== 'wheels') break;
+        this.flowResetSeq = envelope.seq!;
+        this.espWindow = this.espCapacity;
+        this.inFlight = [];
+        break;
+      default:
+        break;
+    }
   }
 
   /**
@@ -381,8 +1110,9 @@ export class WsHub {
       return;
     }
     try {
-      const payload = JSON.stringify(envelope);
-      this.espSocket.send(payload);
+      const wire = this.withFlowSeq(envelope);
+      this.espSocket.send(JSON.stringify(wire));
+      this.trackSent(wire);
     } catch (e) {
       wsLog('Failed to send envelope, buffering', e);
       if (this.buffer.length >= BUFFER_MAX) {
@@ -0,0 +1,212 @@
+/**
+ * Loopback test: độ trễ lệnh drive qua TCP (đường WebSocket) so với UDP drive channel
+ * khi mạng mất gói (giả lập).
+ *
+ * - TCP: proxy giữ thứ tự như TCP thật — segment bị mất chỉ tới sau khi retransmit
+ *   (fast retransmit sau 3 dup-ack hoặc RTO), mọi lệnh phía sau phải chờ nó
+ *   (head-of-line blocking). Framing WS nằm trên cùng stream nên hành vi như nhau.
+ * - UDP: datagram 14 byte giống firmware (Protocol::UDP_DRIVE); mất là mất, bên nhận
+ *   chỉ áp dụng seq mới nhất.
+ *
+ * Độ trễ của lệnh i = lúc bên nhận áp dụng một lệnh có seq >= i trừ lúc gửi lệnh i
+ * (lệnh mới hơn thay thế lệnh bị mất, như trên ESP).
+ *
+ * Usage: node test-udp-latency.js [--loss 0,0.01,0.05] [--rate 20] [--count 300] [--rto 200] [--seed 1]
+ */
+
+const net = require('net');
+const dgram = require('dgram');
+
+function arg(name, def) {
+  const i = process.argv.indexOf(`--${name}`);
+  return i > 0 && i + 1 < process.argv.length ? process.argv[i + 1] : def;
+}
+
+const LOSSES = arg('loss', '0,0.01,0.05').split(',').map(Number);
+const RATE_HZ = Number(arg('rate', 20));
+const COUNT = Number(arg('count', 300));
+const RTO_MS = Number(arg('rto', 200)); // Linux min RTO
+const RTT_MS = Number(arg('rtt', 3)); // LAN Wi-Fi round trip (fast retransmit)
+const SEED = Number(arg('seed', 1));
+
+const UDP_DRIVE = 0x20;
+const UDP_DRIVE_LEN = 14;
+const TOKEN = 0x1234abcd;
+
+// Deterministic loss pattern (mulberry32)
+function rng(seed) {
+  let a = seed >>> 0;
+  return () => {
+    a = (a + 0x6d2b79f5) >>> 0;
+    let t = a;
+    t = Math.imul(t ^ (t >>> 15), t | 1);
+    t ^= t + Math.imul(t ^ (t >>> 7), t | 61);
+    return ((t ^ (t >>> 14)) >>> 0) / 4294967296;
+  };
+}
+
+const nowMs = () => Number(process.hrtime.bigint()) / 1e6;
+const listen = (server) => new Promise((resolve) => server.listen(0, '127.0.0.1', () => resolve(server.address().port)));
+
+/** Bên nhận: ghi thời điểm seq mới nhất được áp dụng */
+class Receiver {
+  constructor() {
+    this.last = 0;
+    this.applied = []; // [seq, t]
+  }
+  apply(seq) {
+    if (seq <= this.last) return;
+    this.last = seq;
+    this.applied.push([seq, nowMs()]);
+  }
+  // Lần đầu một seq >= i được áp dụng
+  effectiveAt(seq) {
+    for (const [s, t] of this.applied) if (s >= seq) return t;
+    return null;
+  }
+}
+
+/**
+ * Proxy TCP giả lập mất segment: segment mất được gửi lại sau 3 segment tới sau đó
+ * (fast retransmit, + RTT) hoặc sau RTO (backoff x2 nếu mất tiếp); giao theo thứ tự.
+ */
+function lossyTcpProxy(targetPort, loss, rand) {
+  return net.createServer((client) => {
+    client.setNoDelay(true);
+    const upstream = net.connect(targetPort, '127.0.0.1');
+    upstream.setNoDelay(true);
+    const queue = [];
+
+    const pump = () => {
+      while (queue.length && queue[0].ready) upstream.write(queue.shift().data);
+    };
+    const retransmit = (seg, delay) => {
+      clearTimeout(seg.timer);
+      seg.timer = setTimeout(() => {
+        if (rand() < loss) {
+          seg.rto *= 2;
+          retransmit(seg, seg.rto);
+          return;
+        }
+        seg.ready = true;
+        pump();
+      }, delay);
+    };
+
+    client.on('data', (data) => {
+      for (const seg of queue) {
+        if (!seg.ready && !seg.fast && ++seg.dupAcks >= 3) {
+          seg.fast = true;
+          retransmit(seg, RTT_MS);
+        }
+      }
+      const seg = { data, ready: rand() >= loss, dupAcks: 0, fast: false, rto: RTO_MS, timer: null };
+      queue.push(seg);
+      if (!seg.ready) retransmit(seg, RTO_MS);
+      pump();
+    });
+    client.on('close', () => upstream.end());
+  });
+}
+
+async function runTcp(loss) {
+  const rx = new Receiver();
+  const server = net.createServer((sock) => {
+    sock.setNoDelay(true);
+    let buf = '';
+    sock.on('data', (d) => {
+      buf += d.toString();
+      let nl;
+      while ((nl = buf.indexOf('\n')) >= 0) {
+        rx.apply(JSON.parse(buf.slice(0, nl)).seq);
+        buf = buf.slice(nl + 1);
+      }
+    });
+  });
+  const proxy = lossyTcpProxy(await listen(server), loss, rng(SEED));
+  const sock = net.connect(await listen(proxy), '127.0.0.1');
+  sock.setNoDelay(true);
+  await new Promise((r) => sock.once('connect', r));
+
+  const sent = await drive((seq) => {
+    const left = (seq % 200) - 100;
+    sock.write(JSON.stringify({ kind: 'drive', left, right: -left, seq }) + '\n');
+  });
+  sock.end();
+  server.close();
+  proxy.close();
+  return stats(sent, rx);
+}
+
+async function runUdp(loss) {
+  const rx = new Receiver();
+  const server = dgram.createSocket('udp4');
+  server.on('message', (msg) => {
+    if (msg.length !== UDP_DRIVE_LEN || msg[0] !== UDP_DRIVE || msg.readUInt32LE(2) !== TOKEN) return;
+    rx.apply(msg.readUInt32LE(6));
+  });
+  await new Promise((r) => server.bind(0, '127.0.0.1', r));
+  const port = server.address().port;
+  const client = dgram.createSocket('udp4');
+  const rand = rng(SEED);
+
+  const sent = await drive((seq) => {
+    if (rand() < loss) return; // mất trên đường
+    const buf = Buffer.alloc(UDP_DRIVE_LEN);
+    buf[0] = UDP_DRIVE;
+    buf.writeUInt32LE(TOKEN, 2);
+    buf.writeUInt32LE(seq, 6);
+    buf.writeInt8((seq % 200) - 100, 10);
+    buf.writeInt8(100 - (seq % 200), 11);
+    buf.writeUInt16LE(600, 12);
+    client.send(buf, port, '127.0.0.1');
+  });
+  client.close();
+  server.close();
+  return stats(sent, rx);
+}
+
+/** Gửi COUNT lệnh với tần số RATE_HZ (như joystick UI), chờ thêm để retransmit kịp tới */
+function drive(send) {
+  return new Promise((resolve) => {
+    const sent = [];
+    let seq = 0;
+    const timer = setInterval(() => {
+      seq++;
+      sent.push([seq, nowMs()]);
+      send(seq);
+      if (seq >= COUNT) {
+        clearInterval(timer);
+        setTimeout(() => resolve(sent), RTO_MS * 8);
+      }
+    }, 1000 / RATE_HZ);
+  });
+}
+
+function stats(sent, rx) {
+  const lat = [];
+  let never = 0;
+  for (const [seq, t] of sent) {
+    const at = rx.effectiveAt(seq);
+    if (at === null) never++;
+    else lat.push(at - t);
+  }
+  lat.sort((a, b) => a - b);
+  const pct = (p) => (lat.length ? lat[Math.min(lat.length - 1, Math.floor((p / 100) * lat.length))] : NaN);
+  return { p50: pct(50), p99: pct(99), max: lat[lat.length - 1] ?? NaN, never };
+}
+
+(async () => {
+  console.log(`[TEST] ${COUNT} drive commands @ ${RATE_HZ} Hz, RTO ${RTO_MS}ms, RTT ${RTT_MS}ms, seed ${SEED}`);
+  console.log('[TEST] loss    transport   p50 ms   p99 ms   max ms  never applied');
+  const fmt = (v) => v.toFixed(1).padStart(8);
+  for (const loss of LOSSES) {
+    const [tcp, udp] = await Promise.all([runTcp(loss), runUdp(loss)]);
+    for (const [name, r] of [['tcp (ws)', tcp], ['udp', udp]]) {
+      console.log(
+        `[TEST] ${(loss * 100).toFixed(1).padStart(4)}%  ${name.padEnd(10)}${fmt(r.p50)} ${fmt(r.p99)} ${fmt(r.max)}  ${r.never}`
+      );
+    }
+  }
+  process.exit(0);
+})();